@@ -0,0 +1,144 @@
+/**
+  Heap allocation counter for allocation checking builds.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "AllocCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef TRACK_ALLOCATIONS
+
+static thread_local HEAP_ALLOCATION_COUNTER   mOwnCounter (0);
+static thread_local HEAP_ALLOCATION_COUNTER  *mCounter = NULL;    // NULL for mOwnCounter.
+
+void *
+operator new (
+  size_t  Size
+  )
+{
+  ((mCounter != NULL) ? *mCounter : mOwnCounter).fetch_add (1, std::memory_order_relaxed);
+
+  void  *Buffer = malloc (Size == 0 ? 1 : Size);
+  if (Buffer == NULL) {
+    throw std::bad_alloc ();
+  }
+
+  return Buffer;
+}
+
+void *
+operator new[] (
+  size_t  Size
+  )
+{
+  return operator new (Size);
+}
+
+void
+operator delete (
+  void  *Buffer
+  ) noexcept
+{
+  free (Buffer);
+}
+
+void
+operator delete[] (
+  void  *Buffer
+  ) noexcept
+{
+  free (Buffer);
+}
+
+void
+operator delete (
+  void    *Buffer,
+  size_t
+  ) noexcept
+{
+  free (Buffer);
+}
+
+void
+operator delete[] (
+  void    *Buffer,
+  size_t
+  ) noexcept
+{
+  free (Buffer);
+}
+
+/**
+  Get the allocations counted so far by the counter the calling thread counts into.
+
+  @return  Number of calls of operator new.
+
+**/
+uint64_t
+GetHeapAllocationCount (
+  void
+  )
+{
+  return GetHeapAllocationCounter ()->load (std::memory_order_relaxed);
+}
+
+/**
+  Get the counter the calling thread counts into, to hand it to a helper thread.
+
+  @return  The counter.
+
+**/
+HEAP_ALLOCATION_COUNTER *
+GetHeapAllocationCounter (
+  void
+  )
+{
+  return (mCounter != NULL) ? mCounter : &mOwnCounter;
+}
+
+/**
+  Let the calling thread count into another thread's counter, at the start of a
+  helper thread. The counter's thread must outlive the calling thread.
+
+  @param[in]  Counter  Counter from GetHeapAllocationCounter(), NULL for the
+                       thread's own counter.
+
+**/
+void
+SetHeapAllocationCounter (
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+  mCounter = Counter;
+}
+
+#else
+
+uint64_t
+GetHeapAllocationCount (
+  void
+  )
+{
+  return 0;
+}
+
+HEAP_ALLOCATION_COUNTER *
+GetHeapAllocationCounter (
+  void
+  )
+{
+  return NULL;
+}
+
+void
+SetHeapAllocationCounter (
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+}
+
+#endif
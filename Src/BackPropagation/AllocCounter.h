@@ -0,0 +1,43 @@
+/**
+  Heap allocation counter for allocation checking builds.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _ALLOC_COUNTER_H_
+#define _ALLOC_COUNTER_H_
+
+#include <cstdint>
+#include <atomic>
+
+//
+// Build with -DTRACK_ALLOCATIONS (make alloc-check) to count every call of
+// the global operator new. Training then throws if a steady-state step
+// allocates. Without the macro the count is always 0.
+//
+// Every thread counts into its own counter, so trainings running in other
+// threads (e.g. of a sweep) don't show up in each other's steps. The helper
+// threads of a trainer (the task graph, the weight updater, the model shard
+// team and the input producers) count into the counter of the thread that
+// started them, so their allocations fail the trainer's step too. The
+// checkpoint writer keeps its own counter, it writes while steps run.
+//
+typedef std::atomic<uint64_t>  HEAP_ALLOCATION_COUNTER;
+
+uint64_t
+GetHeapAllocationCount (
+  void
+  );
+
+HEAP_ALLOCATION_COUNTER *
+GetHeapAllocationCounter (
+  void
+  );
+
+void
+SetHeapAllocationCounter (
+  HEAP_ALLOCATION_COUNTER  *Counter
+  );
+
+#endif
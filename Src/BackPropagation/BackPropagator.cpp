@@ -6,16 +6,54 @@
 **/
 
 #include "BackPropagator.h"
+#include "AllocCounter.h"
+#include "BpMisc.h"
 #include "DebugLib.h"
 
-#include <set>
 #include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 
 using namespace std;
 
 #define  MAX_EPOCHS_TO_TRACK_LOSS  10
 #define  SHAKE_WEIGHT_THRESHOLD    0.001
 
+//
+// Deterministic training splits every batch into this many leaves, see
+// TrainOneEpochDeterministic(). Power of two, and the largest data-parallel
+// group it supports.
+//
+#define  DETERMINISTIC_LEAF_COUNT   16
+#define  DETERMINISTIC_LEAF_DEPTH   5     // log2(DETERMINISTIC_LEAF_COUNT) + 1 partial sums.
+
+//
+// Losses are rounded to multiples of 2^-DETERMINISTIC_LOSS_BITS in deterministic
+// training. Sums of such values stay exact below 2^(53 - DETERMINISTIC_LOSS_BITS),
+// so they don't depend on the summation order.
+//
+#define  DETERMINISTIC_LOSS_BITS    32
+
+//
+// Fewest samples per input pipeline buffer, so small batches don't hand buffers over
+// every few samples.
+//
+#define  INPUT_MIN_CHUNK            32
+
+/**
+  Round the loss of one data sample for an order independent sum.
+
+**/
+static
+double
+QuantizeLoss (
+  double  Loss
+  )
+{
+  return ldexp (nearbyint (ldexp (Loss, DETERMINISTIC_LOSS_BITS)), -DETERMINISTIC_LOSS_BITS);
+}
+
 /**
   Calculate the standard deviation of a vector of double values.
 
@@ -88,28 +126,20 @@ CalculateStandardDeviation (
 **/
 BackPropagator::BackPropagator (
   FullyConnectedNetwork &FCN
-  ) : Network (FCN)
+  ) : Network (FCN),
+      GraphDesiredOutput (NULL),
+      GraphLoss (0.0),
+      UpdatePending (false),
+      PendingLearningRate (0.0),
+      PendingSampleCount (0),
+      ShardDesiredOutput (NULL),
+      ShardLoss (0.0)
 {
-  InitNodeDelta ();
+  Workspace.Init (Network.GetLayout ());
 
   InitTrainingParams ();
 }
 
-/**
-  Initialize delta values of each layer to zero.
-
-**/
-void
-BackPropagator::InitNodeDelta ()
-{
-  vector<unsigned int> Layout = Network.GetLayout ();
-
-  for(int Index = 0; Index < (int)Layout.size(); Index++) {
-    matrix LayerDelta (Layout[Index], 1);
-    NodeDelta.push_back (LayerDelta);
-  }
-}
-
 /**
   Set the delta value of a specific node in a specific layer.
 
@@ -126,7 +156,7 @@ void BackPropagator::SetNodeDelta (
   double       Delta
   )
 {
-  vector<unsigned int> Layout = Network.GetLayout ();
+  const NETWORK_LAYOUT  &Layout = Network.GetLayout ();
 
   if (Layer >= (unsigned int)Layout.size()) {
     DEBUG_LOG ("Layer: " << Layer << ", Layout size: " << Layout.size());
@@ -137,7 +167,7 @@ void BackPropagator::SetNodeDelta (
     throw std::runtime_error("Error: Node number index out of range in SetNodeDelta().");
   }
 
-  NodeDelta[Layer].SetValue (Number, 0, Delta);
+  Workspace.NodeDelta[Layer].SetValue (Number, 0, Delta);
 }
 
 /**
@@ -150,15 +180,15 @@ BackPropagator::PrintNodeDelta(
   void
   )
 {
-  for(int Index = 0; Index < (int)NodeDelta.size(); Index++) {
+  for(int Index = 0; Index < (int)Workspace.NodeDelta.size(); Index++) {
     cout << "Delta in layer " << Index<< ":" <<endl;
-    NodeDelta[Index].show();
+    Workspace.NodeDelta[Index].show();
   }
 }
 
 /**
   [**Only for internal debug use**]
-  Print the delta weights between each layers.
+  Print the delta weights accumulated in current batch between each layers.
 
 **/
 void
@@ -166,174 +196,860 @@ BackPropagator::PrintDeltaWeights(
   void
   )
 {
-  for(int Index = 0; Index < (int)DeltaWeights.size(); Index++) {
+  for(int Index = 0; Index < (int)Workspace.BatchDeltaWeights.size(); Index++) {
     cout << "Delta weights between layer" << Index << " and layer " << Index + 1 << endl;
-    DeltaWeights[Index].show();
+    Workspace.BatchDeltaWeights[Index].show();
   }
 }
 
 /**
-  Initialize delta weights between each layers to zero.
+  Initialize training mode related settings.
+  No initialization is required for PATTERN_MODE.
+  Optimizer state is kept if it already matches the network, so that
+  a restored or previous training can be continued.
 
 **/
-void BackPropagator::InitDeltaWeights ()
+void
+BackPropagator::InitTrainingMode (
+  void
+  )
 {
-  vector<unsigned int> Layout = Network.GetLayout ();
+  //
+  // The reduced precision pass has neither activation checkpoints nor model shards.
+  //
+  if ((LowPrecision.GetMode () != PRECISION_DOUBLE) && ((ActivationCheckpointInterval > 1) || (ModelShards > 1))) {
+    DEBUG_LOG ("Precision: " << LowPrecision.GetMode () << ", Activation checkpoint interval: " << ActivationCheckpointInterval
+               << ", Model shards: " << ModelShards);
+    throw invalid_argument ("BackPropagator: Activation checkpointing and model shards are only supported in double precision.");
+  }
+
+  //
+  // Checkpointing must keep fewer activation values than the whole layout.
+  //
+  if (ActivationCheckpointInterval > 1) {
+    size_t  FullValues = 0;
+    size_t  KeptValues = TrainingWorkspace::GetCheckpointedValues (Network.GetLayout (), ActivationCheckpointInterval);
+
+    for (unsigned int Layer = 0; Layer < (unsigned int)Network.GetLayout ().size(); Layer++) {
+      FullValues += Network.GetLayout ()[Layer];
+    }
+    if (KeptValues >= FullValues) {
+      DEBUG_LOG ("Activation checkpoint interval: " << ActivationCheckpointInterval << ", " << KeptValues << " of " << FullValues << " values kept");
+      throw invalid_argument ("BackPropagator: Activation checkpointing doesn't save memory for this layout and interval.");
+    }
+  }
+
+  //
+  // A checkpointed workspace never matches the layout, it's rebuilt for the interval.
+  //
+  if (!Workspace.IsReady (Network.GetLayout ()) || (ActivationCheckpointInterval > 1)) {
+    Workspace.Init (Network.GetLayout ());
+    if (ActivationCheckpointInterval > 1) {
+      Workspace.InitActivationCheckpoints (Network.GetLayout (), ActivationCheckpointInterval);
+    }
+  }
+  Workspace.ClearBatchDeltaWeights ();
+
+  if (!WeightOptimizer.IsReady (Network.GetLayout ())) {
+    WeightOptimizer.Init (Network.GetLayout ());
+  }
+
+  FirstTrainableLayer = (unsigned int)(find (FrozenLayers.begin (), FrozenLayers.end (), false) - FrozenLayers.begin ());
+  if (FirstTrainableLayer == (unsigned int)FrozenLayers.size()) {
+    throw invalid_argument ("BackPropagator: All weight layers are frozen, there is nothing to train.");
+  }
+  WeightOptimizer.SetFrozenLayers (FrozenLayers);
+
+  if (BackwardThreads != 0) {
+    BuildBackwardGraph ();
+  }
 
-  for(unsigned int Index = 0; Index < (unsigned int)Layout.size() - 1; Index++) {
-    matrix LayerDeltaWeights (Layout[Index + 1], Layout[Index]);
-    DeltaWeights.push_back (LayerDeltaWeights);
+  if (ModelShards > 1) {
+    if ((BackwardThreads != 0) || (ActivationCheckpointInterval > 1)) {
+      DEBUG_LOG ("Model shards: " << ModelShards << ", Backward threads: " << BackwardThreads
+                 << ", Activation checkpoint interval: " << ActivationCheckpointInterval);
+      throw invalid_argument ("BackPropagator: Model shards can't be combined with backward threads or activation checkpointing.");
+    }
+    if (ShardTeam.GetSize () != ModelShards) {
+      ShardTeam.Start (ModelShards, [this] (unsigned int Shard) { ShardedPass (Shard); });
+    }
   }
+
+  //
+  // An input buffer holds a batch. Augmentation runs on the input threads, at least one.
+  //
+  UseInputFeed = (InputThreads != 0) || Augmenter.IsEnabled ();
+  if (UseInputFeed) {
+    InputFeed.Init (max (InputThreads, 1u), max (BatchSize, (unsigned int)INPUT_MIN_CHUNK), Network.GetLayout ()[0]);
+  }
+
+  if (PipelinedUpdate) {
+    if (Workspace.PendingDeltaWeights.size () != Workspace.BatchDeltaWeights.size ()) {
+      Workspace.InitPipeline ();
+    }
+    if (!WeightUpdater.IsStarted ()) {
+      WeightUpdater.Start ([this] { ApplyPendingUpdate (); });
+    }
+  }
+
+  //
+  // All data-parallel workers start from the weights of rank 0.
+  //
+  SyncReplicaWeights ();
+
+  LowPrecision.Init (Network.GetLayout (), Network.GetActivationType ());
+  LowPrecision.SyncWeights (Network.GetWeightsRef ());
 }
 
 /**
+  Overwrite the weights of every data-parallel worker with those of rank 0.
+  Nothing to do when training alone.
 
 **/
 void
-BackPropagator::InitBatchDeltaWeights (
+BackPropagator::SyncReplicaWeights (
   void
   )
 {
-  vector<unsigned int> Layout = Network.GetLayout ();
+  if (DataParallelGroup == NULL) {
+    return;
+  }
+
+  vector<matrix>  Weights = Network.GetWeights ();
+
+  DataParallelGroup->Broadcast (Weights, 0);
+  Network.SetWeights (Weights);
+}
+
+/**
+  Turn the loss sums and sample counts of an epoch into averages. In a data-parallel
+  group the sums of all workers are added first, so that every worker takes the same
+  scheduling and stopping decisions.
 
-  BatchDeltaWeights.clear();
+  @param[in,out]  EpochLoss           Sum of the training loss, the average on return.
+  @param[in]      TrainCount          Number of samples trained.
+  @param[in,out]  ValidationLoss      Sum of the validation loss, the average on return.
+  @param[in]      ValidationCorrect   Number of validation samples predicted correctly.
+  @param[in]      ValidationCount     Number of samples validated.
+  @param[out]     ValidationAccuracy  Ratio of validation samples predicted correctly.
 
-  for (unsigned int Index = 0; Index < (unsigned int)Layout.size() - 1; Index++) {
-    matrix LayerDeltaWeights (Layout[Index + 1], Layout[Index]);
-    BatchDeltaWeights.push_back (LayerDeltaWeights);
+**/
+void
+BackPropagator::ReduceEpochStatistics (
+  double        &EpochLoss,
+  unsigned int  TrainCount,
+  double        &ValidationLoss,
+  unsigned int  ValidationCorrect,
+  unsigned int  ValidationCount,
+  double        &ValidationAccuracy
+  )
+{
+  double  Statistics[5] = {
+            EpochLoss,
+            (double)TrainCount,
+            ValidationLoss,
+            (double)ValidationCorrect,
+            (double)ValidationCount
+            };
+
+  if (DataParallelGroup != NULL) {
+    DataParallelGroup->AllReduceSum (Statistics, sizeof (Statistics) / sizeof (Statistics[0]));
+  }
+
+  EpochLoss = Statistics[0] / Statistics[1];
+  if (Statistics[4] != 0.0) {
+    ValidationLoss     = Statistics[2] / Statistics[4];
+    ValidationAccuracy = Statistics[3] / Statistics[4];
   }
 }
 
 /**
-  Initialize training mode related settings.
-  No initialization is required for PATTERN_MODE.
+  Apply the delta weights accumulated in a batch to the network and start a new batch.
+  In reduced precision mode, a batch whose gradients overflowed is dropped, and the
+  compute copy of weights is refreshed after the update.
+  In a data-parallel group, the delta weights and sample counts of all workers are
+  summed first, so every worker applies the same update.
+
+  @param[in]  LearningRate  Step size of this update.
+  @param[in]  SampleCount   Number of data samples accumulated in the batch.
 
 **/
 void
-BackPropagator::InitTrainingMode (
+BackPropagator::CommitBatch (
+  const double        LearningRate,
+  const unsigned int  SampleCount
+  )
+{
+  unsigned int  TotalSampleCount = SampleCount;
+
+  if (DataParallelGroup != NULL) {
+    double  Extra[2] = { (double)SampleCount, LowPrecision.HasOverflow () ? 1.0 : 0.0 };
+
+    DataParallelGroup->AllReduceSum (Workspace.BatchDeltaWeights, Extra, sizeof (Extra) / sizeof (Extra[0]));
+
+    TotalSampleCount = (unsigned int)Extra[0];
+    if (Extra[1] != 0.0) {
+      LowPrecision.FlagOverflow ();
+    }
+  }
+
+  if (LowPrecision.EndBatch ()) {
+    if (PipelinedUpdate) {
+      SubmitPipelinedUpdate (LearningRate, TotalSampleCount);
+    } else {
+      UpdateWeights (Workspace.BatchDeltaWeights, LearningRate, TotalSampleCount);
+
+      if (LowPrecision.GetMode () != PRECISION_DOUBLE) {
+        LowPrecision.SyncWeights (Network.GetWeightsRef ());
+      }
+    }
+  }
+
+  Workspace.ClearBatchDeltaWeights ();
+}
+
+/**
+  Hand the delta weights of a batch over to the background updater. The update
+  before it is put in place first, so training continues with weights one update
+  behind. The batch's delta weights move to the pending buffer without a copy.
+
+  @param[in]  LearningRate  Step size of this update.
+  @param[in]  SampleCount   Number of data samples accumulated in the batch.
+
+**/
+void
+BackPropagator::SubmitPipelinedUpdate (
+  const double        LearningRate,
+  const unsigned int  SampleCount
+  )
+{
+  if (SampleCount == 0) {
+    DEBUG_LOG ("Sample count is 0, failed to calculate average.");
+    throw runtime_error ("Failed to calculate average if dividing 0.");
+  }
+
+  FinishPendingUpdate ();
+
+  swap (Workspace.BatchDeltaWeights, Workspace.PendingDeltaWeights);
+  PendingLearningRate = LearningRate;
+  PendingSampleCount  = SampleCount;
+  UpdatePending       = true;
+
+  WeightUpdater.Submit ();
+}
+
+/**
+  [Background thread] Write the network's weights plus one optimizer step with the
+  pending delta weights into the next weights buffer. The training thread only reads
+  the network's weights meanwhile, and doesn't touch the optimizer.
+
+**/
+void
+BackPropagator::ApplyPendingUpdate (
   void
   )
 {
-  InitBatchDeltaWeights ();
+  const vector<matrix>  &Weights = Network.GetWeightsRef ();
+
+  for (unsigned int Layer = 0; Layer < (unsigned int)Weights.size(); Layer++) {
+    memcpy (Workspace.NextWeights[Layer].Data(), Weights[Layer].Data(), Weights[Layer].Size() * sizeof (double));
+  }
+
+  WeightOptimizer.Step (
+    Workspace.NextWeights,
+    Workspace.PendingDeltaWeights,
+    PendingLearningRate,
+    1 / (double)PendingSampleCount
+    );
+}
+
+/**
+  Wait for the update in flight, if any, and put its weights in place.
+
+**/
+void
+BackPropagator::FinishPendingUpdate (
+  void
+  )
+{
+  if (!UpdatePending) {
+    return;
+  }
+
+  WeightUpdater.Wait ();
+  UpdatePending = false;
+
+  Network.SwapWeights (Workspace.NextWeights);
+
+  if (LowPrecision.GetMode () != PRECISION_DOUBLE) {
+    LowPrecision.SyncWeights (Network.GetWeightsRef ());
+  }
+}
+
+/**
+  Forward pass of a data sample of the training data set. With the frozen output
+  cache, the first pass of a sample stores the activation of the first trainable
+  layer, and the following ones start from it. The activations of the frozen
+  layers below it are then left stale, the backward pass doesn't read them.
+
+  @param[in]  InputData  A matrix representing the input data.
+  @param[in]  DataIndex  Index of the data sample in the data set.
+
+**/
+void
+BackPropagator::ForwardSample (
+  const matrix        &InputData,
+  const unsigned int  DataIndex
+  )
+{
+  if (Workspace.FrozenOutputReady.empty ()) {
+    Network.Forward (InputData, Workspace.Activation);
+    return;
+  }
+
+  matrix  &Output = Workspace.Activation[FirstTrainableLayer];
+  double  *Cached = Workspace.FrozenOutput.Data() + (size_t)DataIndex * Output.Size();
+
+  if (Workspace.FrozenOutputReady[DataIndex]) {
+    memcpy (Output.Data(), Cached, Output.Size() * sizeof (double));
+    Network.ForwardFrom (FirstTrainableLayer, Workspace.Activation);
+  } else {
+    Network.Forward (InputData, Workspace.Activation);
+    memcpy (Cached, Output.Data(), Output.Size() * sizeof (double));
+    Workspace.FrozenOutputReady[DataIndex] = true;
+  }
 }
 
 /**
   Train the network with one data sample, including forward pass and backward pass.
 
   @param[in]  InputData     A matrix representing the input data.
-  @param[in]  DesiredOutput A matrix representing the desired output values.
-  @param[in]  LearningRate  A double representing the learning rate for weight updates.
+  @param[in]  DesiredOutput The desired output values, or the output node of a class.
+  @param[in]  DataIndex     Index of the data sample in the data set.
 
   @return A double representing the loss value after training with this data sample.
 
 **/
 double
 BackPropagator::TrainOneData (
-  const matrix  &InputData,
-  const matrix  &DesiredOutput,
-  const double  LearningRate
+  const matrix          &InputData,
+  const DESIRED_OUTPUT  &DesiredOutput,
+  const unsigned int    DataIndex
   )
 {
   double  Loss;
 
-  Network.Forward (InputData);
+  if (LowPrecision.GetMode () != PRECISION_DOUBLE) {
+    LowPrecision.Forward (InputData);
+
+    return LowPrecision.Backward (DesiredOutput, Workspace.BatchDeltaWeights);
+  }
+
+  if (ActivationCheckpointInterval > 1) {
+    ForwardCheckpointed (InputData);
 
-  Loss = LossMeanSquareError (DesiredOutput);
+    return BackwardPassCheckpointed (DesiredOutput);
+  }
+
+  if (ModelShards > 1) {
+    return ShardedTrainOneData (InputData, DesiredOutput);
+  }
 
-  BackwardPass (DesiredOutput, LearningRate);
+  ForwardSample (InputData, DataIndex);
+
+  //
+  // Loss is produced by the same pass as the output layer delta.
+  //
+  Loss = BackwardPass (DesiredOutput);
 
   return Loss;
 }
 
 /**
-  Train the network for one epoch over the entire dataset.
+  Get the index of the largest value in a column matrix.
+
+**/
+static
+unsigned int
+ArgMax (
+  const matrix  &Column
+  )
+{
+  const double  *Value    = Column.Data();
+  unsigned int  MaxIndex  = 0;
+
+  for (unsigned int Index = 1; Index < Column.Size(); Index++) {
+    if (Value[Index] > Value[MaxIndex]) {
+      MaxIndex = Index;
+    }
+  }
+
+  return MaxIndex;
+}
+
+/**
+  Train the network for one epoch over the training part of the dataset.
+  Data samples are visited in a random order.
 
-  @param[in]  InputDataSet     A vector of matrices representing the input data samples.
-  @param[in]  DesiredOutputSet A vector of matrices representing the desired output values for each sample.
-  @param[in]  LearningRate     A double representing the learning rate for weight updates.
+  @param[in]      Data             The data samples.
+  @param[in,out]  TrainIndices     Indices of the data samples to train with, shuffled on every call.
+  @param[in]      LearningRate     A double representing the learning rate for weight updates.
 
-  @return A double representing the average loss over the epoch.
+  @return A double representing the sum of the loss over the epoch.
 
 **/
 double
 BackPropagator::TrainOneEpoch (
-  const vector<matrix> &InputDataSet,
-  const vector<matrix> &DesiredOutputSet,
-  const double         LearningRate
+  const DataSource      &Data,
+  vector<unsigned int>  &TrainIndices,
+  const double          LearningRate
   )
 {
-  double             EpochLoss = 0.0;
-  set<unsigned int>  TrainedDataIndex;
-  unsigned int       RandIndex;
+  double        EpochLoss = 0.0;
+  unsigned int  BatchSampleCount = 0;
+  uint64_t      StepAllocations;
 
-  while (TrainedDataIndex.size() < InputDataSet.size()) {
-    RandIndex = rand() % InputDataSet.size();
-    if (TrainedDataIndex.count (RandIndex) != 0) {
-      continue;
-    }
+  Data.ShuffleEpoch (TrainIndices, NULL);
+  if (UseInputFeed) {
+    u_int64_t  AugmentSeed = Augmenter.IsEnabled () ? (((u_int64_t)rand () << 32) ^ (u_int64_t)rand ()) : 0;
+
+    InputFeed.Start (Data, TrainIndices, Augmenter.IsEnabled () ? &Augmenter : NULL, AugmentSeed);
+  }
+  StepAllocations = GetHeapAllocationCount ();
 
-    TrainedDataIndex.insert (RandIndex);
+  for (unsigned int Count = 1; Count <= (unsigned int)TrainIndices.size(); Count++) {
+    unsigned int  DataIndex = TrainIndices[Count - 1];
 
     EpochLoss += TrainOneData (
-                   InputDataSet[RandIndex],
-                   DesiredOutputSet[RandIndex],
-                   LearningRate
+                   UseInputFeed ? InputFeed.Next () : Data.GetInput (DataIndex, Workspace.Input),
+                   Data.GetDesiredOutput (DataIndex),
+                   DataIndex
                    );
+    BatchSampleCount++;
 
     //
     // Update weights in batch mode after processing a batch of data samples
     // or after processing all data samples.
     //
-    if (((TrainedDataIndex.size() % BatchSize) == 0) ||
-        (TrainedDataIndex.size() == InputDataSet.size())) {
-      AverageBatchDeltaWeights (BatchSize);
-      UpdateWeights (BatchDeltaWeights);
+    if (((Count % BatchSize) == 0) ||
+        (Count == (unsigned int)TrainIndices.size())) {
+      CommitBatch (LearningRate, BatchSampleCount);
+      BatchSampleCount = 0;
+
+      //
+      // All buffers are preallocated in Workspace, a step(one batch of forward/backward
+      // passes and the weight update) must not touch the heap.
+      // Only checked in allocation checking builds, otherwise the count stays 0.
+      //
+      if (GetHeapAllocationCount () != StepAllocations) {
+        DEBUG_LOG ((GetHeapAllocationCount () - StepAllocations) << " heap allocations in a training step");
+        throw runtime_error ("Heap allocation in a steady-state training step.");
+      }
+
+      BatchCount++;
+      if ((CheckpointEveryBatches != 0) && ((BatchCount % CheckpointEveryBatches) == 0)) {
+        SaveCheckpoint ();
+        StepAllocations = GetHeapAllocationCount ();
+      }
+    }
+  }
+
+  //
+  // Validation and the epoch's bookkeeping see every update of the epoch.
+  //
+  FinishPendingUpdate ();
+  if (UseInputFeed) {
+    InputFeed.Finish ();
+  }
+
+  return EpochLoss;
+}
+
+/**
+  Train the network for one epoch with a result that only depends on the seed,
+  not on the number of data-parallel workers or on how the work is split.
+
+  Every worker holds the whole training set and shuffles it the same way, from a
+  random stream keyed by the seed and the epoch. Every batch is split into
+  DETERMINISTIC_LEAF_COUNT leaves of consecutive samples, and a worker of a group of
+  WorldSize(a power of two) takes DETERMINISTIC_LEAF_COUNT / WorldSize consecutive
+  leaves. The samples of a leaf are accumulated in order, and the leaves in a fixed
+  pairwise tree, ((Leaf0 + Leaf1) + (Leaf2 + Leaf3)) + ..., whose upper levels are
+  done by the group's allreduce in the same shape. Every delta weight is therefore
+  the same sum in the same order for any WorldSize.
+
+  @param[in]      Data             The data samples.
+  @param[in,out]  TrainIndices     Indices of the data samples to train with, shuffled on every call.
+  @param[in]      LearningRate     A double representing the learning rate for weight updates.
+  @param[in]      Epoch            Number of the epoch, keys the shuffle.
+  @param[out]     TrainCount       Number of samples trained by this worker.
+
+  @return A double representing the sum of the loss of the samples trained by this worker.
+
+**/
+double
+BackPropagator::TrainOneEpochDeterministic (
+  const DataSource      &Data,
+  vector<unsigned int>  &TrainIndices,
+  const double          LearningRate,
+  const unsigned int    Epoch,
+  unsigned int          &TrainCount
+  )
+{
+  unsigned int  Rank      = (DataParallelGroup == NULL) ? 0 : DataParallelGroup->GetRank ();
+  unsigned int  WorldSize = (DataParallelGroup == NULL) ? 1 : DataParallelGroup->GetWorldSize ();
+  unsigned int  LeafBegin = Rank * DETERMINISTIC_LEAF_COUNT / WorldSize;
+  unsigned int  LeafEnd   = (Rank + 1) * DETERMINISTIC_LEAF_COUNT / WorldSize;
+  double        EpochLoss = 0.0;
+  uint64_t      StepAllocations;
+  CounterRng    Rng (DeterministicSeed, RNG_STREAM_SHUFFLE + Epoch);
+
+  //
+  // Shuffle from a fixed order, so an epoch's order doesn't depend on the epochs before,
+  // e.g. after a resume.
+  //
+  sort (TrainIndices.begin(), TrainIndices.end());
+  Data.ShuffleEpoch (TrainIndices, &Rng);
+
+  //
+  // The input threads prepare only this worker's leaves, in the order they are trained.
+  //
+  if (UseInputFeed) {
+    InputOrder.clear ();
+    for (unsigned int First = 0; First < (unsigned int)TrainIndices.size(); First += BatchSize) {
+      unsigned int  Count = min (BatchSize, (unsigned int)TrainIndices.size() - First);
+
+      InputOrder.insert (
+        InputOrder.end (),
+        TrainIndices.begin () + First + LeafBegin * Count / DETERMINISTIC_LEAF_COUNT,
+        TrainIndices.begin () + First + LeafEnd * Count / DETERMINISTIC_LEAF_COUNT
+        );
+    }
+    InputFeed.Start (
+      Data,
+      InputOrder,
+      Augmenter.IsEnabled () ? &Augmenter : NULL,
+      CounterRng (DeterministicSeed, RNG_STREAM_AUGMENT + Epoch).Next ()
+      );
+  }
+  StepAllocations = GetHeapAllocationCount ();
+
+  TrainCount = 0;
+  for (unsigned int First = 0; First < (unsigned int)TrainIndices.size(); First += BatchSize) {
+    unsigned int  Count = min (BatchSize, (unsigned int)TrainIndices.size() - First);
+    unsigned int  BatchSampleCount = 0;
+    unsigned int  Depth = 0;
+
+    for (unsigned int Leaf = LeafBegin; Leaf < LeafEnd; Leaf++) {
+      for (unsigned int Sample = First + Leaf * Count / DETERMINISTIC_LEAF_COUNT;
+           Sample < First + (Leaf + 1) * Count / DETERMINISTIC_LEAF_COUNT;
+           Sample++) {
+        EpochLoss += QuantizeLoss (TrainOneData (
+                                     UseInputFeed ? InputFeed.Next () : Data.GetInput (TrainIndices[Sample], Workspace.Input),
+                                     Data.GetDesiredOutput (TrainIndices[Sample]),
+                                     TrainIndices[Sample]
+                                     ));
+        BatchSampleCount++;
+      }
+
+      //
+      // Push the leaf, then merge the top 2 partial sums while they cover the same
+      // number of leaves. Swapping the vectors moves no data.
+      //
+      swap (Workspace.BatchDeltaWeights, Workspace.LeafSums[Depth]);
+      Depth++;
+      for (unsigned int Leaves = Leaf - LeafBegin + 1; (Leaves % 2) == 0; Leaves /= 2) {
+        Depth--;
+        for (unsigned int Layer = 0; Layer < (unsigned int)Workspace.BatchDeltaWeights.size(); Layer++) {
+          AddInto (Workspace.LeafSums[Depth][Layer], Workspace.LeafSums[Depth - 1][Layer]);
+        }
+      }
+      Workspace.ClearBatchDeltaWeights ();
+    }
+
+    swap (Workspace.BatchDeltaWeights, Workspace.LeafSums[0]);
+    CommitBatch (LearningRate, BatchSampleCount);
+    TrainCount += BatchSampleCount;
 
-      InitBatchDeltaWeights ();
+    if (GetHeapAllocationCount () != StepAllocations) {
+      DEBUG_LOG ((GetHeapAllocationCount () - StepAllocations) << " heap allocations in a training step");
+      throw runtime_error ("Heap allocation in a steady-state training step.");
+    }
+
+    BatchCount++;
+    if ((CheckpointEveryBatches != 0) && ((BatchCount % CheckpointEveryBatches) == 0)) {
+      SaveCheckpoint ();
+      StepAllocations = GetHeapAllocationCount ();
     }
   }
 
-  return (double)(EpochLoss / InputDataSet.size());
+  //
+  // Validation and the epoch's bookkeeping see every update of the epoch.
+  //
+  FinishPendingUpdate ();
+  if (UseInputFeed) {
+    InputFeed.Finish ();
+  }
+
+  return EpochLoss;
 }
 
+/**
+  Evaluate the network on the held-out validation part of the dataset.
+  Weights are not updated.
+
+  @param[in]   Data               The data samples.
+  @param[in]   ValidationIndices  Indices of the data samples held out for validation.
+  @param[out]  Correct            Number of samples whose largest output matches the desired output.
+
+  @return A double representing the sum of the loss over the validation samples.
+
+**/
+double
+BackPropagator::ValidateOneEpoch (
+  const DataSource            &Data,
+  const vector<unsigned int>  &ValidationIndices,
+  unsigned int                &Correct
+  )
+{
+  double        ValidationLoss = 0.0;
+  unsigned int  OutputLayer = (unsigned int)Network.GetLayout().size() - 1;
+
+  Correct = 0;
+  for (unsigned int Index = 0; Index < (unsigned int)ValidationIndices.size(); Index++) {
+    unsigned int  DataIndex = ValidationIndices[Index];
+    const matrix    &InputData = Data.GetInput (DataIndex, Workspace.Input);
+    DESIRED_OUTPUT  DesiredOutput = Data.GetDesiredOutput (DataIndex);
+
+    if (ActivationCheckpointInterval > 1) {
+      ForwardCheckpointed (InputData);
+    } else if (ModelShards > 1) {
+      ShardedForward (InputData);
+    } else {
+      ForwardSample (InputData, DataIndex);
+    }
+
+    ValidationLoss += Deterministic ? QuantizeLoss (LossMeanSquareError (DesiredOutput))
+                                    : LossMeanSquareError (DesiredOutput);
+
+    if (ArgMax (Workspace.Activation[OutputLayer]) == Data.GetClass (DataIndex)) {
+      Correct++;
+    }
+  }
+
+  return ValidationLoss;
+}
+
+/**
+  Train the network on data samples already in network format.
+
+  @param[in]  InputDataSet      Input of each data sample.
+  @param[in]  DesiredOutputSet  Desired output of each data sample.
+
+  @throw  runtime_error  The amounts of InputDataSet and DesiredOutputSet don't match.
+
+**/
 void
 BackPropagator::Train (
-  vector<matrix>  &InputDataSet,
-  vector<matrix>  &DesiredOutputSet
+  const vector<matrix>  &InputDataSet,
+  const vector<matrix>  &DesiredOutputSet
   )
 {
-  if (InputDataSet.size() != DesiredOutputSet.size()) {
-    DEBUG_LOG (__FUNCTION__ << ": InputData count = " << InputDataSet.size() << ", DesiredOutput count = " << DesiredOutputSet.size());
-    throw runtime_error ("Amount of InputData and DesiredOutput isn't match.");
+  Train (MatrixDataSource (InputDataSet, DesiredOutputSet));
+}
+
+void
+BackPropagator::Train (
+  const DataSource  &Data
+  )
+{
+  //
+  // Hold out a random part of the data set for validation.
+  //
+  vector<unsigned int>  TrainIndices (Data.GetSampleCount ());
+  vector<unsigned int>  ValidationIndices;
+  unsigned int          ValidationCount = (unsigned int)(Data.GetSampleCount () * ValidationSplit);
+
+  for (unsigned int Index = 0; Index < (unsigned int)TrainIndices.size(); Index++) {
+    TrainIndices[Index] = Index;
+  }
+  if (ValidationCount != 0) {
+    if (Deterministic) {
+      CounterRng  Rng (DeterministicSeed, RNG_STREAM_VALIDATION_SPLIT);
+      ShuffleIndices (TrainIndices, Rng);
+    } else {
+      ShuffleIndices (TrainIndices);
+    }
+    ValidationIndices.assign (TrainIndices.end() - ValidationCount, TrainIndices.end());
+    TrainIndices.resize (TrainIndices.size() - ValidationCount);
   }
-  if (BatchSize > (unsigned int)InputDataSet.size()) {
-    DEBUG_LOG (__FUNCTION__ << ": Batch size = " << BatchSize << ", InputData count = " << InputDataSet.size());
+
+  //
+  // Deterministic data-parallel workers share the training set(see TrainOneEpochDeterministic())
+  // and each validates its own slice of the validation set.
+  //
+  if (Deterministic && (DataParallelGroup != NULL)) {
+    unsigned int  Rank      = DataParallelGroup->GetRank ();
+    unsigned int  WorldSize = DataParallelGroup->GetWorldSize ();
+
+    if ((WorldSize & (WorldSize - 1)) != 0 || WorldSize > DETERMINISTIC_LEAF_COUNT) {
+      DEBUG_LOG (__FUNCTION__ << ": World size = " << WorldSize);
+      throw runtime_error ("Deterministic training needs a power of two workers, at most 16.");
+    }
+
+    ValidationIndices.erase (ValidationIndices.begin() + (Rank + 1) * ValidationCount / WorldSize, ValidationIndices.end());
+    ValidationIndices.erase (ValidationIndices.begin(), ValidationIndices.begin() + Rank * ValidationCount / WorldSize);
+  }
+
+  //
+  // Validation reads its samples once per epoch, in the order the source reads fastest.
+  //
+  Data.SortForReading (ValidationIndices);
+
+  if (TrainIndices.empty () || BatchSize > (unsigned int)TrainIndices.size()) {
+    DEBUG_LOG (__FUNCTION__ << ": Batch size = " << BatchSize << ", Training data count = " << TrainIndices.size());
     throw runtime_error ("Batch size can't be larger than total training data set size.");
   }
 
+  if (Augmenter.IsEnabled () && !Data.CanAugment ()) {
+    DEBUG_LOG (__FUNCTION__ << ": Augmentation on a source without byte images");
+    throw invalid_argument ("BackPropagator: Augmentation needs a data source of byte images, e.g. CompactDataSet.");
+  }
+
   InitTrainingMode ();
+  if (Deterministic) {
+    Workspace.InitLeafSums (DETERMINISTIC_LEAF_DEPTH);
+  }
+
+  //
+  // The frozen layers' output is only computed in the default double precision pass.
+  // Augmented inputs change every epoch, so their frozen output can't be reused.
+  //
+  if (FrozenOutputCache && (FirstTrainableLayer != 0) && (LowPrecision.GetMode () == PRECISION_DOUBLE) &&
+      (ModelShards == 1) && (ActivationCheckpointInterval == 1) && !Augmenter.IsEnabled ()) {
+    Workspace.InitFrozenOutputCache (Data.GetSampleCount (), Network.GetLayout ()[FirstTrainableLayer]);
+  } else {
+    Workspace.FrozenOutput = matrix ();
+    Workspace.FrozenOutputReady.clear ();
+  }
+
+  //
+  // Data-parallel workers hold the same state, only rank 0 writes checkpoints.
+  //
+  if (!CheckpointFileName.empty () && !CheckpointWriter.IsStarted () &&
+      ((DataParallelGroup == NULL) || (DataParallelGroup->GetRank () == 0))) {
+    CheckpointWriter.Start (CheckpointFileName);
+  }
 
-  ShowTrainingParams ();
+  if (Verbose) {
+    ShowTrainingParams ();
+  }
 
   double          EpochLoss;
+  double          EpochLearningRate;
+  double          ValidationLoss = 0.0;
+  double          ValidationAccuracy = 0.0;
+  unsigned int    ValidationCorrect = 0;
+  unsigned int    TrainCount;
+  double          MonitoredLoss;
   clock_t         StartTime;
   clock_t         EndTime;
   vector<double>  Last10EpochsLoss;
   double          StdDev = 0.0;
 
-  for (unsigned int Epoch = 1; Epoch <= Epochs; Epoch++) {
+  Scheduler.Init (LearningRate, Epochs);
+
+  //
+  // Continue after the epoch of a resumed checkpoint, otherwise start over.
+  // The checkpoint restored the best weights of the epochs before it.
+  //
+  if (Resumed) {
+    Scheduler.RestorePlateauState (ResumeLearningRate, ResumeBestLoss, ResumeBadEpochs);
+    Resumed = false;
+    if (Verbose) {
+      cout << "Resume training after epoch #" << CompletedEpochs << endl;
+    }
+  } else {
+    CompletedEpochs = 0;
+    BatchCount      = 0;
+    BestLoss        = numeric_limits<double>::infinity();
+    BestEpoch       = 0;
+    BestWeights.clear ();
+  }
+
+  for (unsigned int Epoch = CompletedEpochs + 1; Epoch <= Epochs; Epoch++) {
     StartTime = clock ();
   
-    cout << "Training Epoch #" << Epoch << endl;
+    if (Verbose) {
+      cout << "Training Epoch #" << Epoch << endl;
+    }
+
+    EpochLearningRate = Scheduler.GetLearningRate (Epoch);
+
+    //
+    // The input threads read Data and the indices, stop them before leaving on an error.
+    //
+    try {
+      if (Deterministic) {
+        EpochLoss = TrainOneEpochDeterministic (
+                      Data,
+                      TrainIndices,
+                      EpochLearningRate,
+                      Epoch,
+                      TrainCount
+                      );
+      } else {
+        EpochLoss = TrainOneEpoch (
+                      Data,
+                      TrainIndices,
+                      EpochLearningRate
+                      );
+        TrainCount = (unsigned int)TrainIndices.size();
+      }
+    }
+    catch (...) {
+      if (UseInputFeed) {
+        InputFeed.Finish ();
+      }
+      throw;
+    }
 
-    EpochLoss = TrainOneEpoch (
-                  InputDataSet,
-                  DesiredOutputSet,
-                  LearningRate
-                  );
+    ValidationLoss = ValidateOneEpoch (
+                       Data,
+                       ValidationIndices,
+                       ValidationCorrect
+                       );
+
+    ReduceEpochStatistics (
+      EpochLoss,
+      TrainCount,
+      ValidationLoss,
+      ValidationCorrect,
+      (unsigned int)ValidationIndices.size(),
+      ValidationAccuracy
+      );
 
     EndTime = clock ();
 
+    //
+    // Validation loss decides scheduling and early stopping when there is a validation set.
+    //
+    MonitoredLoss = (ValidationCount == 0) ? EpochLoss : ValidationLoss;
+    Scheduler.Observe (MonitoredLoss);
+
+    if (MonitoredLoss < BestLoss - EarlyStopMinDelta) {
+      BestLoss  = MonitoredLoss;
+      BestEpoch = Epoch;
+      if (EarlyStopPatience != 0) {
+        BestWeights = Network.GetWeights ();
+      }
+    }
+
+    CompletedEpochs = Epoch;
+    if ((CheckpointEveryEpochs != 0) && ((Epoch % CheckpointEveryEpochs) == 0)) {
+      SaveCheckpoint ();
+    }
+
     if (EpochLoss < TargetLoss) {
       DEBUG_LOG ("Loss of this epoch is lower than target loss(" << TargetLoss << ")");
       break;
@@ -360,20 +1076,61 @@ BackPropagator::Train (
       }
     }
 
-    cout << "Epoch #" << Epoch << ": " << endl;
-    cout << "  Loss = " << EpochLoss << endl;
-    cout << "  Consume time = " << (double)(EndTime - StartTime) / CLOCKS_PER_SEC << " seconds" << endl;
-    if (Last10EpochsLoss.size () >= 2) {
-      cout << "  StdDev of last " << Last10EpochsLoss.size() << " epochs loss = " << StdDev << endl;
+    if (Verbose) {
+      cout << "Epoch #" << Epoch << ": " << endl;
+      cout << "  Loss = " << EpochLoss << endl;
+      if (ValidationCount != 0) {
+        cout << "  Validation Loss = " << ValidationLoss << ", Accuracy = " << ValidationAccuracy * 100 << " %" << endl;
+      }
+      cout << "  Learning Rate = " << EpochLearningRate << endl;
+      cout << "  Consume time = " << (double)(EndTime - StartTime) / CLOCKS_PER_SEC << " seconds" << endl;
+      if (UseInputFeed) {
+        cout << "  Input stall = " << InputFeed.GetStallSeconds () << " seconds, input threads waited "
+             << InputFeed.GetWaitSeconds () << " seconds" << endl;
+      }
+      if (Last10EpochsLoss.size () >= 2) {
+        cout << "  StdDev of last " << Last10EpochsLoss.size() << " epochs loss = " << StdDev << endl;
+      }
+    }
+
+    //
+    // Stop when the monitored loss hasn't improved for EarlyStopPatience epochs.
+    //
+    if ((EarlyStopPatience != 0) && (Epoch - BestEpoch >= EarlyStopPatience)) {
+      if (Verbose) {
+        cout << "Early stopping: no improvement since epoch #" << BestEpoch << endl;
+      }
+      break;
     }
 
     //
     // If standard deviation is smaller than threshold, means loss hasn't
     // change much in last 10 epochs, shake weights.
+    // Early stopping tracks plateaus itself, so don't shake weights under it.
+    // Frozen layers aren't shaken, so their cached output stays valid.
     //
-    if ((StdDev < SHAKE_WEIGHT_THRESHOLD) &&
+    if ((EarlyStopPatience == 0) &&
+        (StdDev < SHAKE_WEIGHT_THRESHOLD) &&
         (StdDev != 0.0)) {
-      Network.PerturbWeight();
+      Network.PerturbWeight(FrozenLayers);
+      SyncReplicaWeights ();
+    }
+  }
+
+  //
+  // Restore the best weights seen during training.
+  //
+  if (!BestWeights.empty ()) {
+    if (Verbose) {
+      cout << "Restore weights of epoch #" << BestEpoch << " (monitored loss = " << BestLoss << ")" << endl;
     }
+    Network.SetWeights (BestWeights);
   }
-}
\ No newline at end of file
+
+  //
+  // Make sure the last checkpoint is on disk before returning.
+  //
+  if (CheckpointWriter.IsStarted ()) {
+    CheckpointWriter.Flush ();
+  }
+}
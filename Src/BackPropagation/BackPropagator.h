@@ -10,8 +10,20 @@
 
 #include "matrix.h"
 #include "FullyConnectedNetwork.h"
+#include "LrScheduler.h"
+#include "MixedPrecision.h"
+#include "TrainingWorkspace.h"
+#include "ShmAllReduce.h"
+#include "Checkpointer.h"
+#include "TaskGraph.h"
+#include "BackgroundTask.h"
+#include "WorkerTeam.h"
+#include "DataSource.h"
+#include "InputPipeline.h"
+#include "PreProcess.h"
 
 #include <vector>
+#include <string>
 #include <functional>
 
 typedef enum {
@@ -22,6 +34,8 @@ typedef enum {
 
 class BackPropagator
 {
+  friend class MultiModelTrainer;
+
   public:
     BackPropagator (FullyConnectedNetwork &FCN);
 
@@ -48,22 +62,157 @@ class BackPropagator
       const unsigned int   BatchSize
       );
 
+    void SetOptimizer (
+      const OPTIMIZER_TYPE  OptimizerType
+      );
+
+    void SetMomentum (
+      const double  Momentum
+      );
+
+    void SetAdamParams (
+      const double  Beta1,
+      const double  Beta2,
+      const double  Epsilon
+      );
+
+    void SetValidationSplit (
+      const double  ValidationSplit
+      );
+
+    void SetEarlyStopping (
+      const unsigned int  Patience,
+      const double        MinDelta
+      );
+
+    void SetLrSchedule (
+      const LR_SCHEDULE_TYPE  ScheduleType
+      );
+
+    void SetLrStepParams (
+      const unsigned int  StepEpochs,
+      const double        Gamma
+      );
+
+    void SetLrCosineParams (
+      const double  MinLearningRate
+      );
+
+    void SetLrPlateauParams (
+      const unsigned int  Patience,
+      const double        Factor,
+      const double        MinLearningRate
+      );
+
+    void SetPrecisionMode (
+      const PRECISION_MODE  PrecisionMode
+      );
+
+    void SetLossScale (
+      const double  LossScale,
+      const bool    Dynamic
+      );
+
+    void SetCheckpoint (
+      const std::string   &FileName,
+      const unsigned int  EveryEpochs,
+      const unsigned int  EveryBatches
+      );
+
+    void SetDataParallelGroup (
+      ShmAllReduce  &Group
+      );
+
+    void SetVerbose (
+      const bool  Verbose
+      );
+
+    void SetDeterministic (
+      const u_int64_t  Seed
+      );
+
+    void SetBackwardThreads (
+      const unsigned int  Threads
+      );
+
+    void SetPipelinedUpdate (
+      const bool  Pipelined
+      );
+
+    void SetActivationCheckpointing (
+      const unsigned int  Interval
+      );
+
+    void SetModelShards (
+      const unsigned int  Shards
+      );
+
+    void SetLayerFrozen (
+      const unsigned int  WeightLayer,
+      const bool          Frozen
+      );
+
+    void SetFrozenOutputCache (
+      const bool  Enable
+      );
+
+    void SetInputThreads (
+      const unsigned int  Threads
+      );
+
+    void SetAugmentation (
+      const AUGMENT_PARAMS  &Params
+      );
+
+    void SetPreProcessor (
+      const InputPreProcessor  *PreProcessor
+      );
+
     void
     ShowTrainingParams (
       void
       );
 
+    //
+    // Results of the last training.
+    //
+    double GetBestLoss () const;
+    unsigned int GetCompletedEpochs () const;
+
     //
     // Function to start training process.
     //
     void Train (
-      std::vector<matrix>  &InputDataSet,
-      std::vector<matrix>  &DesiredOutputSet
+      const DataSource  &Data
+      );
+
+    void Train (
+      const std::vector<matrix>  &InputDataSet,
+      const std::vector<matrix>  &DesiredOutputSet
+      );
+
+    //
+    // Save/restore the network together with the optimizer state(in BpFileIo.cpp).
+    //
+    void ExportToFile (
+      std::string  FilePath,
+      std::string  FileName
+      );
+
+    void ImportOptimizerState (
+      std::string  FileName
+      );
+
+    void ImportPreProcessor (
+      std::string        FileName,
+      InputPreProcessor  &PreProcessor
+      );
+
+    bool ResumeFromCheckpoint (
+      const std::string  &FileName
       );
 
   private:
-    void InitNodeDelta ();
-    void InitDeltaWeights ();
     void SetNodeDelta (
       unsigned int  Layer,
       unsigned int  Number,
@@ -72,26 +221,51 @@ class BackPropagator
     void PrintNodeDelta (); // Only internal debug use.
     void PrintDeltaWeights (); // Only internal debug use.
 
-    void NodeDeltaCalculation (
-      const matrix &DesiredOutput
+    double NodeDeltaCalculation (
+      const DESIRED_OUTPUT  &DesiredOutput
      );
-    matrix  CalculateLastLayerDelta (
-      matrix  DesiredOutput
+    double  CalculateLastLayerDelta (
+      const DESIRED_OUTPUT  &DesiredOutput
       );
-    matrix  CalculateMidLayerDelta (
+    void  CalculateMidLayerDelta (
       unsigned int  Layer
       );
 
     void  DeltaWeightsCalculation (
-      const double  LearningRate
+      unsigned int  FirstLayer
+      );
+    double BackwardPass (
+      const DESIRED_OUTPUT  &DesiredOutput
+      );
+    void  BuildBackwardGraph (
+      void
       );
-    void BackwardPass (
-      const matrix &DesiredOutput,
-      const double LearningRate
+    void  ForwardCheckpointed (
+      const matrix  &InputData
+      );
+    double  BackwardPassCheckpointed (
+      const DESIRED_OUTPUT  &DesiredOutput
+      );
+    void  CalculateMidLayerDeltaRows (
+      unsigned int  Layer,
+      unsigned int  FirstNode,
+      unsigned int  EndNode
+      );
+    void  ShardedPass (
+      unsigned int  Shard
+      );
+    double  ShardedTrainOneData (
+      const matrix          &InputData,
+      const DESIRED_OUTPUT  &DesiredOutput
+      );
+    void  ShardedForward (
+      const matrix  &InputData
       );
 
     void  UpdateWeights (
-      std::vector<matrix>  DeltaWeights
+      const std::vector<matrix>  &DeltaWeights,
+      const double               LearningRate,
+      const unsigned int         SampleCount
       );
 
     void
@@ -100,42 +274,102 @@ class BackPropagator
       );
 
     void
-    InitBatchDeltaWeights (
-      void
+    CommitBatch (
+      const double        LearningRate,
+      const unsigned int  SampleCount
       );
 
-    void
-    UpdateBatchDeltaWeights (
+    void  SubmitPipelinedUpdate (
+      const double        LearningRate,
+      const unsigned int  SampleCount
+      );
+    void  ApplyPendingUpdate (
+      void
+      );
+    void  FinishPendingUpdate (
       void
       );
-
-    void
-    AverageBatchDeltaWeights (
-      unsigned int  TotalTrainDataSetCount
-    );
 
     double  LossMeanSquareError (
-      const matrix &DesiredOutput
+      const DESIRED_OUTPUT  &DesiredOutput
+      );
+
+    void  ForwardSample (
+      const matrix        &InputData,
+      const unsigned int  DataIndex
       );
 
     double  TrainOneData (
-      const matrix  &InputData,
-      const matrix  &DesiredOutput,
-      const double  LearningRate
+      const matrix          &InputData,
+      const DESIRED_OUTPUT  &DesiredOutput,
+      const unsigned int    DataIndex
       );
 
     double  TrainOneEpoch (
-      const std::vector<matrix>  &InputData,
-      const std::vector<matrix>  &DesiredOutput,
+      const DataSource           &Data,
+      std::vector<unsigned int>  &TrainIndices,
       const double               LearningRate
       );
 
+    double  TrainOneEpochDeterministic (
+      const DataSource           &Data,
+      std::vector<unsigned int>  &TrainIndices,
+      const double               LearningRate,
+      const unsigned int         Epoch,
+      unsigned int               &TrainCount
+      );
+
+    void  SaveCheckpoint (
+      void
+      );
+
+    void  SyncReplicaWeights (
+      void
+      );
+
+    void  ReduceEpochStatistics (
+      double        &EpochLoss,
+      unsigned int  TrainCount,
+      double        &ValidationLoss,
+      unsigned int  ValidationCorrect,
+      unsigned int  ValidationCount,
+      double        &ValidationAccuracy
+      );
+
+    double  ValidateOneEpoch (
+      const DataSource                 &Data,
+      const std::vector<unsigned int>  &ValidationIndices,
+      unsigned int                     &Correct
+      );
+
     // std::optional<std::reference_wrapper<FullyConnectedNetwork>>  Network;
     FullyConnectedNetwork          &Network;
 
-    std::vector<matrix>            NodeDelta;
-    std::vector<matrix>            DeltaWeights;
-    std::vector<matrix>            BatchDeltaWeights;
+    TrainingWorkspace              Workspace;
+
+    Optimizer                      WeightOptimizer;
+    MixedPrecision                 LowPrecision;
+
+    ShmAllReduce                   *DataParallelGroup; // NULL when training alone.
+
+    TaskGraph                      BackwardGraph;      // Used when BackwardThreads != 0.
+    const DESIRED_OUTPUT           *GraphDesiredOutput; // Inputs and result of BackwardGraph.
+    double                         GraphLoss;
+
+    BackgroundTask                 WeightUpdater;       // Applies pipelined updates.
+    bool                           UpdatePending;
+    double                         PendingLearningRate;
+    unsigned int                   PendingSampleCount;
+
+    WorkerTeam                     ShardTeam;           // Used when ModelShards > 1.
+    const DESIRED_OUTPUT           *ShardDesiredOutput; // Inputs and result of ShardTeam, NULL for a forward pass only.
+    double                         ShardLoss;
+
+    InputPipeline                  InputFeed;           // Used when UseInputFeed.
+    std::vector<unsigned int>      InputOrder;          // Samples this worker trains in an epoch, in order, for InputFeed.
+
+    Checkpointer                   CheckpointWriter;
+    std::string                    CheckpointBuffer;   // Reused for every snapshot.
 
     //
     // Training parameters
@@ -150,6 +384,62 @@ class BackPropagator
     double                 TargetLoss;
     TRAINING_MODE          TrainingMode;
     unsigned int           BatchSize;
+    double                 ValidationSplit;
+    unsigned int           EarlyStopPatience;
+    double                 EarlyStopMinDelta;
+    LrScheduler            Scheduler;
+    std::string            CheckpointFileName;
+    unsigned int           CheckpointEveryEpochs;
+    unsigned int           CheckpointEveryBatches;
+    bool                   Verbose;
+    bool                   Deterministic;
+    unsigned int           BackwardThreads;
+    bool                   PipelinedUpdate;
+    unsigned int           ActivationCheckpointInterval; // 1 keeps every layer's activation.
+    unsigned int           ModelShards;                  // 1 computes every layer on one thread.
+    std::vector<bool>      FrozenLayers;                 // Per weight layer, not updated when true.
+    bool                   FrozenOutputCache;
+    unsigned int           FirstTrainableLayer;          // Lowest weight layer that isn't frozen, set by InitTrainingMode().
+    u_int64_t              DeterministicSeed;
+    unsigned int           InputThreads;                 // 0 prepares every input on the training thread.
+    ImageAugmenter         Augmenter;                    // Disabled by default.
+    bool                   UseInputFeed;                 // InputThreads or augmentation, set by InitTrainingMode().
+    const InputPreProcessor *PreProcessor;               // Saved with the model, NULL for none.
+
+    //
+    // Training progress, saved in checkpoints.
+    //
+    unsigned int           CompletedEpochs;
+    u_int64_t              BatchCount;
+    double                 BestLoss;
+    unsigned int           BestEpoch;
+    std::vector<matrix>    BestWeights;                  // Weights of BestEpoch under early stopping, else empty.
+    bool                   Resumed;
+    unsigned int           ResumeBadEpochs;
+    double                 ResumeLearningRate;
+    double                 ResumeBestLoss;
 };
 
+//
+// Checkpoint file: the network file format(NETWORK_FILE and weights), then the optimizer
+// section(OPTIMIZER_FILE and state), then this training state section. With
+// HasBestWeights, the weights of BestEpoch follow it, layer by layer as in the
+// network section.
+//
+typedef struct {
+  u_int32_t  Signature;
+  u_int32_t  HdrSize;
+  u_int32_t  Epoch;                // Epochs completed when the checkpoint was taken.
+  u_int32_t  BestEpoch;
+  u_int64_t  BatchCount;           // Weight updates done so far.
+  double     BestLoss;             // Best monitored loss so far.
+  double     LossScale;            // Loss scale of reduced precision training.
+  double     PlateauLearningRate;  // LR_SCHEDULE_PLATEAU state.
+  double     PlateauBestLoss;
+  u_int32_t  PlateauBadEpochs;
+  u_int32_t  HasBestWeights;       // 1 if the best weights follow this header.
+} TRAINING_STATE_FILE;
+
+#define TRAINING_STATE_FILE_SIGNATURE 0x54504B43  // "CKPT" in ASCII
+
 #endif
@@ -8,6 +8,9 @@
 #include "BackPropagator.h"
 #include "DebugLib.h"
 
+#include <limits>
+#include <algorithm>
+
 using namespace std;
 
 void
@@ -20,6 +23,41 @@ BackPropagator::InitTrainingParams (
   TargetLoss   = 0.5;
   TrainingMode = BATCH_MODE;
   BatchSize    = 200;
+
+  ValidationSplit   = 0.0;
+  EarlyStopPatience = 0;
+  EarlyStopMinDelta = 0.0;
+
+  DataParallelGroup = NULL;
+
+  Verbose = true;
+
+  Deterministic     = false;
+  DeterministicSeed = 0;
+
+  BackwardThreads = 0;
+  PipelinedUpdate = false;
+
+  ActivationCheckpointInterval = 1;
+
+  ModelShards = 1;
+
+  InputThreads = 0;
+  UseInputFeed = false;
+  PreProcessor = NULL;
+
+  FrozenLayers.assign (Network.GetLayout ().size() - 1, false);
+  FrozenOutputCache   = false;
+  FirstTrainableLayer = 0;
+
+  CheckpointEveryEpochs  = 0;
+  CheckpointEveryBatches = 0;
+
+  CompletedEpochs = 0;
+  BatchCount      = 0;
+  BestLoss        = numeric_limits<double>::infinity();
+  BestEpoch       = 0;
+  Resumed         = false;
 }
 
 void
@@ -89,6 +127,402 @@ BackPropagator::SetBatchSize (
   this->BatchSize = BatchSize;
 }
 
+/**
+  Set the fraction of the data set held out for validation.
+  0 disables validation, then training loss is monitored instead.
+
+**/
+void
+BackPropagator::SetValidationSplit (
+  const double  ValidationSplit
+  )
+{
+  if (ValidationSplit < 0.0 || ValidationSplit >= 1.0) {
+    DEBUG_LOG ("Validation split = " << ValidationSplit << " should be in [0, 1).");
+    throw invalid_argument ("BackPropagator::SetValidationSplit (): Invalid validation split.");
+  }
+
+  this->ValidationSplit = ValidationSplit;
+}
+
+/**
+  Stop training when the monitored loss hasn't improved by more than MinDelta
+  for Patience epochs, then restore the best weights. Patience = 0 disables it.
+
+**/
+void
+BackPropagator::SetEarlyStopping (
+  const unsigned int  Patience,
+  const double        MinDelta
+  )
+{
+  if (MinDelta < 0.0) {
+    DEBUG_LOG ("MinDelta = " << MinDelta << " should not be negative.");
+    throw invalid_argument ("BackPropagator::SetEarlyStopping (): Invalid minimum delta.");
+  }
+
+  EarlyStopPatience = Patience;
+  EarlyStopMinDelta = MinDelta;
+}
+
+void
+BackPropagator::SetLrSchedule (
+  const LR_SCHEDULE_TYPE  ScheduleType
+  )
+{
+  Scheduler.SetType (ScheduleType);
+}
+
+void
+BackPropagator::SetLrStepParams (
+  const unsigned int  StepEpochs,
+  const double        Gamma
+  )
+{
+  Scheduler.SetStepParams (StepEpochs, Gamma);
+}
+
+void
+BackPropagator::SetLrCosineParams (
+  const double  MinLearningRate
+  )
+{
+  Scheduler.SetCosineParams (MinLearningRate);
+}
+
+void
+BackPropagator::SetLrPlateauParams (
+  const unsigned int  Patience,
+  const double        Factor,
+  const double        MinLearningRate
+  )
+{
+  Scheduler.SetPlateauParams (Patience, Factor, MinLearningRate);
+}
+
+void
+BackPropagator::SetOptimizer (
+  const OPTIMIZER_TYPE  OptimizerType
+  )
+{
+  WeightOptimizer.SetType (OptimizerType);
+}
+
+void
+BackPropagator::SetMomentum (
+  const double  Momentum
+  )
+{
+  WeightOptimizer.SetMomentum (Momentum);
+}
+
+void
+BackPropagator::SetAdamParams (
+  const double  Beta1,
+  const double  Beta2,
+  const double  Epsilon
+  )
+{
+  WeightOptimizer.SetAdamParams (Beta1, Beta2, Epsilon);
+}
+
+/**
+  Select the precision of the forward/backward passes. Master weights and
+  the optimizer always stay in double.
+
+**/
+void
+BackPropagator::SetPrecisionMode (
+  const PRECISION_MODE  PrecisionMode
+  )
+{
+  LowPrecision.SetMode (PrecisionMode);
+}
+
+void
+BackPropagator::SetLossScale (
+  const double  LossScale,
+  const bool    Dynamic
+  )
+{
+  LowPrecision.SetLossScale (LossScale, Dynamic);
+}
+
+/**
+  Save a checkpoint of the weights, optimizer and training progress every EveryEpochs
+  epochs and/or every EveryBatches weight updates. Checkpoints are written by a
+  background thread and each one replaces the previous one in FileName.
+
+  @param[in]  FileName      Checkpoint file, for ResumeFromCheckpoint().
+  @param[in]  EveryEpochs   Epoch interval, 0 to not checkpoint at epoch ends.
+  @param[in]  EveryBatches  Batch interval, 0 to not checkpoint inside epochs.
+
+**/
+void
+BackPropagator::SetCheckpoint (
+  const string        &FileName,
+  const unsigned int  EveryEpochs,
+  const unsigned int  EveryBatches
+  )
+{
+  if (FileName.empty () || (EveryEpochs == 0 && EveryBatches == 0)) {
+    DEBUG_LOG ("FileName = " << FileName << ", EveryEpochs = " << EveryEpochs << ", EveryBatches = " << EveryBatches);
+    throw invalid_argument ("BackPropagator::SetCheckpoint(): Invalid checkpoint setting.");
+  }
+
+  CheckpointFileName     = FileName;
+  CheckpointEveryEpochs  = EveryEpochs;
+  CheckpointEveryBatches = EveryBatches;
+}
+
+/**
+  Train as one worker of a data-parallel group. Every batch, the delta weights of
+  all workers are summed before the update, so each worker should be given its own
+  shard of the data set and BatchSize / WorldSize as batch size. In deterministic
+  training, every worker is given the whole data set and the whole batch size instead.
+
+  @param[in]  Group  Attached allreduce group, must outlive training.
+
+**/
+void
+BackPropagator::SetDataParallelGroup (
+  ShmAllReduce  &Group
+  )
+{
+  DataParallelGroup = &Group;
+}
+
+/**
+  Print the training parameters and the progress of every epoch(default), or
+  train silently, e.g. when several trainings run concurrently.
+
+**/
+void
+BackPropagator::SetVerbose (
+  const bool  Verbose
+  )
+{
+  this->Verbose = Verbose;
+}
+
+/**
+  Make training reproducible bit for bit: shuffling and the validation split draw
+  from counter-based random streams keyed by Seed instead of rand(), and the delta
+  weights of a batch are summed in a fixed order that doesn't change with the size
+  of the data-parallel group. The initial weights are not drawn here, seed rand()
+  with the same Seed before constructing the network.
+
+  @param[in]  Seed  Seed of all random streams of the training.
+
+**/
+void
+BackPropagator::SetDeterministic (
+  const u_int64_t  Seed
+  )
+{
+  Deterministic     = true;
+  DeterministicSeed = Seed;
+}
+
+/**
+  Run the backward pass as a task graph on Threads helper threads plus the training
+  thread: the delta weights of a layer are calculated while the node deltas of the
+  layer before it are. Pays off for deep or wide layouts, whose per-layer kernels
+  are long enough to outweigh the synchronization. 0(default) runs the backward
+  pass serially. Not used in reduced precision mode.
+
+  @param[in]  Threads  Number of helper threads.
+
+**/
+void
+BackPropagator::SetBackwardThreads (
+  const unsigned int  Threads
+  )
+{
+  BackwardThreads = Threads;
+  BackwardGraph.SetThreads (Threads);
+}
+
+/**
+  Apply the weight update of a batch on a background thread while the next batch
+  starts. The next batch's gradients are then calculated with the weights from
+  before that update, one update behind(staleness 1). All updates are in place at
+  the end of every epoch and before a checkpoint.
+
+  @param[in]  Pipelined  true to overlap the update with the next batch.
+
+**/
+void
+BackPropagator::SetPipelinedUpdate (
+  const bool  Pipelined
+  )
+{
+  PipelinedUpdate = Pipelined;
+}
+
+/**
+  Prepare the training inputs on Threads background threads, which fill the next
+  batch's buffer while the training thread works on the current one. Each epoch
+  reports how long training stalled waiting for inputs, and how long the threads
+  waited for a free buffer.
+
+  @param[in]  Threads  Number of input threads, 0(default) for none.
+
+**/
+void
+BackPropagator::SetInputThreads (
+  const unsigned int  Threads
+  )
+{
+  InputThreads = Threads;
+}
+
+/**
+  Change every training image at random while it is prepared: shift, rotate,
+  distort and add noise, each up to its maximum in Params. Only sources of byte
+  images can be changed, Train() throws for a MatrixDataSource or the vectors of
+  matrices. Validation samples are never changed. Runs on the input threads,
+  on one if SetInputThreads() set none. Every sample draws from its own random
+  stream keyed by the epoch, so a deterministic training stays deterministic.
+
+  @param[in]  Params  Largest change of each kind, all 0 turns augmentation off.
+
+  @throw  invalid_argument  Params are invalid, see ImageAugmenter::SetParams().
+
+**/
+void
+BackPropagator::SetAugmentation (
+  const AUGMENT_PARAMS  &Params
+  )
+{
+  Augmenter.SetParams (Params);
+}
+
+/**
+  Set the preprocessing the data sources apply to the inputs, so ExportToFile()
+  and the checkpoints save it with the model for inference. The data sources
+  convert the inputs themselves, see CompactDataSet::SetPreProcessor().
+
+  @param[in]  PreProcessor  The preprocessing, must stay valid while training. NULL for none.
+
+**/
+void
+BackPropagator::SetPreProcessor (
+  const InputPreProcessor  *PreProcessor
+  )
+{
+  this->PreProcessor = PreProcessor;
+}
+
+/**
+  Keep only every Interval-th layer's activation(and the output layer's) during
+  training, and recompute the others from the kept layer below them in the backward
+  pass. Trades activation memory for up to one extra forward pass per sample.
+  Only in double precision, Train() throws in a reduced precision mode with an
+  Interval above 1. Train() also throws when the kept activations and the buffers
+  to recompute the others hold as many values as keeping every layer, e.g. for a
+  network with one hidden layer. The backward pass runs serially.
+
+  @param[in]  Interval  Checkpoint interval, 1(default) keeps every layer.
+
+**/
+void
+BackPropagator::SetActivationCheckpointing (
+  const unsigned int  Interval
+  )
+{
+  if (Interval == 0) {
+    DEBUG_LOG ("Interval should at least be 1.");
+    throw invalid_argument ("BackPropagator::SetActivationCheckpointing (): Invalid Interval.");
+  }
+
+  ActivationCheckpointInterval = Interval;
+}
+
+/**
+  Split every layer's nodes into Shards row blocks, each computed by its own thread
+  for the whole training: its rows of the weighted sums and activations, its node
+  deltas and its rows of the delta weights. Only the activation and delta vectors
+  of a layer are shared at the layer boundary. Pays off for very wide layers whose
+  weights don't fit in one core's cache. Only in double precision, and not with
+  backward threads or activation checkpointing, Train() throws otherwise.
+
+  @param[in]  Shards  Number of threads per layer, 1(default) for none.
+
+**/
+void
+BackPropagator::SetModelShards (
+  const unsigned int  Shards
+  )
+{
+  if (Shards == 0) {
+    DEBUG_LOG ("Shards should at least be 1.");
+    throw invalid_argument ("BackPropagator::SetModelShards (): Invalid Shards.");
+  }
+
+  ModelShards = Shards;
+}
+
+/**
+  Freeze or unfreeze a weight layer, e.g. to fine-tune only the last layers of an
+  imported network. A frozen layer's weights aren't updated, and the backward pass
+  stops below the lowest layer that isn't frozen.
+
+  @param[in]  WeightLayer  Index of the weight layer, 0 is between the input layer and the first hidden layer.
+  @param[in]  Frozen       true to freeze the layer.
+
+**/
+void
+BackPropagator::SetLayerFrozen (
+  const unsigned int  WeightLayer,
+  const bool          Frozen
+  )
+{
+  if (WeightLayer >= (unsigned int)FrozenLayers.size()) {
+    DEBUG_LOG ("WeightLayer = " << WeightLayer << ", weight layers: " << FrozenLayers.size());
+    throw invalid_argument ("BackPropagator::SetLayerFrozen (): Invalid WeightLayer.");
+  }
+
+  FrozenLayers[WeightLayer] = Frozen;
+}
+
+/**
+  Cache the activation of the first trainable layer of every data sample during a
+  training, when the weight layers before it are frozen. Each sample passes the
+  frozen layers once, later epochs start the forward pass at the cached activation.
+  Takes one row of that layer's width per data sample, and only applies to double
+  precision without model shards, activation checkpointing or augmentation, as an
+  augmented sample's input differs every epoch.
+
+  @param[in]  Enable  true to cache the frozen layers' output.
+
+**/
+void
+BackPropagator::SetFrozenOutputCache (
+  const bool  Enable
+  )
+{
+  FrozenOutputCache = Enable;
+}
+
+/**
+  Get the best monitored loss(validation loss, or training loss without a validation set) of the last training.
+
+**/
+double
+BackPropagator::GetBestLoss (
+  ) const
+{
+  return BestLoss;
+}
+
+unsigned int
+BackPropagator::GetCompletedEpochs (
+  ) const
+{
+  return CompletedEpochs;
+}
+
 void
 BackPropagator::ShowTrainingParams (
   void
@@ -102,6 +536,80 @@ BackPropagator::ShowTrainingParams (
   if (TrainingMode == BATCH_MODE) {
     cout << "  Batch Size    : " << BatchSize << endl;
   }
+  WeightOptimizer.ShowInfo ();
+  Scheduler.ShowInfo ();
+  LowPrecision.ShowInfo ();
+  Augmenter.ShowInfo ();
+  if (PreProcessor != NULL) {
+    PreProcessor->ShowInfo ();
+  }
+  if (Deterministic) {
+    cout << "  Deterministic : seed " << DeterministicSeed << endl;
+  }
+  if (BackwardThreads != 0) {
+    cout << "  Backward      : task graph, " << BackwardThreads + 1 << " threads" << endl;
+  }
+  if (PipelinedUpdate) {
+    cout << "  Update        : pipelined, staleness 1" << endl;
+  }
+  if (find (FrozenLayers.begin (), FrozenLayers.end (), true) != FrozenLayers.end ()) {
+    cout << "  Frozen layers :";
+    for (unsigned int Layer = 0; Layer < (unsigned int)FrozenLayers.size(); Layer++) {
+      if (FrozenLayers[Layer]) {
+        cout << " " << Layer;
+      }
+    }
+    if (!Workspace.FrozenOutputReady.empty ()) {
+      cout << ", output of layer " << FirstTrainableLayer << " cached";
+    }
+    cout << endl;
+  }
+  if (ModelShards > 1) {
+    cout << "  Model shards  : " << ModelShards << " threads per layer" << endl;
+  }
+  if (UseInputFeed) {
+    cout << "  Input threads : " << InputFeed.GetThreads () << ", " << InputFeed.GetSlotCount () << " buffers of "
+         << InputFeed.GetChunkSize () << " samples" << endl;
+  }
+  if (ActivationCheckpointInterval > 1) {
+    const NETWORK_LAYOUT  &Layout = Network.GetLayout ();
+    unsigned int          LayerCount = (unsigned int)Layout.size();
+    size_t                FullValues = Layout[0];
+    size_t                KeptValues = TrainingWorkspace::GetCheckpointedValues (Layout, ActivationCheckpointInterval);
+    double                ForwardWork = 0.0;
+    double                RecomputeWork = 0.0;
+
+    for (unsigned int Layer = 1; Layer < LayerCount; Layer++) {
+      FullValues  += Layout[Layer];
+      ForwardWork += (double)Layout[Layer] * Layout[Layer - 1];
+      if (!TrainingWorkspace::IsActivationKept (Layer, LayerCount, ActivationCheckpointInterval)) {
+        RecomputeWork += (double)Layout[Layer] * Layout[Layer - 1];
+      }
+    }
+
+    cout << "  Activations   : every " << ActivationCheckpointInterval << " layers kept, "
+         << KeptValues << " of " << FullValues << " values per sample, +"
+         << RecomputeWork / ForwardWork * 100 << " % forward work" << endl;
+  }
+  if (ValidationSplit != 0.0) {
+    cout << "  Validation    : " << ValidationSplit * 100 << " % held out" << endl;
+  }
+  if (EarlyStopPatience != 0) {
+    cout << "  Early Stop    : patience " << EarlyStopPatience << ", min delta " << EarlyStopMinDelta << endl;
+  }
+  if (!CheckpointFileName.empty ()) {
+    cout << "  Checkpoint    : " << CheckpointFileName << ", every ";
+    if (CheckpointEveryEpochs != 0) {
+      cout << CheckpointEveryEpochs << " epochs ";
+    }
+    if (CheckpointEveryBatches != 0) {
+      cout << CheckpointEveryBatches << " batches";
+    }
+    cout << endl;
+  }
+  if (DataParallelGroup != NULL) {
+    cout << "  Data Parallel : rank " << DataParallelGroup->GetRank () << " of " << DataParallelGroup->GetWorldSize () << " workers" << endl;
+  }
 
   cout << "======================================" << endl;
 }
\ No newline at end of file
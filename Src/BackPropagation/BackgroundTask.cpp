@@ -0,0 +1,151 @@
+/**
+  Background task runner implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "BackgroundTask.h"
+#include "DebugLib.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+BackgroundTask::BackgroundTask (
+  ) : Submitted (false),
+      Running (false),
+      Stopping (false)
+{
+}
+
+BackgroundTask::~BackgroundTask (
+  )
+{
+  Stop ();
+}
+
+/**
+  Start the thread. Every Submit() afterwards runs Work on it.
+
+  @param[in]  Work  Function to run in the background.
+
+**/
+void
+BackgroundTask::Start (
+  function<void ()>  Work
+  )
+{
+  Stop ();
+
+  this->Work = Work;
+  Stopping   = false;
+  Worker     = thread (&BackgroundTask::WorkerLoop, this, GetHeapAllocationCounter ());
+}
+
+bool
+BackgroundTask::IsStarted (
+  ) const
+{
+  return Worker.joinable ();
+}
+
+/**
+  Start a run of the function. The previous run must have been waited for.
+
+**/
+void
+BackgroundTask::Submit (
+  void
+  )
+{
+  lock_guard<mutex>  Guard (Lock);
+
+  if (!Worker.joinable () || Submitted || Running) {
+    throw logic_error ("BackgroundTask::Submit (): Not started, or the previous run isn't waited for.");
+  }
+
+  Submitted = true;
+  Changed.notify_all ();
+}
+
+/**
+  Wait until the submitted run is done. Returns at once if nothing is submitted.
+
+  @throw  The exception thrown by the run.
+
+**/
+void
+BackgroundTask::Wait (
+  void
+  )
+{
+  unique_lock<mutex>  Guard (Lock);
+
+  Changed.wait (Guard, [this] { return !Submitted && !Running; });
+
+  if (Failure) {
+    exception_ptr  Error = Failure;
+
+    Failure = nullptr;
+    rethrow_exception (Error);
+  }
+}
+
+/**
+  Wait for the submitted run, then end the thread.
+
+**/
+void
+BackgroundTask::Stop (
+  void
+  )
+{
+  if (!Worker.joinable ()) {
+    return;
+  }
+
+  {
+    unique_lock<mutex>  Guard (Lock);
+
+    Changed.wait (Guard, [this] { return !Submitted && !Running; });
+    Stopping = true;
+  }
+  Changed.notify_all ();
+
+  Worker.join ();
+}
+
+void
+BackgroundTask::WorkerLoop (
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+  SetHeapAllocationCounter (Counter);
+
+  unique_lock<mutex>  Guard (Lock);
+
+  while (true) {
+    Changed.wait (Guard, [this] { return Stopping || Submitted; });
+    if (Stopping) {
+      return;
+    }
+
+    Submitted = false;
+    Running   = true;
+    Guard.unlock ();
+
+    try {
+      Work ();
+    }
+    catch (...) {
+      Guard.lock ();
+      Failure = current_exception ();
+      Guard.unlock ();
+    }
+
+    Guard.lock ();
+    Running = false;
+    Changed.notify_all ();
+  }
+}
@@ -0,0 +1,60 @@
+/**
+  Background task runner definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _BACKGROUND_TASK_H_
+#define _BACKGROUND_TASK_H_
+
+#include "AllocCounter.h"
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+//
+// Runs one fixed function on its own thread, once per Submit(), while the
+// submitting thread carries on. Wait() returns when the submitted run is done
+// and passes on an exception thrown by it. At most one run is in flight.
+//
+// Submit() and Wait() don't allocate, so they can be part of a steady-state
+// training step.
+//
+class BackgroundTask
+{
+  public:
+    BackgroundTask ();
+    ~BackgroundTask ();
+
+    void Start (
+      std::function<void ()>  Work
+      );
+
+    bool IsStarted () const;
+
+    void Submit ();
+
+    void Wait ();
+
+    void Stop ();
+
+  private:
+    void WorkerLoop (
+      HEAP_ALLOCATION_COUNTER  *Counter     // Allocation counter of the starting thread.
+      );
+
+    std::function<void ()>   Work;
+    std::thread              Worker;
+    std::mutex               Lock;
+    std::condition_variable  Changed;
+    bool                     Submitted;
+    bool                     Running;
+    bool                     Stopping;
+    std::exception_ptr       Failure;
+};
+
+#endif
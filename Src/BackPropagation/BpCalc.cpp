@@ -9,135 +9,187 @@
 #include "DebugLib.h"
 
 #include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
 using namespace std;
 
 /**
-  Calculate the delta value of each node in the last(output) layer.
+  Calculate the delta value of each node in the last(output) layer together with
+  the loss of the data sample, in a single pass over the output layer.
   Delta = (Desired - Actual) * f'(Actual), where f(x) is the activation function and
   f'(x) is the derivative of activation function.
+  Loss  = Sum( (Desired - Actual)^2 ) / N, the same Mean Square Error as LossMeanSquareError().
+  The delta is written into the workspace, no memory is allocated. A class target is
+  expanded to its one-hot values here, node by node.
 
-  @param[in]  DesiredOutput  A matrix representing the desired output values.
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
+
+  @return A double representing the loss value of the data sample.
 
 **/
-matrix
+double
 BackPropagator::CalculateLastLayerDelta (
-  matrix  DesiredOutput
+  const DESIRED_OUTPUT  &DesiredOutput
   )
 {
-  matrix        DesiredGap;
-  unsigned int  LastLayerIndex;
-
-  LastLayerIndex = (unsigned int)(Network.GetLayout().size() - 1);
-
-  DesiredGap = Substract (
-                 DesiredOutput,
-                 Network.GetActivationByLayer (LastLayerIndex)
-                 );
+  unsigned int     LastLayerIndex = (unsigned int)(Network.GetLayout().size() - 1);
+  ACTIVATION_FUNC  Derivative     = GetDeriativeActivationFunction (Network.GetActivationType ());
+  unsigned int     OutputSize     = Workspace.NodeDelta[LastLayerIndex].Size();
+  const double     *Desired       = (DesiredOutput.Values != NULL) ? DesiredOutput.Values->Data() : NULL;
+  const double     *Actual        = Workspace.Activation[LastLayerIndex].Data();
+  double           *Delta         = Workspace.NodeDelta[LastLayerIndex].Data();
+  double           SquareSum      = 0.0;
+
+  CheckDesiredOutput (DesiredOutput, OutputSize);
+
+  for (unsigned int Index = 0; Index < OutputSize; Index++) {
+    double  Target = (Desired != NULL) ? Desired[Index] : ((Index == DesiredOutput.Class) ? 1.0 : 0.0);
+    double  Gap    = Target - Actual[Index];
+
+    SquareSum    += Gap * Gap;
+    Delta[Index]  = Gap * Derivative (Actual[Index]);
+  }
 
-  return HadamardProduct (
-           DesiredGap,
-           Network.GetDerivativeActivationByLayer (LastLayerIndex)
-           );
+  return SquareSum / OutputSize;
 }
 
 /**
   Calculate the delta value of each node in a specific middle layer.
   Delta = (Weight^T * NextLayerDelta) * f'(CurrentLayerActivationValue), where f(x) is the activation function and
   f'(x) is the derivative of activation function.
+  The result is written into the workspace, no memory is allocated.
 
   @param[in]  Layer
 
 **/
-matrix
+void
 BackPropagator::CalculateMidLayerDelta (
   unsigned int  Layer
   )
 {
-  matrix  WeightedError;
-
   if (Layer > (unsigned int)(Network.GetLayout().size() - 2)) {
     DEBUG_LOG ("Layer " << Layer << " is not a middle layer.");
     throw runtime_error ("Layer passed into CalculateMidLayerDelta() is out of range.");
   }
 
-  WeightedError = multiply (
-                    transpose (Network.GetWeightByLayer(Layer)),
-                    NodeDelta[Layer + 1]
-                    );
+  CalculateMidLayerDeltaRows (Layer, 0, Network.GetLayout()[Layer]);
+}
+
+/**
+  Calculate the delta values of the nodes FirstNode to EndNode - 1 of a middle layer,
+  as CalculateMidLayerDelta() does for all of them. Reads the whole next layer delta.
 
-  return HadamardProduct (
-           WeightedError,
-           Network.GetDerivativeActivationByLayer (Layer)
-           );
+  @param[in]  Layer
+  @param[in]  FirstNode  First node to calculate.
+  @param[in]  EndNode    Node after the last node to calculate.
+
+**/
+void
+BackPropagator::CalculateMidLayerDeltaRows (
+  unsigned int  Layer,
+  unsigned int  FirstNode,
+  unsigned int  EndNode
+  )
+{
+  TransposeMultiplyRowsInto (
+    Network.GetWeightsRef ()[Layer],
+    Workspace.NodeDelta[Layer + 1],
+    Workspace.NodeDelta[Layer],
+    FirstNode,
+    EndNode
+    );
+
+  ACTIVATION_FUNC  Derivative  = GetDeriativeActivationFunction (Network.GetActivationType ());
+  const double     *Activation = Workspace.Activation[Layer].Data();
+  double           *Delta      = Workspace.NodeDelta[Layer].Data();
+
+  for (unsigned int Index = FirstNode; Index < EndNode; Index++) {
+    Delta[Index] *= Derivative (Activation[Index]);
+  }
 }
 
 /**
   Calculate the delta value of each node in all layers except the first(input) layer.
 
-  @param[in]  DesiredOutput  A matrix representing the desired output values.
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
+
+  @return A double representing the loss value of the data sample.
 
 **/
-void BackPropagator::NodeDeltaCalculation (
-  const matrix  &DesiredOutput
+double BackPropagator::NodeDeltaCalculation (
+  const DESIRED_OUTPUT  &DesiredOutput
   )
 {
-  matrix        NodeDeltaOfLayer;
   unsigned int  LastLayerIndex = (unsigned int)(Network.GetLayout().size() - 1);
+  double        Loss;
 
-  NodeDeltaOfLayer = CalculateLastLayerDelta (DesiredOutput);
-  NodeDelta[LastLayerIndex] = NodeDeltaOfLayer;
+  Loss = CalculateLastLayerDelta (DesiredOutput);
 
   //
   // Calculate delta for all nodes in all layer except last layer.
-  // Note: It's unnecessary to calculate the delta value of the first(input) layer(LayerIdx = 0).
+  // Note: It's unnecessary to calculate the delta value of the first(input) layer(LayerIdx = 0),
+  //       or of the layers below the lowest trainable weight layer.
   //
   for (unsigned int LayerIdx = LastLayerIndex - 1;
-       LayerIdx > 0;
+       LayerIdx > FirstTrainableLayer;
        LayerIdx--) {
-    NodeDeltaOfLayer = CalculateMidLayerDelta (LayerIdx);
-    NodeDelta[LayerIdx] = NodeDeltaOfLayer;
+    CalculateMidLayerDelta (LayerIdx);
   }
 
   // DEBUG_START()
   // PrintNodeDelta ();
   // DEBUG_END()
+
+  return Loss;
 }
 
 /**
-  Calculate the delta value of each node in all layers except the first(input) layer.
+  Calculate the delta weights(descent direction of the loss) between each layers
+  for the current data sample and add them to the batch delta weights in place:
+  BatchDeltaWeights(Layer) += NextLayerDelta * CurrentLayerActivation^T.
+  The learning rate is applied later by the optimizer when the batch is committed.
+  Frozen layers are skipped, their delta weights stay zero.
 
-  @param[in]  DesiredOutput  A matrix representing the desired output values.
+  @param[in]  FirstLayer  First weight layer to calculate, layers before it are
+                          calculated by the caller for the whole batch.
 
 **/
 void
 BackPropagator::DeltaWeightsCalculation (
-  double  LearningRate
+  unsigned int  FirstLayer
   )
 {
   unsigned int  WeightsLayerCount = ((unsigned int)Network.GetLayout().size() - 1);
 
-  DeltaWeights.clear();
-
-  for (unsigned int LayerIdx = 0; LayerIdx < WeightsLayerCount; LayerIdx++) {
-    matrix  CurrentLayerActivation_T = transpose (Network.GetActivationByLayer (LayerIdx));
-    matrix  NextLayerDelta           = NodeDelta[LayerIdx + 1];
-
-    matrix  Gradient = multiply (NextLayerDelta, CurrentLayerActivation_T);
-  
-    matrix  DeltaWeight = multiplyBy (Gradient, LearningRate);
-
-    DeltaWeights.push_back (DeltaWeight);
+  for (unsigned int LayerIdx = FirstLayer; LayerIdx < WeightsLayerCount; LayerIdx++) {
+    if (FrozenLayers[LayerIdx]) {
+      continue;
+    }
+    AddOuterProduct (
+      Workspace.NodeDelta[LayerIdx + 1],
+      Workspace.Activation[LayerIdx],
+      Workspace.BatchDeltaWeights[LayerIdx]
+      );
   }
 }
 
 /**
-  Update the weights of the network by applying the calculated delta weights.
+  Update the weights of the network by applying one optimizer step with the
+  accumulated delta weights of a batch. Averaging over the batch is folded
+  into the optimizer's update pass.
+
+  @param[in]  DeltaWeights  Delta weights of each layer, summed over the batch.
+  @param[in]  LearningRate  Step size of this update.
+  @param[in]  SampleCount   Number of data samples accumulated in DeltaWeights.
 
 **/
 void
 BackPropagator::UpdateWeights (
-  vector<matrix>  DeltaWeights
+  const vector<matrix>  &DeltaWeights,
+  const double          LearningRate,
+  const unsigned int    SampleCount
   )
 {
   if (DeltaWeights.empty () ||
@@ -147,108 +199,377 @@ BackPropagator::UpdateWeights (
     return;
   }
 
-  Network.UpdateWeight (DeltaWeights);
+  if (SampleCount == 0) {
+    DEBUG_LOG ("Sample count is 0, failed to calculate average.");
+    throw runtime_error ("Failed to calculate average if dividing 0.");
+  }
+
+  Network.UpdateWeight (
+            WeightOptimizer,
+            DeltaWeights,
+            LearningRate,
+            1 / (double)SampleCount
+            );
 }
 
 /**
-  Update the batch mode delta weights by adding the current delta weights.
+  Build the task graph of the backward pass for the network layout:
+
+    Delta(Last) -> Delta(Last - 1) -> ... -> Delta(1)
+         |               |                      |
+    Grad(Last - 1)  Grad(Last - 2)           Grad(0)
+
+  Delta(L) calculates the node deltas of layer L, Grad(L) adds the delta weights of
+  weight layer L, which only need Delta(L + 1). So Grad(L) can run while Delta(L - 1)
+  does. The tasks write different buffers, so the result doesn't depend on the schedule.
 
 **/
 void
-BackPropagator::UpdateBatchDeltaWeights (
+BackPropagator::BuildBackwardGraph (
   void
   )
 {
-  if (DeltaWeights.size() != BatchDeltaWeights.size()) {
-    DEBUG_LOG ("DeltaWeights has size = " << DeltaWeights.size());
-    DEBUG_LOG ("BatchDeltaWeights has size = " << BatchDeltaWeights.size());
-    throw runtime_error ("Failed to update batch delta weights.");
+  unsigned int          LastLayerIndex = (unsigned int)(Network.GetLayout().size() - 1);
+  vector<unsigned int>  DeltaTask (LastLayerIndex + 1);
+
+  BackwardGraph.Clear ();
+
+  DeltaTask[LastLayerIndex] = BackwardGraph.AddTask ([this] {
+                                GraphLoss = CalculateLastLayerDelta (*GraphDesiredOutput);
+                              });
+
+  for (unsigned int LayerIdx = LastLayerIndex - 1; LayerIdx > FirstTrainableLayer; LayerIdx--) {
+    DeltaTask[LayerIdx] = BackwardGraph.AddTask ([this, LayerIdx] {
+                            CalculateMidLayerDelta (LayerIdx);
+                          });
+    //
+    // Node deltas are the critical path, make them ready before the delta weights.
+    //
+    BackwardGraph.AddDependency (DeltaTask[LayerIdx + 1], DeltaTask[LayerIdx]);
+  }
+
+  for (unsigned int LayerIdx = LastLayerIndex; LayerIdx > FirstTrainableLayer; LayerIdx--) {
+    if (FrozenLayers[LayerIdx - 1]) {
+      continue;
+    }
+
+    unsigned int  GradTask = BackwardGraph.AddTask ([this, LayerIdx] {
+                               AddOuterProduct (
+                                 Workspace.NodeDelta[LayerIdx],
+                                 Workspace.Activation[LayerIdx - 1],
+                                 Workspace.BatchDeltaWeights[LayerIdx - 1]
+                                 );
+                             });
+
+    BackwardGraph.AddDependency (DeltaTask[LayerIdx], GradTask);
   }
+}
+
+/**
+  Perform the backward pass of back propagation algorithm, which includes following steps:
+  1. Calculate node deltas
+  2. Calculate delta weights and accumulate them into the batch
+  With backward threads, both run as the task graph of BuildBackwardGraph().
+
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
 
-  for (unsigned int Index = 0; Index < BatchDeltaWeights.size(); Index++) {
-    BatchDeltaWeights[Index] = add (BatchDeltaWeights[Index], DeltaWeights[Index]);
+  @return A double representing the loss value of the data sample, computed
+          together with the output layer delta.
+
+**/
+double
+BackPropagator::BackwardPass (
+  const DESIRED_OUTPUT  &DesiredOutput
+  )
+{
+  double  Loss;
+
+  if (BackwardThreads != 0) {
+    GraphDesiredOutput = &DesiredOutput;
+    BackwardGraph.Run ();
+    return GraphLoss;
   }
+
+  Loss = NodeDeltaCalculation (DesiredOutput);
+
+  DeltaWeightsCalculation (0);
+
+  return Loss;
 }
 
 /**
-  Calculate the average of delta weights of a batch.
-  The count of training data samples in the batch is specified by TotalTrainDataSetCount.
+  Forward pass under activation checkpointing. Only the kept layers' activations
+  are written to the workspace, the layers between them alternate between the
+  first two scratch buffers(one if no two dropped layers are adjacent).
 
-  @param[in]  TotalTrainDataSetCount  Total number of training data samples.
+  @param[in]  InputData  A matrix representing the input data.
 
 **/
 void
-BackPropagator::AverageBatchDeltaWeights (
-  unsigned int  TotalTrainDataSetCount
+BackPropagator::ForwardCheckpointed (
+  const matrix  &InputData
   )
 {
-  if (TotalTrainDataSetCount == 0) {
-    DEBUG_LOG ("Total train data set count is 0, failed to calculate average.");
-    throw runtime_error ("Failed to calculate average if dividing 0.");
+  const NETWORK_LAYOUT  &Layout = Network.GetLayout ();
+  const vector<matrix>  &Weights = Network.GetWeightsRef ();
+  unsigned int          LayerCount = (unsigned int)Layout.size();
+  ACTIVATION_FUNC       ActivationFunction = GetActivationFunction (Network.GetActivationType ());
+  const matrix          *Source = &Workspace.Activation[0];
+
+  if (InputData.Size() != Layout[0]) {
+    DEBUG_LOG ("Input size = " << InputData.Size() << ", expected " << Layout[0]);
+    throw invalid_argument ("Input data size does not match input layer size.");
   }
+  memcpy (Workspace.Activation[0].Data(), InputData.Data(), Layout[0] * sizeof (double));
+
+  for (unsigned int LayerIdx = 1; LayerIdx < LayerCount; LayerIdx++) {
+    matrix  *Target;
+
+    if (TrainingWorkspace::IsActivationKept (LayerIdx, LayerCount, ActivationCheckpointInterval)) {
+      Target = &Workspace.Activation[LayerIdx];
+    } else {
+      Target = &Workspace.CheckpointScratch[(LayerIdx % ActivationCheckpointInterval - 1) % 2];
+      Target->Resize (Layout[LayerIdx], 1);
+    }
 
-  if (TotalTrainDataSetCount == 1) {
+    MultiplyInto (Weights[LayerIdx - 1], *Source, *Target);
+
+    double  *Z = Target->Data();
+    for (unsigned int Index = 0; Index < Layout[LayerIdx]; Index++) {
+      Z[Index] = ActivationFunction (Z[Index]);
+    }
+
+    Source = Target;
+  }
+}
+
+/**
+  Backward pass under activation checkpointing, after ForwardCheckpointed().
+  Goes down one segment between two kept layers at a time: the segment's
+  activations are recomputed from the kept layer below it into the scratch buffers,
+  then its node deltas and delta weights are calculated as in BackwardPass().
+  The results are the same as without checkpointing.
+
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
+
+  @return A double representing the loss value of the data sample.
+
+**/
+double
+BackPropagator::BackwardPassCheckpointed (
+  const DESIRED_OUTPUT  &DesiredOutput
+  )
+{
+  const NETWORK_LAYOUT  &Layout = Network.GetLayout ();
+  const vector<matrix>  &Weights = Network.GetWeightsRef ();
+  vector<matrix>        &Activation = Workspace.Activation;
+  unsigned int          LastLayerIndex = (unsigned int)(Layout.size() - 1);
+  unsigned int          Interval = ActivationCheckpointInterval;
+  ACTIVATION_FUNC       ActivationFunction = GetActivationFunction (Network.GetActivationType ());
+  double                Loss;
+
+  Loss = CalculateLastLayerDelta (DesiredOutput);
+
+  for (unsigned int Top = LastLayerIndex; Top > FirstTrainableLayer; ) {
+    unsigned int  Base = ((Top - 1) / Interval) * Interval;
+
+    //
+    // Layers Base and Top are kept, recompute the ones between them.
+    //
+    for (unsigned int LayerIdx = Base + 1; LayerIdx < Top; LayerIdx++) {
+      Workspace.CheckpointScratch[LayerIdx - Base - 1].Resize (Layout[LayerIdx], 1);
+      swap (Activation[LayerIdx], Workspace.CheckpointScratch[LayerIdx - Base - 1]);
+
+      MultiplyInto (Weights[LayerIdx - 1], Activation[LayerIdx - 1], Activation[LayerIdx]);
+
+      double  *Z = Activation[LayerIdx].Data();
+      for (unsigned int Index = 0; Index < Layout[LayerIdx]; Index++) {
+        Z[Index] = ActivationFunction (Z[Index]);
+      }
+    }
+
+    for (unsigned int LayerIdx = Top; LayerIdx-- > max (Base, FirstTrainableLayer); ) {
+      if (LayerIdx > FirstTrainableLayer) {
+        CalculateMidLayerDelta (LayerIdx);
+      }
+      if (!FrozenLayers[LayerIdx]) {
+        AddOuterProduct (
+          Workspace.NodeDelta[LayerIdx + 1],
+          Activation[LayerIdx],
+          Workspace.BatchDeltaWeights[LayerIdx]
+          );
+      }
+    }
+
+    for (unsigned int LayerIdx = Base + 1; LayerIdx < Top; LayerIdx++) {
+      swap (Activation[LayerIdx], Workspace.CheckpointScratch[LayerIdx - Base - 1]);
+    }
+
+    Top = Base;
+  }
+
+  return Loss;
+}
+
+/**
+  One shard's part of a training step with model shards, run by every member of
+  ShardTeam. Shard S owns the same block of nodes of every layer:
+
+  Forward  : its rows of each layer's activation, from the whole layer below.
+  Backward : its rows of the delta weights into the layer, then its node deltas
+             of the layer below, from the whole delta of the layer.
+
+  The members sync at every layer boundary, after which the layer's activation or
+  delta vector is complete. Each element is calculated as in the serial passes.
+
+  @param[in]  Shard  Member number in ShardTeam.
+
+**/
+void
+BackPropagator::ShardedPass (
+  unsigned int  Shard
+  )
+{
+  const NETWORK_LAYOUT  &Layout = Network.GetLayout ();
+  const vector<matrix>  &Weights = Network.GetWeightsRef ();
+  vector<matrix>        &Activation = Workspace.Activation;
+  unsigned int          LastLayerIndex = (unsigned int)(Layout.size() - 1);
+  unsigned int          Shards = ShardTeam.GetSize ();
+  ACTIVATION_FUNC       ActivationFunction = GetActivationFunction (Network.GetActivationType ());
+
+  for (unsigned int LayerIdx = 1; LayerIdx <= LastLayerIndex; LayerIdx++) {
+    unsigned int  FirstNode = (unsigned int)((u_int64_t)Layout[LayerIdx] * Shard / Shards);
+    unsigned int  EndNode   = (unsigned int)((u_int64_t)Layout[LayerIdx] * (Shard + 1) / Shards);
+
+    MultiplyRowsInto (Weights[LayerIdx - 1], Activation[LayerIdx - 1], Activation[LayerIdx], FirstNode, EndNode);
+
+    double  *Z = Activation[LayerIdx].Data();
+    for (unsigned int Index = FirstNode; Index < EndNode; Index++) {
+      Z[Index] = ActivationFunction (Z[Index]);
+    }
+
+    ShardTeam.Sync ();
+  }
+
+  if (ShardDesiredOutput == NULL) {
     return;
   }
 
-  for (unsigned int Index = 0; Index < (unsigned int)BatchDeltaWeights.size(); Index++) {
-    BatchDeltaWeights[Index] = multiplyBy (BatchDeltaWeights[Index], 1 / (double)TotalTrainDataSetCount);
+  //
+  // The output layer is narrow, one shard calculates its delta and the loss.
+  //
+  if (Shard == 0) {
+    ShardLoss = CalculateLastLayerDelta (*ShardDesiredOutput);
+  }
+  ShardTeam.Sync ();
+
+  for (unsigned int LayerIdx = LastLayerIndex; LayerIdx > FirstTrainableLayer; LayerIdx--) {
+    unsigned int  FirstNode = (unsigned int)((u_int64_t)Layout[LayerIdx] * Shard / Shards);
+    unsigned int  EndNode   = (unsigned int)((u_int64_t)Layout[LayerIdx] * (Shard + 1) / Shards);
+
+    if (!FrozenLayers[LayerIdx - 1]) {
+      AddOuterProductRows (
+        Workspace.NodeDelta[LayerIdx],
+        Activation[LayerIdx - 1],
+        Workspace.BatchDeltaWeights[LayerIdx - 1],
+        FirstNode,
+        EndNode
+        );
+    }
+
+    if (LayerIdx - 1 > FirstTrainableLayer) {
+      CalculateMidLayerDeltaRows (
+        LayerIdx - 1,
+        (unsigned int)((u_int64_t)Layout[LayerIdx - 1] * Shard / Shards),
+        (unsigned int)((u_int64_t)Layout[LayerIdx - 1] * (Shard + 1) / Shards)
+        );
+      ShardTeam.Sync ();
+    }
   }
 }
 
 /**
-  Perform the backward pass of back propagation algorithm, which includes following steps:
-  1. Calculate node deltas
-  2. Calculate delta weights
-  3. Update the network weights
+  Forward pass of the network with model shards.
 
-  @param[in]  DesiredOutput  A matrix representing the desired output values.
-  @param[in]  LearningRate   A double representing the learning rate for weight updates.
+  @param[in]  InputData  A matrix representing the input data.
 
 **/
 void
-BackPropagator::BackwardPass (
-  const matrix &DesiredOutput,
-  const double LearningRate
+BackPropagator::ShardedForward (
+  const matrix  &InputData
   )
 {
-  NodeDeltaCalculation (DesiredOutput);
+  unsigned int  InputSize = Network.GetLayout ()[0];
 
-  DeltaWeightsCalculation (LearningRate);
+  if (InputData.Size() != InputSize) {
+    DEBUG_LOG ("Input size = " << InputData.Size() << ", expected " << InputSize);
+    throw invalid_argument ("Input data size does not match input layer size.");
+  }
+  memcpy (Workspace.Activation[0].Data(), InputData.Data(), InputSize * sizeof (double));
 
-  UpdateBatchDeltaWeights ();
+  ShardDesiredOutput = NULL;
+  ShardTeam.Run ();
 }
 
+/**
+  Forward and backward pass of one data sample with model shards.
+
+  @param[in]  InputData      A matrix representing the input data.
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
+
+  @return A double representing the loss value of the data sample.
+
+**/
 double
-InternalSquare (
-  double  x
+BackPropagator::ShardedTrainOneData (
+  const matrix          &InputData,
+  const DESIRED_OUTPUT  &DesiredOutput
   )
 {
-  return pow(x, 2.0);
+  unsigned int  InputSize = Network.GetLayout ()[0];
+
+  if (InputData.Size() != InputSize) {
+    DEBUG_LOG ("Input size = " << InputData.Size() << ", expected " << InputSize);
+    throw invalid_argument ("Input data size does not match input layer size.");
+  }
+  memcpy (Workspace.Activation[0].Data(), InputData.Data(), InputSize * sizeof (double));
+
+  ShardDesiredOutput = &DesiredOutput;
+  ShardTeam.Run ();
+
+  return ShardLoss;
 }
 
 /**
   Calculate the loss value of the network based on the desired output.
+  Only used where no backward pass follows(e.g. validation), training gets the
+  loss from CalculateLastLayerDelta().
   Here we use Mean Square Error(MSE) as the loss function.
   The formula is: Loss = Sum( (Desired - Actual)^2 ) / N, where N is the number of output nodes.
 
-  @param[in]  DesiredOutput  A matrix representing the desired output values.
+  @param[in]  DesiredOutput  The desired output values, or the output node of a class.
 
   @return A double representing the calculated loss value.
 
 **/
 double
 BackPropagator::LossMeanSquareError (
-  const matrix  &DesiredOutput
+  const DESIRED_OUTPUT  &DesiredOutput
   )
 {
-  matrix                   DesiredGap;
-  function<double(double)> Square = InternalSquare;
+  unsigned int  LastLayerIndex = (unsigned int)(Network.GetLayout().size() - 1);
+  unsigned int  OutputSize     = Workspace.Activation[LastLayerIndex].Size();
+  const double  *Desired       = (DesiredOutput.Values != NULL) ? DesiredOutput.Values->Data() : NULL;
+  const double  *Actual        = Workspace.Activation[LastLayerIndex].Data();
+  double        SquareSum      = 0.0;
+
+  CheckDesiredOutput (DesiredOutput, OutputSize);
 
-  DesiredGap = Substract (
-                 DesiredOutput,
-                 Network.GetActivationByLayer (Network.GetLayout().size() - 1)
-                 );
+  for (unsigned int Index = 0; Index < OutputSize; Index++) {
+    double  Target = (Desired != NULL) ? Desired[Index] : ((Index == DesiredOutput.Class) ? 1.0 : 0.0);
+    double  Gap    = Target - Actual[Index];
+    SquareSum += Gap * Gap;
+  }
 
-  return DesiredGap.ApplyElementWise (Square).Sum() / DesiredOutput.getrow();
+  return SquareSum / OutputSize;
 }
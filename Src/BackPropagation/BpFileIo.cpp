@@ -0,0 +1,334 @@
+/**
+  BackPropagator file input/output implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "BackPropagator.h"
+#include "DebugLib.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+
+/**
+  Export the network to a file, followed by the optimizer state and the input
+  preprocessing, if there is one. The file can still be imported by
+  FullyConnectedNetwork(std::string), which ignores the sections appended after
+  the weights.
+
+  @param  FilePath  The directory to export the file to.
+  @param  FileName  The name of the file, "FCN_Network.dat" if empty.
+
+**/
+void
+BackPropagator::ExportToFile (
+  string  FilePath,
+  string  FileName
+  )
+{
+  fstream  fs;
+  string   FullFileName;
+
+  FullFileName = FilePath + "/" + (FileName.empty() ? "FCN_Network.dat" : FileName);
+
+  Network.ExportToFile (FilePath, FileName);
+
+  fs.open (FullFileName, ios::out | ios::binary | ios::app);
+  if (!fs) {
+    DEBUG_LOG ("Failed to open file: " << FullFileName << " in binary append mode");
+    throw std::runtime_error("BackPropagator::ExportToFile: File opening error");
+  }
+
+  WeightOptimizer.ExportState (fs);
+  if (PreProcessor != NULL) {
+    PreProcessor->ExportToStream (fs);
+  }
+
+  fs.close ();
+}
+
+/**
+  Check that the network section at the start of a file matches the layout
+  of a network, and get the size of the section.
+
+  @param  fs      The file stream, positioned at the start of the file.
+  @param  Layout  Number of nodes in each layer of the network.
+
+  @return  Size of the network header and weights in bytes.
+
+  @throw  std::runtime_error  The file doesn't start with a network matching Layout.
+
+**/
+static
+streamoff
+CheckNetworkSection (
+  fstream                     &fs,
+  const vector<unsigned int>  &Layout
+  )
+{
+  NETWORK_FILE  FileHeader;
+  streamoff     WeightsSize = 0;
+
+  fs.read (reinterpret_cast<char *>(&FileHeader), sizeof(NETWORK_FILE) - sizeof(u_int32_t));
+  if (!fs ||
+      (FileHeader.Signature != NETWORK_FILE_SIGNATURE) ||
+      (FileHeader.NumOfLayers != (u_int32_t)Layout.size())) {
+    DEBUG_LOG ("Signature = " << std::hex << FileHeader.Signature << ", NumOfLayers = " << std::dec << FileHeader.NumOfLayers);
+    throw std::runtime_error("Network in file doesn't match");
+  }
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    u_int32_t  Nodes;
+
+    fs.read (reinterpret_cast<char *>(&Nodes), sizeof(u_int32_t));
+    if (!fs || Nodes != Layout[Index]) {
+      DEBUG_LOG ("Layer " << Index << " has " << Nodes << " nodes in file, " << Layout[Index] << " in network");
+      throw std::runtime_error("Network in file doesn't match");
+    }
+    if (Index != 0) {
+      WeightsSize += (streamoff)Layout[Index - 1] * Layout[Index] * sizeof(double);
+    }
+  }
+
+  return FileHeader.HdrSize + WeightsSize;
+}
+
+/**
+  Get the bytes of a set of weights in a file, all layers one after the other.
+
+**/
+static
+streamoff
+GetWeightsSize (
+  const vector<matrix>  &Weights
+  )
+{
+  streamoff  WeightsSize = 0;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Weights.size (); Index++) {
+    WeightsSize += (streamoff)(Weights[Index].Size () * sizeof (double));
+  }
+
+  return WeightsSize;
+}
+
+/**
+  Import the optimizer state from a file exported by BackPropagator::ExportToFile().
+  The network weights in the file are skipped, they are expected to be already
+  loaded into the associated network.
+
+  @param  FileName  The name of the file to import the optimizer state from.
+
+  @throw  std::runtime_error  The file can't be opened, its layout doesn't match the
+                              network, or it has no optimizer state.
+
+**/
+void
+BackPropagator::ImportOptimizerState (
+  string  FileName
+  )
+{
+  fstream               fs;
+  vector<unsigned int>  Layout = Network.GetLayout ();
+
+  fs.open (FileName, ios::in | ios::binary);
+  if (!fs) {
+    DEBUG_LOG ("Failed to open file: " << FileName << " in binary read mode");
+    throw std::runtime_error("ImportOptimizerState: File opening error");
+  }
+
+  fs.seekg (CheckNetworkSection (fs, Layout), ios::beg);
+
+  WeightOptimizer.ImportState (fs, Layout);
+
+  fs.close ();
+}
+
+/**
+  Import the input preprocessing saved with the network, from a file exported by
+  BackPropagator::ExportToFile() or a checkpoint, so inputs for inference can be
+  converted the way the network was trained.
+
+  @param  FileName      The name of the file.
+  @param  PreProcessor  Receives the preprocessing.
+
+  @throw  std::runtime_error  The file can't be opened, its layout doesn't match the
+                              network, or it has no preprocessing.
+
+**/
+void
+BackPropagator::ImportPreProcessor (
+  string             FileName,
+  InputPreProcessor  &PreProcessor
+  )
+{
+  fstream               fs;
+  vector<unsigned int>  Layout = Network.GetLayout ();
+  Optimizer             SkippedOptimizer;
+  u_int32_t             Signature;
+
+  fs.open (FileName, ios::in | ios::binary);
+  if (!fs) {
+    DEBUG_LOG ("Failed to open file: " << FileName << " in binary read mode");
+    throw std::runtime_error("ImportPreProcessor: File opening error");
+  }
+
+  fs.seekg (CheckNetworkSection (fs, Layout), ios::beg);
+  SkippedOptimizer.ImportState (fs, Layout);
+
+  //
+  // A checkpoint has the training progress and maybe the best weights before the preprocessing.
+  //
+  fs.read (reinterpret_cast<char *>(&Signature), sizeof (Signature));
+  fs.seekg (-(streamoff)sizeof (Signature), ios::cur);
+  if (fs && (Signature == TRAINING_STATE_FILE_SIGNATURE)) {
+    TRAINING_STATE_FILE  State;
+
+    fs.read (reinterpret_cast<char *>(&State), sizeof (State));
+    if (State.HasBestWeights != 0) {
+      fs.seekg (GetWeightsSize (Network.GetWeightsRef ()), ios::cur);
+    }
+  }
+
+  PreProcessor.ImportFromStream (fs);
+
+  fs.close ();
+}
+
+/**
+  Serialize the weights, optimizer state, training progress, best weights and preprocessing,
+  and hand them to the checkpoint writer thread. Nothing to do if the writer isn't
+  started.
+
+**/
+void
+BackPropagator::SaveCheckpoint (
+  void
+  )
+{
+  TRAINING_STATE_FILE  State;
+  ostringstream        Stream;
+
+  //
+  // The snapshot must include a pipelined update still in flight.
+  //
+  FinishPendingUpdate ();
+
+  if (!CheckpointWriter.IsStarted ()) {
+    return;
+  }
+
+  memset (&State, 0, sizeof (State));
+
+  State.Signature      = TRAINING_STATE_FILE_SIGNATURE;
+  State.HdrSize        = sizeof (TRAINING_STATE_FILE);
+  State.Epoch          = CompletedEpochs;
+  State.BestEpoch      = BestEpoch;
+  State.BatchCount     = BatchCount;
+  State.BestLoss       = BestLoss;
+  State.LossScale      = LowPrecision.GetLossScale ();
+  State.HasBestWeights = BestWeights.empty () ? 0 : 1;
+  Scheduler.GetPlateauState (State.PlateauLearningRate, State.PlateauBestLoss, State.PlateauBadEpochs);
+
+  Network.ExportToStream (Stream);
+  WeightOptimizer.ExportState (Stream);
+  Stream.write (reinterpret_cast<const char *>(&State), sizeof (State));
+  for (unsigned int Index = 0; Index < (unsigned int)BestWeights.size (); Index++) {
+    Stream.write (reinterpret_cast<const char *>(BestWeights[Index].Data ()), BestWeights[Index].Size () * sizeof (double));
+  }
+  if (PreProcessor != NULL) {
+    PreProcessor->ExportToStream (Stream);
+  }
+
+  CheckpointBuffer = Stream.str ();
+  CheckpointWriter.Submit (CheckpointBuffer);
+}
+
+/**
+  Load the weights, optimizer state and training progress from a checkpoint, so the
+  next Train() continues with the epoch after the checkpointed one. A checkpoint taken
+  inside an epoch resumes from the start of that epoch with the weights of the checkpoint.
+
+  @param  FileName  Checkpoint file given to SetCheckpoint().
+
+  @retval  true   Training state is restored.
+  @retval  false  There is no checkpoint file, nothing is changed.
+
+  @throw  std::runtime_error  The checkpoint doesn't match the network or is truncated.
+
+**/
+bool
+BackPropagator::ResumeFromCheckpoint (
+  const string  &FileName
+  )
+{
+  fstream               fs;
+  vector<unsigned int>  Layout = Network.GetLayout ();
+  vector<matrix>        Weights = Network.GetWeights ();
+  TRAINING_STATE_FILE   State;
+
+  fs.open (FileName, ios::in | ios::binary);
+  if (!fs) {
+    return false;
+  }
+
+  //
+  // Weights are at the end of the network section.
+  //
+  streamoff  SectionSize = CheckNetworkSection (fs, Layout);
+
+  fs.seekg (SectionSize - GetWeightsSize (Weights), ios::beg);
+  for (unsigned int Index = 0; Index < (unsigned int)Weights.size (); Index++) {
+    fs.read (reinterpret_cast<char *>(Weights[Index].Data ()), Weights[Index].Size () * sizeof (double));
+  }
+
+  WeightOptimizer.ImportState (fs, Layout);
+
+  fs.read (reinterpret_cast<char *>(&State), sizeof (State));
+  if (!fs ||
+      (State.Signature != TRAINING_STATE_FILE_SIGNATURE) ||
+      (State.HdrSize != sizeof (TRAINING_STATE_FILE))) {
+    DEBUG_LOG ("Training state section is missing or invalid in " << FileName);
+    throw std::runtime_error("ResumeFromCheckpoint: Invalid checkpoint file");
+  }
+
+  //
+  // The best weights, so early stopping can still go back to an epoch before the checkpoint.
+  //
+  vector<matrix>  Best;
+
+  if (State.HasBestWeights != 0) {
+    Best = Weights;
+    for (unsigned int Index = 0; Index < (unsigned int)Best.size (); Index++) {
+      fs.read (reinterpret_cast<char *>(Best[Index].Data ()), Best[Index].Size () * sizeof (double));
+    }
+    if (!fs) {
+      DEBUG_LOG ("Best weights are truncated in " << FileName);
+      throw std::runtime_error("ResumeFromCheckpoint: Invalid checkpoint file");
+    }
+  }
+
+  Network.SetWeights (Weights);
+  BestWeights.swap (Best);
+
+  if (State.LossScale > 0.0) {
+    LowPrecision.SetLossScale (State.LossScale, LowPrecision.IsDynamicLossScale ());
+  }
+
+  CompletedEpochs    = State.Epoch;
+  BatchCount         = State.BatchCount;
+  BestLoss           = State.BestLoss;
+  BestEpoch          = State.BestEpoch;
+  ResumeLearningRate = State.PlateauLearningRate;
+  ResumeBestLoss     = State.PlateauBestLoss;
+  ResumeBadEpochs    = State.PlateauBadEpochs;
+  Resumed            = true;
+
+  fs.close ();
+
+  return true;
+}
@@ -9,6 +9,7 @@
 #include <vector>
 #include <fstream>
 #include <stdio.h>
+#include <algorithm>
 
 #include "BpMisc.h"
  
@@ -63,6 +64,53 @@ ValueInVector (
   return ValueInVector (VectorToSearch, Value, NULL);
 }
 
+/**
+  Build the lookup table from a byte label to its output node, the position of
+  the label in LabelsToRead. A label listed twice keeps its first position, and
+  labels from LABEL_COUNT_MAX up are never trained.
+
+  @param[in]   LabelsToRead  The vector of labels to be trained.
+  @param[out]  Map           The output node of every label.
+
+**/
+void
+BuildLabelMap (
+  const vector<unsigned int>  &LabelsToRead,
+  LABEL_MAP                   &Map
+  )
+{
+  fill (Map.OutputIndex, Map.OutputIndex + LABEL_COUNT_MAX, LABEL_NOT_TRAINED);
+
+  for (unsigned int Index = (unsigned int)LabelsToRead.size (); Index > 0; Index--) {
+    if (LabelsToRead[Index - 1] < LABEL_COUNT_MAX) {
+      Map.OutputIndex[LabelsToRead[Index - 1]] = (u_int16_t)(Index - 1);
+    }
+  }
+}
+
+/**
+  Get the output node of a label value read from an IDX file of any data type.
+
+  @param[in]  Map    The output node of every label.
+  @param[in]  Label  The label value.
+
+  @return  The output node, LABEL_NOT_TRAINED if the label isn't trained, isn't
+           a whole number or is out of 0 to LABEL_COUNT_MAX - 1.
+
+**/
+unsigned int
+LookUpLabel (
+  const LABEL_MAP  &Map,
+  const double     Label
+  )
+{
+  if (!(Label >= 0.0) || (Label >= LABEL_COUNT_MAX) || (Label != (double)(unsigned int)Label)) {
+    return LABEL_NOT_TRAINED;
+  }
+
+  return Map.OutputIndex[(unsigned int)Label];
+}
+
 /**
   Get the index of the maximum value in a vector.
 
@@ -91,45 +139,30 @@ GetMaxIndex (
 }
 
 /**
-  Convert a desired output label to a binary vector representation.
-
-  This function converts a desired output label to a binary vector representation.
-  The length of the output vector is equal to the number of training labels.
-  The element corresponding to the desired label is set to 1, and all other elements are set to 0.
-
-  @param[in]   DesireOutputLabel  The desired output label to be converted.
-  @param[in]   TrainLabels        The vector of training labels.
+  Shuffle a list of data indices in place(Fisher-Yates), using rand().
 
-  @return      The binary matrix(Row, Column) = (TrainLables Count, 1) representation of the desired output label.
+  @param[in,out]  Indices  The indices to be shuffled.
 
-  @throw       runtime_error      One of the following conditions is met:
-                                    * No training labels are specified in TrainLabels.
-                                    * Too many training labels are specified in TrainLabels.
-                                    * The desired output label is not in TrainLabels.
 **/
-matrix
-ConvertOutputValueToMatrix (
-  int                   DesireOutputLabel,
-  vector<unsigned int>  &TrainLabels
+void
+ShuffleIndices (
+  vector<unsigned int>  &Indices
   )
 {
-  unsigned int  Index;
-
-  if (TrainLabels.size() == 0 || TrainLabels.size() > 10) {
-    throw runtime_error ("Error: Training labels are invalid.");
+  for (unsigned int Index = (unsigned int)Indices.size(); Index > 1; Index--) {
+    unsigned int  SwapIndex = rand() % Index;
+    swap (Indices[Index - 1], Indices[SwapIndex]);
   }
+}
 
-  if (!ValueInVector (TrainLabels, DesireOutputLabel, &Index)) {
-    throw runtime_error ("Error: Desire output label is not in training labels.");
+void
+ShuffleIndices (
+  vector<unsigned int>  &Indices,
+  CounterRng            &Rng
+  )
+{
+  for (unsigned int Index = (unsigned int)Indices.size(); Index > 1; Index--) {
+    unsigned int  SwapIndex = Rng.Below (Index);
+    swap (Indices[Index - 1], Indices[SwapIndex]);
   }
-
-  matrix DesireOutputMatrix (TrainLabels.size(), 1);
-
-  //
-  // Set value to the field where (Row, Column) = (Index, 0)
-  // *Note: The first one is index 0.
-  //
-  DesireOutputMatrix.SetValue (Index, 0, 1.0);
-
-  return DesireOutputMatrix;
-}
\ No newline at end of file
+}
@@ -9,32 +9,52 @@
 #define _BACK_PROPAGATION_MISC_H_
 
 #include "BackPropagator.h"
+#include "CounterRng.h"
 
 #include <vector>
 
 using namespace std;
 
+//
+// Output node of every byte label, LABEL_NOT_TRAINED for labels that aren't trained.
+// Looking a label up replaces searching the training categories for every record.
+// Labels are 0 to LABEL_COUNT_MAX - 1, as samples store them in a byte.
+//
+#define LABEL_NOT_TRAINED  0xFFFF
+#define LABEL_COUNT_MAX    256
+
+typedef struct {
+  u_int16_t  OutputIndex[LABEL_COUNT_MAX];
+} LABEL_MAP;
+
 /**
-  Convert a desired output label to a binary vector representation.
+  Build the lookup table from a byte label to its output node, the position of
+  the label in LabelsToRead.
+
+  @param[in]   LabelsToRead  The vector of labels to be trained.
+  @param[out]  Map           The output node of every label.
+
+**/
+void
+BuildLabelMap (
+  const vector<unsigned int>  &LabelsToRead,
+  LABEL_MAP                   &Map
+  );
 
-  This function converts a desired output label to a binary vector representation.
-  The length of the output vector is equal to the number of training labels.
-  The element corresponding to the desired label is set to 1, and all other elements are set to 0.
+/**
+  Get the output node of a label value read from an IDX file of any data type.
 
-  @param[in]   DesireOutputLabel  The desired output label to be converted.
-  @param[in]   TrainLabels        The vector of training labels.
+  @param[in]  Map    The output node of every label.
+  @param[in]  Label  The label value.
 
-  @return      The binary matrix(Row, Column) = (10, 1) representation of the desired output label.
+  @return  The output node, LABEL_NOT_TRAINED if the label isn't trained, isn't
+           a whole number or is out of 0 to LABEL_COUNT_MAX - 1.
 
-  @throw       runtime_error      One of the following conditions is met:
-                                    * No training labels are specified in TrainLabels.
-                                    * Too many training labels are specified in TrainLabels.
-                                    * The desired output label is not in TrainLabels.
 **/
-matrix
-ConvertOutputValueToMatrix (
-  int                   DesireOutputLabel,
-  vector<unsigned int>  &TrainLabels
+unsigned int
+LookUpLabel (
+  const LABEL_MAP  &Map,
+  const double     Label
   );
 
 /**
@@ -71,4 +91,29 @@ ValueInVector (
   unsigned int           Value
   );
 
+/**
+  Shuffle a list of data indices in place(Fisher-Yates), using rand().
+
+  @param[in,out]  Indices  The indices to be shuffled.
+
+**/
+void
+ShuffleIndices (
+  vector<unsigned int>  &Indices
+  );
+
+/**
+  Shuffle a list of data indices in place(Fisher-Yates), using a counter-based
+  random stream, so the order only depends on the stream's seed and number.
+
+  @param[in,out]  Indices  The indices to be shuffled.
+  @param[in,out]  Rng      Random stream to draw from.
+
+**/
+void
+ShuffleIndices (
+  vector<unsigned int>  &Indices,
+  CounterRng            &Rng
+  );
+
 #endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+#  Check that a deterministic training gives the same weights for any number of
+#  workers and threads: train with --seed under each setting and compare the
+#  printed weight checksums.
+#
+#  Usage: CheckDeterministic.sh Program [Seed] [Epochs]
+#
+#  The trainings run for a few epochs on a small data set of noisy patterns,
+#  generated as IDX files in a temporary directory, so no MNIST files are needed.
+#  Options that change the sample order or the layout(--stream, --augment and
+#  --hidden) are checked in their own group, against a run without the variant.
+#
+#  Copyright (c) 2026, visionaryr
+#  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+#
+
+PROGRAM=$1
+SEED=${2:-7}
+EPOCHS=${3:-3}
+
+if [ -z "$PROGRAM" ]; then
+  echo "Usage: $0 Program [Seed] [Epochs]"
+  exit 2
+fi
+
+case $PROGRAM in
+  /*) ;;
+  *)  PROGRAM=$(pwd)/$PROGRAM ;;
+esac
+
+DATA_DIR=$(mktemp -d) || exit 2
+trap 'rm -rf "$DATA_DIR"' EXIT
+
+#
+# Write an IDX file of Count records: 28 * 28 byte images(Kind images) or byte
+# labels(Kind labels). Image I shows a noisy pattern of its label, I % 10. awk
+# prints every byte as an octal escape, one record per line, and printf turns the
+# lines into bytes.
+#
+MakeIdx () {
+  awk -v Kind="$1" -v Count="$2" -v Seed="$3" '
+    function Put (Value) {
+      printf "\\%03o", Value
+    }
+    function PutCount (Value) {
+      Put(int (Value / 16777216) % 256); Put(int (Value / 65536) % 256)
+      Put(int (Value / 256) % 256); Put(Value % 256)
+    }
+    BEGIN {
+      srand (Seed)
+      if (Kind == "images") {
+        Put(0); Put(0); Put(8); Put(3); PutCount(Count); PutCount(28); PutCount(28)
+        printf "\n"
+        for (Index = 0; Index < Count; Index++) {
+          for (Pixel = 0; Pixel < 784; Pixel++) {
+            Put((((Pixel * (Index % 10 + 3)) % 97 < 30) ? 180 : 20) + int (rand () * 60))
+          }
+          printf "\n"
+        }
+      } else {
+        Put(0); Put(0); Put(8); Put(1); PutCount(Count)
+        for (Index = 0; Index < Count; Index++) {
+          Put(Index % 10)
+        }
+        printf "\n"
+      }
+    }' | while IFS= read -r Line; do printf "$Line"; done
+}
+
+MakeIdx images 1000 1 > "$DATA_DIR/train-images.idx3-ubyte"
+MakeIdx labels 1000 1 > "$DATA_DIR/train-labels.idx1-ubyte"
+MakeIdx images 100 2 > "$DATA_DIR/t10k-images.idx3-ubyte"
+MakeIdx labels 100 2 > "$DATA_DIR/t10k-labels.idx1-ubyte"
+
+FAILED=0
+
+#
+# Train with the options of the group, then with each variant added to them, and
+# compare every checksum with the first one.
+#
+CheckGroup () {
+  BASE=$1
+  shift
+  EXPECTED=""
+
+  for VARIANT in "" "$@"; do
+    OPTIONS=$(echo --seed $SEED --epochs $EPOCHS $BASE $VARIANT)
+    CHECKSUM=$(cd "$DATA_DIR" && $PROGRAM $OPTIONS 2>&1 | sed -n 's/^Weights checksum: //p' | tail -n 1)
+
+    if [ -z "$CHECKSUM" ]; then
+      echo "FAIL  $OPTIONS: no weight checksum printed"
+      FAILED=1
+      continue
+    fi
+
+    if [ -z "$EXPECTED" ]; then
+      EXPECTED=$CHECKSUM
+    fi
+
+    if [ "$CHECKSUM" = "$EXPECTED" ]; then
+      echo "OK    $OPTIONS: $CHECKSUM"
+    else
+      echo "FAIL  $OPTIONS: $CHECKSUM, expected $EXPECTED"
+      FAILED=1
+    fi
+  done
+}
+
+CheckGroup "" "--workers 2" "--workers 4" "--input-threads 2" "--backward-threads 2" \
+              "--workers 2 --input-threads 2" "--model-shards 2"
+CheckGroup "--stream 1" "--input-threads 2" "--workers 2"
+CheckGroup "--augment" "--input-threads 2" "--workers 2"
+CheckGroup "--hidden 32,32,32" "--checkpoint-activations 2" "--backward-threads 2" "--workers 2"
+
+exit $FAILED
@@ -0,0 +1,195 @@
+/**
+  Background checkpoint writer implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "Checkpointer.h"
+#include "DebugLib.h"
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+Checkpointer::Checkpointer (
+  ) : HasPending (false),
+      Writing (false),
+      Stopping (false)
+{
+}
+
+Checkpointer::~Checkpointer (
+  )
+{
+  Stop ();
+}
+
+/**
+  Start the writer thread. Snapshots submitted afterwards go to FileName.
+
+  @param[in]  FileName  Checkpoint file to be replaced by every snapshot.
+
+**/
+void
+Checkpointer::Start (
+  const string  &FileName
+  )
+{
+  Stop ();
+
+  this->FileName = FileName;
+  Stopping       = false;
+  Writer         = thread (&Checkpointer::WriterLoop, this);
+}
+
+bool
+Checkpointer::IsStarted (
+  ) const
+{
+  return Writer.joinable ();
+}
+
+/**
+  Hand a snapshot over to the writer thread. Never waits for disk I/O.
+
+  @param[in,out]  Snapshot  Serialized checkpoint. Its buffer is swapped with a
+                            spare one, so the caller can reuse it for the next snapshot.
+
+**/
+void
+Checkpointer::Submit (
+  string  &Snapshot
+  )
+{
+  {
+    lock_guard<mutex>  Guard (Lock);
+
+    if (HasPending) {
+      DEBUG_LOG ("Checkpoint writer busy, older snapshot replaced.");
+    }
+    Pending.swap (Snapshot);
+    HasPending = true;
+  }
+
+  Changed.notify_all ();
+}
+
+/**
+  Wait until all submitted snapshots are on disk.
+
+**/
+void
+Checkpointer::Flush (
+  void
+  )
+{
+  unique_lock<mutex>  Guard (Lock);
+
+  Changed.wait (Guard, [this] { return !HasPending && !Writing; });
+}
+
+/**
+  Write the remaining snapshot and stop the writer thread.
+
+**/
+void
+Checkpointer::Stop (
+  void
+  )
+{
+  if (!Writer.joinable ()) {
+    return;
+  }
+
+  {
+    lock_guard<mutex>  Guard (Lock);
+    Stopping = true;
+  }
+  Changed.notify_all ();
+
+  Writer.join ();
+}
+
+void
+Checkpointer::WriterLoop (
+  void
+  )
+{
+  string  Snapshot;
+
+  for (;;) {
+    {
+      unique_lock<mutex>  Guard (Lock);
+
+      Changed.wait (Guard, [this] { return HasPending || Stopping; });
+      if (!HasPending) {
+        return;
+      }
+
+      Snapshot.swap (Pending);
+      HasPending = false;
+      Writing    = true;
+    }
+
+    if (!WriteSnapshot (Snapshot)) {
+      cerr << "Failed to write checkpoint " << FileName << ": " << strerror (errno) << endl;
+    }
+
+    {
+      lock_guard<mutex>  Guard (Lock);
+      Writing = false;
+    }
+    Changed.notify_all ();
+  }
+}
+
+/**
+  Write a snapshot to a temporary file and atomically replace the checkpoint with it.
+
+  @retval  true   The checkpoint file now holds Snapshot.
+  @retval  false  Writing failed, the previous checkpoint is kept.
+
+**/
+bool
+Checkpointer::WriteSnapshot (
+  const string  &Snapshot
+  )
+{
+  string       TempFileName = FileName + ".tmp";
+  const char   *Cursor = Snapshot.data ();
+  size_t       Remaining = Snapshot.size ();
+  int          Fd;
+
+  Fd = open (TempFileName.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (Fd < 0) {
+    return false;
+  }
+
+  while (Remaining != 0) {
+    ssize_t  Written = write (Fd, Cursor, Remaining);
+
+    if (Written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close (Fd);
+      return false;
+    }
+    Cursor    += Written;
+    Remaining -= (size_t)Written;
+  }
+
+  if (fsync (Fd) != 0) {
+    close (Fd);
+    return false;
+  }
+  close (Fd);
+
+  return rename (TempFileName.c_str (), FileName.c_str ()) == 0;
+}
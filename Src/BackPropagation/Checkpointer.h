@@ -0,0 +1,63 @@
+/**
+  Background checkpoint writer definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _CHECKPOINTER_H_
+#define _CHECKPOINTER_H_
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// Writes serialized training snapshots to disk on a background thread.
+//
+// Submit() only hands the snapshot over and returns, so training never waits
+// for disk I/O. If the writer is still busy when the next snapshot arrives,
+// the older unwritten one is replaced: only the latest state matters.
+//
+// A snapshot is written to "<FileName>.tmp", synced, then renamed over
+// FileName, so FileName always holds the latest complete checkpoint.
+//
+class Checkpointer
+{
+  public:
+    Checkpointer ();
+    ~Checkpointer ();
+
+    void Start (
+      const std::string  &FileName
+      );
+
+    bool IsStarted () const;
+
+    void Submit (
+      std::string  &Snapshot
+      );
+
+    void Flush ();
+
+    void Stop ();
+
+  private:
+    void WriterLoop ();
+
+    bool WriteSnapshot (
+      const std::string  &Snapshot
+      );
+
+    std::string              FileName;
+    std::thread              Writer;
+    std::mutex               Lock;
+    std::condition_variable  Changed;
+    std::string              Pending;    // Latest submitted snapshot, not yet picked up.
+    bool                     HasPending;
+    bool                     Writing;
+    bool                     Stopping;
+};
+
+#endif
@@ -0,0 +1,593 @@
+/**
+  Compact data set implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "CompactDataSet.h"
+#include "DebugLib.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static_assert (sizeof (DATA_SET_CACHE_FILE) <= DATA_SET_CACHE_ALIGNMENT, "Cache file header doesn't fit before the pixels.");
+
+/**
+  Constructor for CompactDataSet class. The set is empty until Init() is called.
+
+**/
+CompactDataSet::CompactDataSet (
+  ) : Rows (0),
+      Columns (0),
+      FeatureCount (0),
+      OutputCount (0),
+      PreProcessor (NULL),
+      SampleCount (0),
+      PixelData (NULL),
+      LabelData (NULL),
+      OutputIndexData (NULL),
+      Mapping (NULL),
+      MappingSize (0)
+{
+}
+
+CompactDataSet::~CompactDataSet (
+  )
+{
+  Unmap ();
+}
+
+/**
+  Read the samples from the vectors, e.g. after they changed.
+
+**/
+void
+CompactDataSet::UseVectors (
+  void
+  )
+{
+  SampleCount     = (unsigned int)Labels.size();
+  PixelData       = Pixels.data ();
+  LabelData       = Labels.data ();
+  OutputIndexData = OutputIndex.data ();
+}
+
+/**
+  Unmap the cache file the samples were loaded from, if any.
+
+**/
+void
+CompactDataSet::Unmap (
+  void
+  )
+{
+  if (Mapping != NULL) {
+    munmap (Mapping, MappingSize);
+  }
+
+  Mapping     = NULL;
+  MappingSize = 0;
+}
+
+/**
+  Drop all samples and set the shape of the samples to come.
+
+  @param[in]  Rows         Rows of every image.
+  @param[in]  Columns      Columns of every image.
+  @param[in]  OutputCount  Number of output nodes of the network.
+
+  @throw  invalid_argument  A size is 0, or OutputCount is more than a byte can index.
+
+**/
+void
+CompactDataSet::Init (
+  const unsigned int  Rows,
+  const unsigned int  Columns,
+  const unsigned int  OutputCount
+  )
+{
+  if ((Rows == 0) || (Columns == 0) || (OutputCount == 0) || (OutputCount > 256)) {
+    DEBUG_LOG ("Rows = " << Rows << ", Columns = " << Columns << ", OutputCount = " << OutputCount);
+    throw invalid_argument ("CompactDataSet::Init (): Invalid shape.");
+  }
+
+  this->Rows         = Rows;
+  this->Columns      = Columns;
+  this->FeatureCount = Rows * Columns;
+  this->OutputCount  = OutputCount;
+
+  Unmap ();
+  Pixels.clear ();
+  Labels.clear ();
+  OutputIndex.clear ();
+  UseVectors ();
+}
+
+/**
+  Allocate room for Count samples at once.
+
+  @param[in]  Count  Number of samples.
+
+**/
+void
+CompactDataSet::Reserve (
+  const unsigned int  Count
+  )
+{
+  Pixels.reserve ((size_t)Count * FeatureCount);
+  Labels.reserve (Count);
+  OutputIndex.reserve (Count);
+}
+
+/**
+  Append a sample.
+
+  @param[in]  Pixels       Rows * Columns bytes of the image, row-major.
+  @param[in]  Label        Label of the image.
+  @param[in]  OutputIndex  Output node the image trains.
+
+  @throw  invalid_argument  Label or OutputIndex is out of range.
+
+**/
+void
+CompactDataSet::AddSample (
+  const u_int8_t      *Pixels,
+  const unsigned int  Label,
+  const unsigned int  OutputIndex
+  )
+{
+  if ((Label > 0xFF) || (OutputIndex >= OutputCount)) {
+    DEBUG_LOG ("Label = " << Label << ", OutputIndex = " << OutputIndex << ", OutputCount = " << OutputCount);
+    throw invalid_argument ("CompactDataSet::AddSample (): Label out of range.");
+  }
+
+  if (Mapping != NULL) {
+    throw logic_error ("CompactDataSet::AddSample (): The data set is a loaded cache, call Init () first.");
+  }
+
+  this->Pixels.insert (this->Pixels.end(), Pixels, Pixels + FeatureCount);
+  Labels.push_back ((u_int8_t)Label);
+  this->OutputIndex.push_back ((u_int8_t)OutputIndex);
+  UseVectors ();
+}
+
+/**
+  Make room for exactly Count samples, to be filled by SetSample(), e.g. from
+  several threads at once.
+
+  @param[in]  Count  Number of samples.
+
+**/
+void
+CompactDataSet::Resize (
+  const unsigned int  Count
+  )
+{
+  if (Mapping != NULL) {
+    throw logic_error ("CompactDataSet::Resize (): The data set is a loaded cache, call Init () first.");
+  }
+
+  Pixels.resize ((size_t)Count * FeatureCount);
+  Labels.resize (Count);
+  OutputIndex.resize (Count);
+  UseVectors ();
+}
+
+/**
+  Overwrite a sample. Threads may set different samples at the same time.
+
+  @param[in]  Index        Index of the sample, below the count of Resize().
+  @param[in]  Pixels       Rows * Columns bytes of the image, row-major.
+  @param[in]  Label        Label of the image.
+  @param[in]  OutputIndex  Output node the image trains.
+
+  @throw  invalid_argument  Index, Label or OutputIndex is out of range.
+
+**/
+void
+CompactDataSet::SetSample (
+  const unsigned int  Index,
+  const u_int8_t      *Pixels,
+  const unsigned int  Label,
+  const unsigned int  OutputIndex
+  )
+{
+  if ((Index >= (unsigned int)Labels.size()) || (Label > 0xFF) || (OutputIndex >= OutputCount)) {
+    DEBUG_LOG ("Index = " << Index << ", Label = " << Label << ", OutputIndex = " << OutputIndex << ", OutputCount = " << OutputCount);
+    throw invalid_argument ("CompactDataSet::SetSample (): Index or label out of range.");
+  }
+
+  memcpy (&this->Pixels[(size_t)Index * FeatureCount], Pixels, FeatureCount);
+  Labels[Index]            = (u_int8_t)Label;
+  this->OutputIndex[Index] = (u_int8_t)OutputIndex;
+}
+
+/**
+  Set how pixels are converted on their way into the network. The default NULL
+  feeds the raw byte values.
+
+  @param[in]  PreProcessor  The conversion, must stay valid while the set is read.
+
+  @throw  invalid_argument  PreProcessor is not ready, e.g. its standardization isn't fitted.
+
+**/
+void
+CompactDataSet::SetPreProcessor (
+  const InputPreProcessor  *PreProcessor
+  )
+{
+  if ((PreProcessor != NULL) && !PreProcessor->IsReady ()) {
+    throw invalid_argument ("CompactDataSet::SetPreProcessor (): PreProcessor is not ready.");
+  }
+
+  this->PreProcessor = PreProcessor;
+}
+
+/**
+  Convert the pixels of a sample into FeatureCount input values.
+
+**/
+void
+CompactDataSet::ConvertPixels (
+  const u_int8_t  *Source,
+  double          *Target
+  ) const
+{
+  if (PreProcessor != NULL) {
+    PreProcessor->Convert (Source, Target);
+    return;
+  }
+
+  #pragma omp simd
+  for (unsigned int Pixel = 0; Pixel < FeatureCount; Pixel++) {
+    Target[Pixel] = Source[Pixel];
+  }
+}
+
+/**
+  Keep only the share of the samples that belongs to one data-parallel worker.
+  Samples are dealt out round robin, and every worker gets the same number of
+  samples, so all of them run the same number of batches per epoch. Up to
+  WorldSize - 1 samples at the end are dropped.
+
+  @param[in]  Rank       Rank of this worker.
+  @param[in]  WorldSize  Number of workers.
+
+**/
+void
+CompactDataSet::KeepShard (
+  const unsigned int  Rank,
+  const unsigned int  WorldSize
+  )
+{
+  unsigned int           ShardSize = SampleCount / WorldSize;
+  vector<u_int8_t>       ShardPixels ((size_t)ShardSize * FeatureCount);
+  vector<u_int8_t>       ShardLabels (ShardSize);
+  vector<u_int8_t>       ShardOutputIndex (ShardSize);
+
+  for (unsigned int Index = 0; Index < ShardSize; Index++) {
+    unsigned int  Source = Index * WorldSize + Rank;
+
+    memcpy (&ShardPixels[(size_t)Index * FeatureCount], GetPixels (Source), FeatureCount);
+    ShardLabels[Index]      = LabelData[Source];
+    ShardOutputIndex[Index] = OutputIndexData[Source];
+  }
+
+  //
+  // A loaded cache stays as it is, the shard is a copy.
+  //
+  Unmap ();
+  Pixels.swap (ShardPixels);
+  Labels.swap (ShardLabels);
+  OutputIndex.swap (ShardOutputIndex);
+  UseVectors ();
+}
+
+/**
+  Map a cache file written by SaveCache() and read the samples from it. The
+  pages are shared with other processes mapping the same file.
+
+  @param[in]  FileName  The cache file.
+  @param[in]  Key       Key the cache should have been saved with.
+
+  @retval  true   The samples are loaded.
+  @retval  false  There is no valid cache of this Key and format version,
+                  the data set is unchanged.
+
+**/
+bool
+CompactDataSet::LoadCache (
+  const string     &FileName,
+  const u_int64_t  Key
+  )
+{
+  struct stat                Stat;
+  const DATA_SET_CACHE_FILE  *Header;
+  void                       *File;
+  size_t                     FileSize;
+  int                        Fd;
+
+  Fd = open (FileName.c_str (), O_RDONLY);
+  if (Fd < 0) {
+    return false;
+  }
+  if ((fstat (Fd, &Stat) != 0) || ((size_t)Stat.st_size < sizeof (DATA_SET_CACHE_FILE))) {
+    close (Fd);
+    return false;
+  }
+
+  FileSize = (size_t)Stat.st_size;
+  File     = mmap (NULL, FileSize, PROT_READ, MAP_SHARED, Fd, 0);
+  close (Fd);
+  if (File == MAP_FAILED) {
+    DEBUG_LOG ("mmap (" << FileName << "): " << strerror (errno));
+    return false;
+  }
+
+  Header = (const DATA_SET_CACHE_FILE *)File;
+
+  u_int64_t  FeatureBytes = (u_int64_t)Header->Rows * Header->Columns;
+
+  if ((Header->Signature != DATA_SET_CACHE_FILE_SIGNATURE) ||
+      (Header->HdrSize != sizeof (DATA_SET_CACHE_FILE)) ||
+      (Header->Version != DATA_SET_CACHE_FILE_VERSION) ||
+      (Header->Key != Key) ||
+      (FeatureBytes == 0) || (Header->OutputCount == 0) || (Header->OutputCount > 256) ||
+      (Header->PixelOffset + FeatureBytes * Header->SampleCount > FileSize) ||
+      (Header->LabelOffset + Header->SampleCount > FileSize) ||
+      (Header->OutputIndexOffset + Header->SampleCount > FileSize)) {
+    munmap (File, FileSize);
+    return false;
+  }
+
+  //
+  // Epochs visit the samples in random order, read the file in now.
+  //
+  madvise (File, FileSize, MADV_WILLNEED);
+
+  Init (Header->Rows, Header->Columns, Header->OutputCount);
+
+  Mapping         = File;
+  MappingSize     = FileSize;
+  SampleCount     = Header->SampleCount;
+  PixelData       = (const u_int8_t *)File + Header->PixelOffset;
+  LabelData       = (const u_int8_t *)File + Header->LabelOffset;
+  OutputIndexData = (const u_int8_t *)File + Header->OutputIndexOffset;
+
+  return true;
+}
+
+/**
+  Write the samples to a cache file for LoadCache(). The file is written under a
+  temporary name and renamed, so concurrent readers and writers, e.g. data-parallel
+  workers, see either the whole old file or the whole new one.
+
+  @param[in]  FileName  The cache file.
+  @param[in]  Key       Identifies the source data and its processing.
+
+  @retval  true   The cache file is written.
+  @retval  false  Writing failed, e.g. the directory is read-only.
+
+**/
+bool
+CompactDataSet::SaveCache (
+  const string     &FileName,
+  const u_int64_t  Key
+  ) const
+{
+  DATA_SET_CACHE_FILE  Header;
+  string               TempFileName = FileName + ".tmp." + to_string (getpid ());
+  static const char    Padding[DATA_SET_CACHE_ALIGNMENT] = { 0 };
+  u_int64_t            PixelBytes = (u_int64_t)SampleCount * FeatureCount;
+
+  memset (&Header, 0, sizeof (Header));
+  Header.Signature         = DATA_SET_CACHE_FILE_SIGNATURE;
+  Header.HdrSize           = sizeof (DATA_SET_CACHE_FILE);
+  Header.Version           = DATA_SET_CACHE_FILE_VERSION;
+  Header.SampleCount       = SampleCount;
+  Header.Key               = Key;
+  Header.Rows              = Rows;
+  Header.Columns           = Columns;
+  Header.OutputCount       = OutputCount;
+  Header.PixelOffset       = DATA_SET_CACHE_ALIGNMENT;
+  Header.LabelOffset       = (Header.PixelOffset + PixelBytes + DATA_SET_CACHE_ALIGNMENT - 1) / DATA_SET_CACHE_ALIGNMENT * DATA_SET_CACHE_ALIGNMENT;
+  Header.OutputIndexOffset = (Header.LabelOffset + SampleCount + DATA_SET_CACHE_ALIGNMENT - 1) / DATA_SET_CACHE_ALIGNMENT * DATA_SET_CACHE_ALIGNMENT;
+
+  ofstream  File (TempFileName, ios::binary | ios::trunc);
+
+  if (!File.is_open ()) {
+    return false;
+  }
+
+  File.write ((const char *)&Header, sizeof (Header));
+  File.write (Padding, Header.PixelOffset - sizeof (Header));
+  File.write ((const char *)PixelData, PixelBytes);
+  File.write (Padding, Header.LabelOffset - Header.PixelOffset - PixelBytes);
+  File.write ((const char *)LabelData, SampleCount);
+  File.write (Padding, Header.OutputIndexOffset - Header.LabelOffset - SampleCount);
+  File.write ((const char *)OutputIndexData, SampleCount);
+  File.close ();
+
+  if (File.fail () || (rename (TempFileName.c_str (), FileName.c_str ()) != 0)) {
+    remove (TempFileName.c_str ());
+    return false;
+  }
+
+  return true;
+}
+
+unsigned int
+CompactDataSet::GetRows (
+  ) const
+{
+  return Rows;
+}
+
+unsigned int
+CompactDataSet::GetColumns (
+  ) const
+{
+  return Columns;
+}
+
+/**
+  Get the stored bytes of a sample.
+
+  @param[in]  Index  Index of the sample.
+
+  @return  Rows * Columns bytes, row-major.
+
+**/
+const u_int8_t *
+CompactDataSet::GetPixels (
+  const unsigned int  Index
+  ) const
+{
+  return PixelData + (size_t)Index * FeatureCount;
+}
+
+unsigned int
+CompactDataSet::GetLabel (
+  const unsigned int  Index
+  ) const
+{
+  return LabelData[Index];
+}
+
+unsigned int
+CompactDataSet::GetSampleCount (
+  ) const
+{
+  return SampleCount;
+}
+
+/**
+  Convert a sample into a (Rows * Columns) * 1 network input.
+
+  @param[in]   Index   Index of the sample.
+  @param[out]  Buffer  Receives the input. Doesn't allocate once it had this size.
+
+  @return  Buffer.
+
+**/
+const matrix &
+CompactDataSet::GetInput (
+  const unsigned int  Index,
+  matrix              &Buffer
+  ) const
+{
+  const u_int8_t  *Source = GetPixels (Index);
+  double          *Input;
+
+  Buffer.Resize (FeatureCount, 1);
+  Input = Buffer.Data();
+  ConvertPixels (Source, Input);
+
+  return Buffer;
+}
+
+/**
+  Convert a sample into a (Rows * Columns) * 1 network input after changing its
+  image with Augmenter.
+
+  @param[in]      Index      Index of the sample.
+  @param[in]      Augmenter  The changes to apply.
+  @param[in,out]  Rng        Random stream of this sample.
+  @param[in,out]  Scratch    Receives the changed image. Doesn't allocate once it had this size.
+  @param[out]     Buffer     Receives the input. Doesn't allocate once it had this size.
+
+  @return  Buffer.
+
+**/
+const matrix &
+CompactDataSet::GetAugmentedInput (
+  const unsigned int     Index,
+  const ImageAugmenter   &Augmenter,
+  CounterRng             &Rng,
+  vector<u_int8_t>       &Scratch,
+  matrix                 &Buffer
+  ) const
+{
+  double  *Input;
+
+  Scratch.resize (FeatureCount);
+  Augmenter.Apply (GetPixels (Index), Rows, Columns, Rng, Scratch.data ());
+
+  Buffer.Resize (FeatureCount, 1);
+  Input = Buffer.Data();
+  ConvertPixels (Scratch.data (), Input);
+
+  return Buffer;
+}
+
+bool
+CompactDataSet::CanAugment (
+  ) const
+{
+  return true;
+}
+
+/**
+  Get the desired output of a sample, its output node only. The loss kernel
+  treats it as 1 at that node and 0 elsewhere.
+
+  @param[in]  Index  Index of the sample.
+
+**/
+DESIRED_OUTPUT
+CompactDataSet::GetDesiredOutput (
+  const unsigned int  Index
+  ) const
+{
+  DESIRED_OUTPUT  DesiredOutput = { NULL, OutputIndexData[Index] };
+
+  return DesiredOutput;
+}
+
+unsigned int
+CompactDataSet::GetClass (
+  const unsigned int  Index
+  ) const
+{
+  return OutputIndexData[Index];
+}
+
+/**
+  Convert Count samples into the first Count rows of a batch, one sample per row.
+
+  @param[in]   Indices  Indices of the samples.
+  @param[in]   Count    Number of samples.
+  @param[out]  Batch    At least Count * (Rows * Columns).
+
+  @throw  invalid_argument  Batch doesn't fit the samples.
+
+**/
+void
+CompactDataSet::GatherInputs (
+  const unsigned int  *Indices,
+  const unsigned int  Count,
+  matrix              &Batch
+  ) const
+{
+  if ((Count > Batch.getrow()) || (Batch.getcolumn() != FeatureCount)) {
+    DEBUG_LOG ("Count = " << Count << ", Batch = " << Batch.getrow() << " * " << Batch.getcolumn() << ", FeatureCount = " << FeatureCount);
+    throw invalid_argument ("Input data size does not match input layer size.");
+  }
+
+  for (unsigned int Sample = 0; Sample < Count; Sample++) {
+    const u_int8_t  *Source = GetPixels (Indices[Sample]);
+    double          *Row    = Batch.Data() + (size_t)Sample * FeatureCount;
+
+    ConvertPixels (Source, Row);
+  }
+}
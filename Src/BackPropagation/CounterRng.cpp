@@ -0,0 +1,63 @@
+/**
+  Counter-based random number generator implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "CounterRng.h"
+
+/**
+  SplitMix64 finalizer, a bijective 64-bit hash.
+
+**/
+static
+uint64_t
+Mix64 (
+  uint64_t  Value
+  )
+{
+  Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+  return Value ^ (Value >> 31);
+}
+
+/**
+  Constructor for CounterRng class.
+
+  @param[in]  Seed    Seed of the whole run.
+  @param[in]  Stream  Number of the stream, e.g. RNG_STREAM_SHUFFLE + Epoch.
+
+**/
+CounterRng::CounterRng (
+  const uint64_t  Seed,
+  const uint64_t  Stream
+  ) : Key (Mix64 (Seed ^ Mix64 (Stream + 0x9E3779B97F4A7C15ULL))),
+      Counter (0)
+{
+}
+
+/**
+  Get the next 64-bit random number of the stream.
+
+**/
+uint64_t
+CounterRng::Next (
+  void
+  )
+{
+  Counter++;
+  return Mix64 (Key + Counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+  Get a random number in [0, Bound).
+
+**/
+unsigned int
+CounterRng::Below (
+  const unsigned int  Bound
+  )
+{
+  return (unsigned int)(((unsigned __int128)Next () * Bound) >> 64);
+}
@@ -0,0 +1,47 @@
+/**
+  Counter-based random number generator definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _COUNTER_RNG_H_
+#define _COUNTER_RNG_H_
+
+#include <cstdint>
+
+//
+// The N-th number of a stream is a hash of (Seed, Stream, N), so it doesn't
+// depend on how many numbers other streams have drawn, on the thread or
+// process drawing it, or on how many epochs ran before a resume. Streams are
+// cheap: one is created per purpose and epoch (or per worker) instead of
+// sharing the global rand() state.
+//
+class CounterRng
+{
+  public:
+    CounterRng (
+      const uint64_t  Seed,
+      const uint64_t  Stream
+      );
+
+    uint64_t Next ();
+
+    unsigned int Below (
+      const unsigned int  Bound
+      );
+
+  private:
+    uint64_t  Key;
+    uint64_t  Counter;
+};
+
+//
+// Stream numbers of the training randomness, the epoch is added to RNG_STREAM_SHUFFLE
+// and RNG_STREAM_AUGMENT.
+//
+#define RNG_STREAM_VALIDATION_SPLIT  0x0000000100000000ULL
+#define RNG_STREAM_SHUFFLE           0x0000000200000000ULL
+#define RNG_STREAM_AUGMENT           0x0000000300000000ULL
+
+#endif
@@ -0,0 +1,191 @@
+/**
+  Training data source implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "DataSource.h"
+#include "DebugLib.h"
+#include "BpMisc.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+void
+CheckDesiredOutput (
+  const DESIRED_OUTPUT  &DesiredOutput,
+  const unsigned int    OutputSize
+  )
+{
+  if ((DesiredOutput.Values != NULL) ? (DesiredOutput.Values->Size() != OutputSize) : (DesiredOutput.Class >= OutputSize)) {
+    DEBUG_LOG ("DesiredOutput size = " << ((DesiredOutput.Values != NULL) ? DesiredOutput.Values->Size() : 0) <<
+               ", class = " << DesiredOutput.Class << ", output layer size = " << OutputSize);
+    throw invalid_argument ("DesiredOutput does not match output layer size.");
+  }
+}
+
+/**
+  Put the training samples of an epoch in random order.
+
+  @param[in,out]  Indices  Indices of the samples to train with.
+  @param[in,out]  Rng      Random stream to draw from, or NULL to use rand().
+
+**/
+void
+DataSource::ShuffleEpoch (
+  vector<unsigned int>  &Indices,
+  CounterRng            *Rng
+  ) const
+{
+  if (Rng == NULL) {
+    ShuffleIndices (Indices);
+  } else {
+    ShuffleIndices (Indices, *Rng);
+  }
+}
+
+/**
+  Put samples read once in the order that reads them fastest. Samples of a source
+  in memory are equally fast in any order, so they are left as they are.
+
+  @param[in,out]  Indices  Indices of the samples to read.
+
+**/
+void
+DataSource::SortForReading (
+  vector<unsigned int>  &Indices
+  ) const
+{
+}
+
+/**
+  Get the input of a sample whose image is changed by Augmenter. A source that
+  doesn't keep byte images has nothing to change and returns the input as it is,
+  CanAugment() tells trainers so they reject augmentation on it.
+
+  @param[in]      Index      Index of the sample.
+  @param[in]      Augmenter  The changes to apply.
+  @param[in,out]  Rng        Random stream of this sample.
+  @param[in,out]  Scratch    Receives the changed image.
+  @param[out]     Buffer     May receive the input.
+
+  @return  The input of the sample.
+
+**/
+const matrix &
+DataSource::GetAugmentedInput (
+  const unsigned int     Index,
+  const ImageAugmenter   &Augmenter,
+  CounterRng             &Rng,
+  vector<u_int8_t>       &Scratch,
+  matrix                 &Buffer
+  ) const
+{
+  return GetInput (Index, Buffer);
+}
+
+bool
+DataSource::CanAugment (
+  ) const
+{
+  return false;
+}
+
+bool
+DataSource::IsConcurrent (
+  ) const
+{
+  return true;
+}
+
+/**
+  Constructor for MatrixDataSource class.
+
+  @param[in]  Inputs          Input of each data sample.
+  @param[in]  DesiredOutputs  Desired output of each data sample.
+
+  @throw  runtime_error  The amounts of Inputs and DesiredOutputs don't match.
+
+**/
+MatrixDataSource::MatrixDataSource (
+  const vector<matrix>  &Inputs,
+  const vector<matrix>  &DesiredOutputs
+  ) : Inputs (Inputs),
+      DesiredOutputs (DesiredOutputs)
+{
+  if (Inputs.size() != DesiredOutputs.size()) {
+    DEBUG_LOG (__FUNCTION__ << ": InputData count = " << Inputs.size() << ", DesiredOutput count = " << DesiredOutputs.size());
+    throw runtime_error ("Amount of InputData and DesiredOutput isn't match.");
+  }
+}
+
+unsigned int
+MatrixDataSource::GetSampleCount (
+  ) const
+{
+  return (unsigned int)Inputs.size();
+}
+
+const matrix &
+MatrixDataSource::GetInput (
+  const unsigned int  Index,
+  matrix              &Buffer
+  ) const
+{
+  return Inputs[Index];
+}
+
+DESIRED_OUTPUT
+MatrixDataSource::GetDesiredOutput (
+  const unsigned int  Index
+  ) const
+{
+  DESIRED_OUTPUT  DesiredOutput = { &DesiredOutputs[Index], 0 };
+
+  return DesiredOutput;
+}
+
+unsigned int
+MatrixDataSource::GetClass (
+  const unsigned int  Index
+  ) const
+{
+  const double  *Desired = DesiredOutputs[Index].Data();
+  unsigned int  Class = 0;
+
+  for (unsigned int Node = 1; Node < DesiredOutputs[Index].Size(); Node++) {
+    if (Desired[Node] > Desired[Class]) {
+      Class = Node;
+    }
+  }
+
+  return Class;
+}
+
+void
+MatrixDataSource::GatherInputs (
+  const unsigned int  *Indices,
+  const unsigned int  Count,
+  matrix              &Batch
+  ) const
+{
+  unsigned int  InputSize = Batch.getcolumn();
+
+  if (Count > Batch.getrow()) {
+    DEBUG_LOG ("Count = " << Count << ", Batch rows = " << Batch.getrow());
+    throw invalid_argument ("MatrixDataSource::GatherInputs (): Batch is too small.");
+  }
+
+  for (unsigned int Sample = 0; Sample < Count; Sample++) {
+    const matrix  &Input = Inputs[Indices[Sample]];
+
+    if (Input.Size() != InputSize) {
+      DEBUG_LOG ("Input size = " << Input.Size() << ", expected " << InputSize);
+      throw invalid_argument ("Input data size does not match input layer size.");
+    }
+    memcpy (Batch.Data() + (size_t)Sample * InputSize, Input.Data(), InputSize * sizeof (double));
+  }
+}
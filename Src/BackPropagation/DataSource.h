@@ -0,0 +1,167 @@
+/**
+  Training data source definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _DATA_SOURCE_H_
+#define _DATA_SOURCE_H_
+
+#include "matrix.h"
+#include "CounterRng.h"
+#include "ImageAugmenter.h"
+
+#include <vector>
+
+//
+// Desired output of a data sample. A classification sample is only its output
+// node: Values is NULL, and the loss kernel of the output layer uses 1.0 for node
+// Class and 0.0 for the others, so no one-hot matrix is built. Other samples point
+// Values to a column matrix of the desired output values.
+//
+typedef struct {
+  const matrix  *Values;
+  unsigned int  Class;
+} DESIRED_OUTPUT;
+
+/**
+  Check that a desired output fits an output layer of OutputSize nodes.
+
+  @throw  invalid_argument  Values has another size, or Class is not an output node.
+
+**/
+void
+CheckDesiredOutput (
+  const DESIRED_OUTPUT  &DesiredOutput,
+  const unsigned int    OutputSize
+  );
+
+//
+// Data samples addressed by index, as BackPropagator and the other trainers
+// read them.
+//
+// GetInput() returns a stored matrix, or Buffer after converting the sample
+// into it. So a source can keep its samples in any form,
+// e.g. compact bytes, and a trainer passes the same buffers for every sample.
+// Converting into a buffer of the right capacity doesn't allocate.
+//
+// All methods are const and keep no state between calls, so several threads
+// can read one source with their own buffers. Streaming sources, which keep a
+// window of the data in memory, are the exception and read on one thread only,
+// IsConcurrent() tells readers like InputPipeline which kind a source is.
+//
+// ShuffleEpoch() and SortForReading() let a source choose the order its samples
+// are read in, e.g. a streaming source keeps samples on disk close together.
+//
+class DataSource
+{
+  public:
+    virtual ~DataSource () {}
+
+    virtual unsigned int GetSampleCount () const = 0;
+
+    virtual const matrix &GetInput (
+      const unsigned int  Index,
+      matrix              &Buffer
+      ) const = 0;
+
+    //
+    // Input of a sample whose image Augmenter changed with random numbers from Rng,
+    // Scratch holds the changed bytes. By default the input unchanged, for sources
+    // that don't keep byte images, see CanAugment().
+    //
+    virtual const matrix &GetAugmentedInput (
+      const unsigned int     Index,
+      const ImageAugmenter   &Augmenter,
+      CounterRng             &Rng,
+      std::vector<u_int8_t>  &Scratch,
+      matrix                 &Buffer
+      ) const;
+
+    virtual DESIRED_OUTPUT GetDesiredOutput (
+      const unsigned int  Index
+      ) const = 0;
+
+    //
+    // Output node that should be the largest, e.g. for accuracy.
+    //
+    virtual unsigned int GetClass (
+      const unsigned int  Index
+      ) const = 0;
+
+    //
+    // Inputs of Count samples into the first Count rows of Batch, one sample per row.
+    //
+    virtual void GatherInputs (
+      const unsigned int  *Indices,
+      const unsigned int  Count,
+      matrix              &Batch
+      ) const = 0;
+
+    //
+    // Order of the training samples of an epoch. By default a full shuffle, with rand()
+    // when Rng is NULL.
+    //
+    virtual void ShuffleEpoch (
+      std::vector<unsigned int>  &Indices,
+      CounterRng                 *Rng
+      ) const;
+
+    //
+    // Order of samples read once, e.g. for validation. By default unchanged.
+    //
+    virtual void SortForReading (
+      std::vector<unsigned int>  &Indices
+      ) const;
+
+    //
+    // Whether several threads can read samples at once, true by default.
+    //
+    virtual bool IsConcurrent () const;
+
+    //
+    // Whether GetAugmentedInput() changes the images, false by default.
+    //
+    virtual bool CanAugment () const;
+};
+
+//
+// Data source of samples already in network format, Input[Index] and DesiredOutput[Index]
+// as column matrices. The vectors are referenced, not copied.
+//
+class MatrixDataSource : public DataSource
+{
+  public:
+    MatrixDataSource (
+      const std::vector<matrix>  &Inputs,
+      const std::vector<matrix>  &DesiredOutputs
+      );
+
+    unsigned int GetSampleCount () const;
+
+    const matrix &GetInput (
+      const unsigned int  Index,
+      matrix              &Buffer
+      ) const;
+
+    DESIRED_OUTPUT GetDesiredOutput (
+      const unsigned int  Index
+      ) const;
+
+    unsigned int GetClass (
+      const unsigned int  Index
+      ) const;
+
+    void GatherInputs (
+      const unsigned int  *Indices,
+      const unsigned int  Count,
+      matrix              &Batch
+      ) const;
+
+  private:
+    const std::vector<matrix>  &Inputs;
+    const std::vector<matrix>  &DesiredOutputs;
+};
+
+#endif
@@ -14,27 +14,18 @@
 using namespace std;
 
 /**
-  Write the weight matrix to the given file stream.
+  Write the weight matrix to the given stream.
 
-  @param  fs       The file stream to write the weight matrix to.
+  @param  fs       The stream to write the weight matrix to.
   @param  Weight   The weight matrix to be written.
 **/
 void
 WriteWeightMatrixToFile (
-  fstream  &fs,
-  matrix   &Weight
+  ostream       &fs,
+  const matrix  &Weight
   )
 {
-  double  Value;
-
-  int Row = Weight.getrow();
-  int Column = Weight.getcolumn();
-  for(int RowIdx = 0; RowIdx < Row; RowIdx++) {
-    for(int ColumnIdx = 0; ColumnIdx < Column; ColumnIdx++) {
-      Value = Weight.GetValue(RowIdx, ColumnIdx);
-      fs.write (reinterpret_cast<const char *>(&Value), sizeof(double));
-    }
-  }
+  fs.write (reinterpret_cast<const char *>(Weight.Data()), Weight.Size() * sizeof(double));
 }
 
 /**
@@ -50,8 +41,6 @@ FullyConnectedNetwork::ExportToFile (
   )
 {
   fstream       fs;
-  NETWORK_FILE  *FileHeader;
-  unsigned int  HdrSize;
   string        FullFileName;
 
   FullFileName = FilePath + "/" + (FileName.empty() ? "FCN_Network.dat" : FileName);
@@ -62,6 +51,25 @@ FullyConnectedNetwork::ExportToFile (
     throw std::runtime_error("ExportToFile: File opening error");
   }
 
+  ExportToStream (fs);
+
+  fs.close ();
+}
+
+/**
+  Write the network header and weights, in the format of ExportToFile(), to a stream.
+
+  @param  fs  The file or memory stream to write to.
+
+**/
+void
+FullyConnectedNetwork::ExportToStream (
+  ostream  &fs
+  ) const
+{
+  NETWORK_FILE  *FileHeader;
+  unsigned int  HdrSize;
+
   //
   // Prepare file header
   //
@@ -89,8 +97,6 @@ FullyConnectedNetwork::ExportToFile (
   for (int Index = 0; Index < (int)Weights.size(); Index++) {
     WriteWeightMatrixToFile (fs, Weights[Index]);
   }
-
-  fs.close ();
 }
 
 /**
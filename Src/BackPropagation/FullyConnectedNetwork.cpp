@@ -16,6 +16,7 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 
@@ -265,10 +266,12 @@ FullyConnectedNetwork::GetDerivativeActivationByLayer (
 }
 
 /**
-  Perturb weights of the network by adding 0.2 to each weight.
+  Perturb weights of the network by adding 0.2 to each weight, except in frozen layers.
+
+  @param[in]  Frozen  true for each weight layer to leave alone, may be shorter than the weights.
 
 **/
-void FullyConnectedNetwork::PerturbWeight()
+void FullyConnectedNetwork::PerturbWeight(const std::vector<bool> &Frozen)
 {
   int Row;
   int Column;
@@ -276,6 +279,9 @@ void FullyConnectedNetwork::PerturbWeight()
   DEBUG_LOG ("*SHAKE!!! (Perturb Weights)*");
 
   for(int Index = 0; Index < (int)Weights.size(); Index++) {
+    if ((Index < (int)Frozen.size()) && Frozen[Index]) {
+      continue;
+    }
     Row    = Weights[Index].getrow();
     Column = Weights[Index].getcolumn();
     matrix AddIn (Row, Column, 0.2);
@@ -320,6 +326,94 @@ FullyConnectedNetwork::GetWeightByLayer (
   return Weights[Layer];
 }
 
+/**
+  Get a copy of the weight matrices of all layers, e.g. to keep a snapshot of the network.
+
+  @return A vector of matrices representing the weight values of each layer.
+
+**/
+vector<matrix>
+FullyConnectedNetwork::GetWeights (
+  void
+  ) const
+{
+  return Weights;
+}
+
+/**
+  Get the weight matrices of all layers without copying them.
+
+  @return A reference to the weight matrices of each layer, valid until
+          the weights are replaced by SetWeights() or ImportFromFile().
+
+**/
+const vector<matrix> &
+FullyConnectedNetwork::GetWeightsRef (
+  void
+  ) const
+{
+  return Weights;
+}
+
+/**
+  Replace the weight matrices of all layers, e.g. to restore a snapshot of the network.
+
+  @param  NewWeights  A vector of matrices representing the weight values of each layer.
+
+  @throw std::runtime_error  If NewWeights doesn't match the layout of the network.
+
+**/
+void
+FullyConnectedNetwork::SetWeights (
+  const vector<matrix>  &NewWeights
+  )
+{
+  if (NewWeights.size() != Weights.size()) {
+    DEBUG_LOG ("Layer count of NewWeights = " << NewWeights.size() << " , Weights = " << Weights.size());
+    throw runtime_error ("Layer count of NewWeights and Weights are different. Failed to set weight");
+  }
+
+  for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)Weights.size(); LayerIdx++) {
+    if ((NewWeights[LayerIdx].getrow() != Weights[LayerIdx].getrow()) ||
+        (NewWeights[LayerIdx].getcolumn() != Weights[LayerIdx].getcolumn())) {
+      DEBUG_LOG ("Layer " << LayerIdx << " size mismatch.");
+      throw runtime_error ("Size of NewWeights and Weights are different. Failed to set weight");
+    }
+  }
+
+  Weights = NewWeights;
+}
+
+/**
+  Exchange the weight matrices of all layers with a buffer, e.g. weights updated
+  in the background. Nothing is copied or allocated.
+
+  @param  OtherWeights  Weights of the same shape as the network's, the old weights on return.
+
+  @throw std::runtime_error  If OtherWeights doesn't match the layout of the network.
+
+**/
+void
+FullyConnectedNetwork::SwapWeights (
+  vector<matrix>  &OtherWeights
+  )
+{
+  if (OtherWeights.size() != Weights.size()) {
+    DEBUG_LOG ("Layer count of OtherWeights = " << OtherWeights.size() << " , Weights = " << Weights.size());
+    throw runtime_error ("Layer count of OtherWeights and Weights are different. Failed to swap weight");
+  }
+
+  for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)Weights.size(); LayerIdx++) {
+    if ((OtherWeights[LayerIdx].getrow() != Weights[LayerIdx].getrow()) ||
+        (OtherWeights[LayerIdx].getcolumn() != Weights[LayerIdx].getcolumn())) {
+      DEBUG_LOG ("Layer " << LayerIdx << " size mismatch.");
+      throw runtime_error ("Size of OtherWeights and Weights are different. Failed to swap weight");
+    }
+  }
+
+  Weights.swap (OtherWeights);
+}
+
 /**
   Update the weight matrix of a specific layer.
 
@@ -367,18 +461,53 @@ FullyConnectedNetwork::UpdateWeight (
   }
 }
 
+/**
+  Update the weight matrix of all layers in place by one optimizer step.
+
+  @param  WeightOptimizer  The optimizer which owns the update rule and its state.
+  @param  Gradients        A vector of matrices representing the descent direction of each layer,
+                           summed over a batch.
+  @param  LearningRate     Step size of this update.
+  @param  GradientScale    Factor applied to Gradients before use (e.g. 1 / batch size).
+
+  @throw std::runtime_error  If the number of layers in Gradients and Weights are different.
+
+**/
+void
+FullyConnectedNetwork::UpdateWeight (
+  Optimizer             &WeightOptimizer,
+  const vector<matrix>  &Gradients,
+  double                LearningRate,
+  double                GradientScale
+  )
+{
+  WeightOptimizer.Step (Weights, Gradients, LearningRate, GradientScale);
+}
+
 /**
   Get the layout of the fully connected network.
 
   @return A vector of unsigned integers representing the number of nodes in each layer.
 
 **/
-vector<unsigned int>
+const NETWORK_LAYOUT &
 FullyConnectedNetwork::GetLayout () const
 {
   return Layout;
 }
 
+/**
+  Get the activation function type used by every layer of the network.
+
+  @return The activation type.
+
+**/
+ACTIVATION_TYPE
+FullyConnectedNetwork::GetActivationType () const
+{
+  return ActivationType;
+}
+
 /**
   Perform the forward pass of the fully connected network.
 
@@ -389,32 +518,79 @@ void
 FullyConnectedNetwork::Forward (
   const matrix &InputData
   )
+{
+  Forward (InputData, NodeActivation);
+}
+
+/**
+  Perform the forward pass of the fully connected network into caller provided
+  activation buffers. The network itself isn't modified, and no memory is
+  allocated once the buffers are sized.
+
+  @param  InputData   A matrix representing the input data to the network.
+  @param  Activation  Activation matrix of each layer, Layout[Layer] * 1.
+
+  @throw  std::runtime_error  Size of InputData or Activation doesn't match the layout.
+
+**/
+void
+FullyConnectedNetwork::Forward (
+  const matrix    &InputData,
+  vector<matrix>  &Activation
+  ) const
 {
   if (InputData.getrow() != Layout[0] || InputData.getcolumn() != 1) {
     DEBUG_LOG ("InputData size: " << InputData.getrow() << " * " << InputData.getcolumn()
                << ", Expected size: " << Layout[0] << " * 1");
     throw runtime_error ("Input data size does not match input layer size.");
   }
-
-  unsigned int  LayerCount = Layout.size();
+  if (Activation.size() != Layout.size()) {
+    DEBUG_LOG ("Activation layers: " << Activation.size() << ", Layout size: " << Layout.size());
+    throw runtime_error ("Activation buffers do not match network layout.");
+  }
 
   //
   // Set input layer activation
   //
-  NodeActivation[0] = InputData;
+  std::copy (InputData.Data(), InputData.Data() + InputData.Size(), Activation[0].Data());
+
+  ForwardFrom (0, Activation);
+}
+
+/**
+  Continue a forward pass from a layer whose activation is already in the buffers,
+  e.g. the first hidden layer computed for several networks at once.
+
+  @param  FirstLayer  The last layer with a valid activation.
+  @param  Activation  Activation matrix of each layer, Layout[Layer] * 1.
+
+  @throw  std::runtime_error  FirstLayer or Activation doesn't match the layout.
+
+**/
+void
+FullyConnectedNetwork::ForwardFrom (
+  unsigned int    FirstLayer,
+  vector<matrix>  &Activation
+  ) const
+{
+  if (Activation.size() != Layout.size() || FirstLayer >= Layout.size()) {
+    DEBUG_LOG ("Activation layers: " << Activation.size() << ", Layout size: " << Layout.size() << ", FirstLayer: " << FirstLayer);
+    throw runtime_error ("Activation buffers do not match network layout.");
+  }
+
+  unsigned int     LayerCount         = Layout.size();
+  ACTIVATION_FUNC  ActivationFunction = GetActivationFunction (ActivationType);
 
   //
   // Forward pass through each layer
   //
-  for (unsigned int LayerIdx = 0; LayerIdx < LayerCount - 1; LayerIdx++) {
-    matrix  CurrentLayerActivation = GetActivationByLayer (LayerIdx);
-    matrix  CurrentWeights         = GetWeightByLayer (LayerIdx);
+  for (unsigned int LayerIdx = FirstLayer; LayerIdx < LayerCount - 1; LayerIdx++) {
+    MultiplyInto (Weights[LayerIdx], Activation[LayerIdx], Activation[LayerIdx + 1]);
 
-    matrix  Z = multiply (CurrentWeights, CurrentLayerActivation);
-
-    ACTIVATION_FUNC  ActivationFunction = GetActivationFunction (ActivationType);
-
-    NodeActivation[LayerIdx + 1] = Z.ApplyElementWise (ActivationFunction);
+    double  *Z = Activation[LayerIdx + 1].Data();
+    for (unsigned int Index = 0; Index < Layout[LayerIdx + 1]; Index++) {
+      Z[Index] = ActivationFunction (Z[Index]);
+    }
   }
 }
 
@@ -10,6 +10,7 @@
 
 #include "matrix.h"
 #include "Activation.h"
+#include "Optimizer.h"
 // #include "bp.h"
 
 #include <string>
@@ -25,11 +26,13 @@ class FullyConnectedNetwork
     FullyConnectedNetwork(NETWORK_LAYOUT &);
     FullyConnectedNetwork(std::string);
     void ExportToFile(std::string, std::string); // Export the network to a file.
+    void ExportToStream(std::ostream &) const; // Export the network in file format to any stream.
     void ImportFromFile(std::string); // Import a network from a file.
 
     void ShowInfo(bool);
 
-    std::vector<unsigned int> GetLayout () const;
+    const NETWORK_LAYOUT &GetLayout () const;
+    ACTIVATION_TYPE GetActivationType () const;
 
     void SetNodeActivation (unsigned int, unsigned int, double);
     matrix GetActivationByLayer (unsigned int) const;
@@ -37,11 +40,18 @@ class FullyConnectedNetwork
     void PrintActivationInLayer (unsigned int);
   
     matrix GetWeightByLayer (unsigned int) const;
+    std::vector<matrix> GetWeights () const;
+    const std::vector<matrix> &GetWeightsRef () const; // No copy, valid until the weights are replaced.
+    void SetWeights (const std::vector<matrix> &);
+    void SwapWeights (std::vector<matrix> &); // Exchange the weights with a buffer of the same shape, no copy.
     void UpdateWeight (unsigned int, const matrix &); // Update by specific layer number.
     void UpdateWeight (const std::vector<matrix> &); // Update by all layers.
-    void PerturbWeight ();
+    void UpdateWeight (Optimizer &, const std::vector<matrix> &, double, double); // Update all layers by an optimizer step.
+    void PerturbWeight (const std::vector<bool> &); // Leaves the layers flagged frozen alone.
 
     void Forward (const matrix &);
+    void Forward (const matrix &, std::vector<matrix> &) const; // Forward into caller's activation buffers.
+    void ForwardFrom (unsigned int, std::vector<matrix> &) const; // Continue a forward pass from a layer whose activation is set.
     unsigned int Predict (const matrix &);
 
   private:
@@ -75,7 +85,7 @@ typedef struct {
 //
 // Internal helper functions
 //
-void WriteWeightMatrixToFile (std::fstream &, matrix &);
+void WriteWeightMatrixToFile (std::ostream &, const matrix &);
 
 //Batch Mode
 std::vector<matrix> BatchMode_sum(std::vector<matrix> &, std::vector<matrix> &);
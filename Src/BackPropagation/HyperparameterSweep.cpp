@@ -0,0 +1,280 @@
+/**
+  Hyperparameter sweep runner implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "HyperparameterSweep.h"
+#include "DebugLib.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+  Constructor for HyperparameterSweep class. The data sets are referenced, not
+  copied, and must stay unchanged until Run() returns.
+
+  @param[in]  TrainData  Training data.
+  @param[in]  TestData   Test data, only to report the accuracy of each configuration.
+
+**/
+HyperparameterSweep::HyperparameterSweep (
+  const DataSource  &TrainData,
+  const DataSource  &TestData
+  ) : TrainData (TrainData),
+      TestData (TestData),
+      Threads (thread::hardware_concurrency ()),
+      Seed (((u_int64_t)rand () << 32) ^ (u_int64_t)rand ())
+{
+  if (Threads == 0) {
+    Threads = 1;
+  }
+}
+
+void
+HyperparameterSweep::AddLayout (
+  const NETWORK_LAYOUT  &Layout
+  )
+{
+  if (Layout.size () < 2) {
+    DEBUG_LOG ("Layout size = " << Layout.size ());
+    throw invalid_argument ("HyperparameterSweep::AddLayout (): A network needs at least 2 layers.");
+  }
+
+  Layouts.push_back (Layout);
+}
+
+void
+HyperparameterSweep::AddLearningRate (
+  const double  LearningRate
+  )
+{
+  LearningRates.push_back (LearningRate);
+}
+
+void
+HyperparameterSweep::AddBatchSize (
+  const unsigned int  BatchSize
+  )
+{
+  BatchSizes.push_back (BatchSize);
+}
+
+/**
+  Set the number of trainings running at the same time. Defaults to the number of CPUs.
+
+**/
+void
+HyperparameterSweep::SetThreads (
+  const unsigned int  Threads
+  )
+{
+  if (Threads == 0) {
+    throw invalid_argument ("HyperparameterSweep::SetThreads (): Threads should at least be 1.");
+  }
+
+  this->Threads = Threads;
+}
+
+/**
+  Set the seed of the deterministic training of every configuration. All of them
+  hold out the same validation samples, so their validation losses compare. Drawn
+  from rand() by default.
+
+  @param[in]  Seed  Seed passed to BackPropagator::SetDeterministic().
+
+**/
+void
+HyperparameterSweep::SetSeed (
+  const u_int64_t  Seed
+  )
+{
+  this->Seed = Seed;
+}
+
+/**
+  Set a function applying the training parameters common to all configurations,
+  e.g. epochs, optimizer and early stopping. Learning rate and batch size are set
+  from the sweep afterwards.
+
+**/
+void
+HyperparameterSweep::SetConfigure (
+  function<void (BackPropagator &)>  Configure
+  )
+{
+  this->Configure = Configure;
+}
+
+/**
+  Get the test accuracy of a trained network in percent.
+
+**/
+double
+HyperparameterSweep::TestAccuracy (
+  FullyConnectedNetwork  &FCN
+  ) const
+{
+  unsigned int  Correct = 0;
+  matrix        Input;
+
+  for (unsigned int Index = 0; Index < TestData.GetSampleCount (); Index++) {
+    Correct += (FCN.Predict (TestData.GetInput (Index, Input)) == TestData.GetClass (Index)) ? 1 : 0;
+  }
+
+  return (TestData.GetSampleCount () == 0) ? 0.0 : (double)Correct / TestData.GetSampleCount () * 100;
+}
+
+/**
+  Train and test one configuration on a fresh network.
+
+**/
+SWEEP_RESULT
+HyperparameterSweep::RunOne (
+  const SWEEP_CONFIG  &Config
+  ) const
+{
+  SWEEP_RESULT    Result;
+  NETWORK_LAYOUT  Layout = Config.Layout;
+
+  Result.Config   = Config;
+  Result.Accuracy = 0.0;
+  Result.BestLoss = 0.0;
+  Result.Epochs   = 0;
+  Result.Seconds  = 0.0;
+  Result.Failed   = false;
+
+  try {
+    FullyConnectedNetwork  FCN (Layout);
+    BackPropagator         TrainingAlgoBp (FCN);
+
+    if (Configure) {
+      Configure (TrainingAlgoBp);
+    }
+    TrainingAlgoBp.SetLearningRate (Config.LearningRate);
+    TrainingAlgoBp.SetBatchSize (Config.BatchSize);
+    TrainingAlgoBp.SetVerbose (false);
+    TrainingAlgoBp.SetDeterministic (Seed);
+
+    chrono::steady_clock::time_point  Start = chrono::steady_clock::now ();
+    TrainingAlgoBp.Train (TrainData);
+    Result.Seconds = chrono::duration<double> (chrono::steady_clock::now () - Start).count ();
+
+    Result.Accuracy = TestAccuracy (FCN);
+    Result.BestLoss = TrainingAlgoBp.GetBestLoss ();
+    Result.Epochs   = TrainingAlgoBp.GetCompletedEpochs ();
+  }
+  catch (const exception &Exception) {
+    cerr << "Sweep configuration failed: " << Exception.what () << endl;
+    Result.Failed = true;
+  }
+
+  return Result;
+}
+
+/**
+  Train all configurations, Threads of them at a time.
+
+  @return  Results ranked by best validation loss, lowest first. Failed configurations come last.
+
+**/
+vector<SWEEP_RESULT>
+HyperparameterSweep::Run (
+  void
+  )
+{
+  vector<SWEEP_CONFIG>  Configs;
+
+  for (unsigned int LayoutIdx = 0; LayoutIdx < (unsigned int)Layouts.size(); LayoutIdx++) {
+    for (unsigned int LrIdx = 0; LrIdx < (unsigned int)LearningRates.size(); LrIdx++) {
+      for (unsigned int BatchIdx = 0; BatchIdx < (unsigned int)BatchSizes.size(); BatchIdx++) {
+        SWEEP_CONFIG  Config;
+
+        Config.Layout       = Layouts[LayoutIdx];
+        Config.LearningRate = LearningRates[LrIdx];
+        Config.BatchSize    = BatchSizes[BatchIdx];
+        Configs.push_back (Config);
+      }
+    }
+  }
+
+  vector<SWEEP_RESULT>  Results (Configs.size());
+  atomic<unsigned int>  NextConfig (0);
+  mutex                 OutputLock;
+  vector<thread>        Workers;
+
+  cout << "Sweeping " << Configs.size() << " configurations on " << min (Threads, (unsigned int)Configs.size()) << " threads" << endl;
+
+  for (unsigned int Index = 0; Index < min (Threads, (unsigned int)Configs.size()); Index++) {
+    Workers.push_back (thread ([&] {
+      for (unsigned int ConfigIdx = NextConfig++; ConfigIdx < (unsigned int)Configs.size(); ConfigIdx = NextConfig++) {
+        Results[ConfigIdx] = RunOne (Configs[ConfigIdx]);
+
+        lock_guard<mutex>  Guard (OutputLock);
+        cout << "  Configuration " << ConfigIdx + 1 << "/" << Configs.size() << " done" << endl;
+      }
+    }));
+  }
+
+  for (unsigned int Index = 0; Index < (unsigned int)Workers.size(); Index++) {
+    Workers[Index].join ();
+  }
+
+  stable_sort (Results.begin(), Results.end(), [] (const SWEEP_RESULT &A, const SWEEP_RESULT &B) {
+    if (A.Failed != B.Failed) {
+      return B.Failed;
+    }
+    return A.BestLoss < B.BestLoss;
+  });
+
+  return Results;
+}
+
+/**
+  Print the ranked results of Run() as a table.
+
+**/
+void
+HyperparameterSweep::ShowResults (
+  const vector<SWEEP_RESULT>  &Results
+  )
+{
+  std::ostringstream oss;
+
+  oss << std::fixed;
+  oss << endl << "============================ Sweep Results ============================" << endl;
+  oss << "  Rank  Layout              LR      Batch  Epochs   Val Loss  Test Acc(%)  Time(s)" << endl;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Results.size(); Index++) {
+    const SWEEP_RESULT  &Result = Results[Index];
+    string              Layout;
+
+    for (unsigned int Layer = 0; Layer < (unsigned int)Result.Config.Layout.size(); Layer++) {
+      Layout += (Layer == 0 ? "" : "-") + to_string (Result.Config.Layout[Layer]);
+    }
+
+    oss << setw(6) << Index + 1 << "  " << setw(18) << left << Layout << right
+        << setw(6) << setprecision(3) << Result.Config.LearningRate
+        << setw(7) << Result.Config.BatchSize;
+    if (Result.Failed) {
+      oss << "  FAILED" << endl;
+      continue;
+    }
+    oss << setw(8) << Result.Epochs
+        << setw(11) << setprecision(5) << Result.BestLoss
+        << setw(13) << setprecision(2) << Result.Accuracy
+        << setw(9) << Result.Seconds << endl;
+  }
+  oss << "=======================================================================" << endl;
+  cout << oss.str();
+}
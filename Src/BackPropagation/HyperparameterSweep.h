@@ -0,0 +1,103 @@
+/**
+  Hyperparameter sweep runner definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _HYPERPARAMETER_SWEEP_H_
+#define _HYPERPARAMETER_SWEEP_H_
+
+#include "matrix.h"
+#include "BackPropagator.h"
+#include "FullyConnectedNetwork.h"
+#include "DataSource.h"
+
+#include <vector>
+#include <functional>
+
+typedef struct {
+  NETWORK_LAYOUT  Layout;
+  double          LearningRate;
+  unsigned int    BatchSize;
+} SWEEP_CONFIG;
+
+typedef struct {
+  SWEEP_CONFIG    Config;
+  double          Accuracy;       // Test accuracy in percent, for information only.
+  double          BestLoss;       // Best monitored loss during training, the validation loss with a validation split.
+  unsigned int    Epochs;         // Epochs trained, less than configured after early stopping.
+  double          Seconds;        // Wall clock training time.
+  bool            Failed;         // Training threw, other results are invalid.
+} SWEEP_RESULT;
+
+//
+// Trains every combination of the given layouts, learning rates and batch sizes
+// on worker threads and ranks them by their best validation loss. The test set
+// is never used to choose, its accuracy is only reported, so it stays an
+// unbiased estimate. Configure the trainings with a validation split, without
+// one they are ranked by training loss. Every training is deterministic with the
+// same seed, so all of them hold out the same validation samples.
+//
+// The data set is loaded once by the caller and shared read-only by all
+// trainings; every training owns its FullyConnectedNetwork and BackPropagator.
+//
+class HyperparameterSweep
+{
+  public:
+    HyperparameterSweep (
+      const DataSource  &TrainData,
+      const DataSource  &TestData
+      );
+
+    void AddLayout (
+      const NETWORK_LAYOUT  &Layout
+      );
+
+    void AddLearningRate (
+      const double  LearningRate
+      );
+
+    void AddBatchSize (
+      const unsigned int  BatchSize
+      );
+
+    void SetThreads (
+      const unsigned int  Threads
+      );
+
+    void SetSeed (
+      const u_int64_t  Seed
+      );
+
+    void SetConfigure (
+      std::function<void (BackPropagator &)>  Configure
+      );
+
+    std::vector<SWEEP_RESULT> Run ();
+
+    static void ShowResults (
+      const std::vector<SWEEP_RESULT>  &Results
+      );
+
+  private:
+    SWEEP_RESULT RunOne (
+      const SWEEP_CONFIG  &Config
+      ) const;
+
+    double TestAccuracy (
+      FullyConnectedNetwork  &FCN
+      ) const;
+
+    const DataSource                        &TrainData;
+    const DataSource                        &TestData;
+
+    std::vector<NETWORK_LAYOUT>             Layouts;
+    std::vector<double>                     LearningRates;
+    std::vector<unsigned int>               BatchSizes;
+    unsigned int                            Threads;
+    u_int64_t                               Seed;       // Deterministic training seed of every configuration.
+    std::function<void (BackPropagator &)>  Configure;  // Common training parameters.
+};
+
+#endif
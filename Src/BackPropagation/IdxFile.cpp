@@ -0,0 +1,391 @@
+/**
+  Memory-mapped IDX file implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "IdxFile.h"
+#include "DebugLib.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/**
+  Read a 32-bit big-endian unsigned integer of the IDX header.
+
+**/
+static
+unsigned int
+ReadBigEndianU32 (
+  const u_int8_t  *Bytes
+  )
+{
+  return ((unsigned int)Bytes[0] << 24) | ((unsigned int)Bytes[1] << 16) |
+         ((unsigned int)Bytes[2] << 8)  |  (unsigned int)Bytes[3];
+}
+
+/**
+  Decode a big-endian IDX value.
+
+**/
+static
+double
+DecodeValue (
+  const u_int8_t       *Bytes,
+  const IDX_DATA_TYPE  DataType
+  )
+{
+  u_int32_t  Bits32;
+  u_int64_t  Bits64;
+  float      Float;
+  double     Double;
+
+  switch (DataType) {
+    case IDX_UNSIGNED_BYTE:
+      return Bytes[0];
+
+    case IDX_SIGNED_BYTE:
+      return (int8_t)Bytes[0];
+
+    case IDX_SHORT:
+      return (int16_t)(((u_int16_t)Bytes[0] << 8) | Bytes[1]);
+
+    case IDX_INT:
+      return (int32_t)ReadBigEndianU32 (Bytes);
+
+    case IDX_FLOAT:
+      Bits32 = ReadBigEndianU32 (Bytes);
+      memcpy (&Float, &Bits32, sizeof (Float));
+      return Float;
+
+    case IDX_DOUBLE:
+      Bits64 = ((u_int64_t)ReadBigEndianU32 (Bytes) << 32) | ReadBigEndianU32 (Bytes + 4);
+      memcpy (&Double, &Bits64, sizeof (Double));
+      return Double;
+  }
+
+  return 0.0;
+}
+
+IdxFile::IdxFile (
+  ) : Mapping (NULL),
+      MappingSize (0),
+      DataType (IDX_UNSIGNED_BYTE),
+      Data (NULL),
+      RecordSize (0)
+{
+}
+
+IdxFile::~IdxFile (
+  )
+{
+  Close ();
+}
+
+/**
+  Get the bytes of one value of an IDX data type.
+
+  @param[in]  DataType  The data type.
+
+  @return  Size of a value, 0 if DataType isn't an IDX data type.
+
+**/
+size_t
+IdxFile::GetValueSize (
+  const IDX_DATA_TYPE  DataType
+  )
+{
+  switch (DataType) {
+    case IDX_UNSIGNED_BYTE:
+    case IDX_SIGNED_BYTE:
+      return 1;
+
+    case IDX_SHORT:
+      return 2;
+
+    case IDX_INT:
+    case IDX_FLOAT:
+      return 4;
+
+    case IDX_DOUBLE:
+      return 8;
+  }
+
+  return 0;
+}
+
+/**
+  Read and check the header of an open IDX file, e.g. before mapping it or to
+  read its records without a mapping. Any data type and number of dimensions
+  is accepted, the caller checks those it needs.
+
+  @param[in]   Fd          The open file.
+  @param[in]   FileName    The name of the file, for error messages.
+  @param[out]  DataType    Type of the values.
+  @param[out]  Dimensions  Size of each dimension, the first one is the number of records.
+
+  @return  Size of the header, the offset of the first record.
+
+  @throw  runtime_error  One of the following conditions is met:
+                           * The header cannot be read.
+                           * The magic number in the file is invalid.
+                           * The file is shorter than its header says.
+
+**/
+size_t
+IdxFile::ReadHeader (
+  const int             Fd,
+  const string          &FileName,
+  IDX_DATA_TYPE         &DataType,
+  vector<unsigned int>  &Dimensions
+  )
+{
+  struct stat   FileStat;
+  u_int8_t      Bytes[4 + 4 * 0xFF];
+  unsigned int  MagicNumber;
+  unsigned int  DimensionCount;
+  size_t        HeaderSize;
+  size_t        RecordSize;
+
+  if ((fstat (Fd, &FileStat) != 0) || (pread (Fd, Bytes, 4, 0) != 4)) {
+    throw runtime_error ("Error: Invalid IDX file " + FileName);
+  }
+
+  MagicNumber    = ReadBigEndianU32 (Bytes);
+  DataType       = (IDX_DATA_TYPE)((MagicNumber >> 8) & 0xFF);
+  DimensionCount = MagicNumber & 0xFF;
+  HeaderSize     = 4 + 4 * (size_t)DimensionCount;
+  RecordSize     = GetValueSize (DataType);
+
+  if (((MagicNumber >> 16) != 0) || (RecordSize == 0)) {
+    throw runtime_error ("Error: Invalid magic number in file " + FileName +
+                         ", got " + to_string(MagicNumber)
+                        );
+  }
+  if ((DimensionCount == 0) || (pread (Fd, Bytes, HeaderSize, 0) != (ssize_t)HeaderSize)) {
+    throw runtime_error ("Error: Invalid IDX header in file " + FileName);
+  }
+
+  Dimensions.resize (DimensionCount);
+  for (unsigned int Index = 0; Index < DimensionCount; Index++) {
+    Dimensions[Index] = ReadBigEndianU32 (Bytes + 4 + 4 * Index);
+    if (Index != 0) {
+      RecordSize *= Dimensions[Index];
+    }
+  }
+
+  if ((size_t)FileStat.st_size - HeaderSize < RecordSize * Dimensions[0]) {
+    DEBUG_LOG (FileName << ": " << Dimensions[0] << " records of " << RecordSize << " bytes, file size " << FileStat.st_size);
+    throw runtime_error ("Error: IDX file " + FileName + " is shorter than its header says");
+  }
+
+  return HeaderSize;
+}
+
+/**
+  Map an IDX file and check its header.
+
+  @param[in]  FileName  The name of the IDX file to be opened.
+
+  @throw  runtime_error  One of the following conditions is met:
+                           * File cannot be opened or mapped.
+                           * The header is invalid, see ReadHeader().
+
+**/
+void
+IdxFile::Open (
+  const string  &FileName
+  )
+{
+  struct stat  FileStat;
+  size_t       HeaderSize;
+  int          Fd;
+
+  Close ();
+
+  Fd = open (FileName.c_str (), O_RDONLY);
+  if (Fd < 0) {
+    throw runtime_error ("Error: Cannot open file " + FileName);
+  }
+
+  try {
+    HeaderSize = ReadHeader (Fd, FileName, DataType, Dimensions);
+  } catch (...) {
+    close (Fd);
+    Dimensions.clear ();
+    throw;
+  }
+
+  fstat (Fd, &FileStat);
+  MappingSize = (size_t)FileStat.st_size;
+  Mapping     = mmap (NULL, MappingSize, PROT_READ, MAP_SHARED, Fd, 0);
+  close (Fd);
+  if (Mapping == MAP_FAILED) {
+    DEBUG_LOG ("mmap (" << FileName << "): " << strerror (errno));
+    Mapping = NULL;
+    Close ();
+    throw runtime_error ("Error: Cannot map file " + FileName);
+  }
+
+  //
+  // The data is read front to back, let the kernel read ahead.
+  //
+  madvise (Mapping, MappingSize, MADV_WILLNEED);
+
+  RecordSize = GetValueSize (DataType);
+  for (unsigned int Index = 1; Index < (unsigned int)Dimensions.size(); Index++) {
+    RecordSize *= Dimensions[Index];
+  }
+
+  Data = (const u_int8_t *)Mapping + HeaderSize;
+}
+
+/**
+  Unmap the file. Pointers from GetRecord() are invalid afterwards.
+
+**/
+void
+IdxFile::Close (
+  void
+  )
+{
+  if (Mapping != NULL) {
+    munmap (Mapping, MappingSize);
+  }
+
+  Mapping     = NULL;
+  MappingSize = 0;
+  Data        = NULL;
+  RecordSize  = 0;
+  Dimensions.clear ();
+}
+
+/**
+  Get the size of each dimension, the first one is the number of records.
+
+**/
+const vector<unsigned int> &
+IdxFile::GetDimensions (
+  ) const
+{
+  return Dimensions;
+}
+
+IDX_DATA_TYPE
+IdxFile::GetDataType (
+  ) const
+{
+  return DataType;
+}
+
+unsigned int
+IdxFile::GetCount (
+  ) const
+{
+  return Dimensions.empty () ? 0 : Dimensions[0];
+}
+
+/**
+  Get the number of bytes of one record, e.g. Rows * Columns of an unsigned byte image.
+
+**/
+size_t
+IdxFile::GetRecordSize (
+  ) const
+{
+  return RecordSize;
+}
+
+/**
+  Get the number of values of one record, the product of all dimensions but the first.
+
+**/
+size_t
+IdxFile::GetRecordValues (
+  ) const
+{
+  return RecordSize / GetValueSize (DataType);
+}
+
+/**
+  Get a record in the mapping, valid until the file is closed.
+
+  @param[in]  Index  Index of the record along the first dimension.
+
+  @throw  out_of_range  Index is past the last record.
+
+**/
+const u_int8_t *
+IdxFile::GetRecord (
+  const unsigned int  Index
+  ) const
+{
+  if (Index >= GetCount ()) {
+    DEBUG_LOG ("Index = " << Index << ", Count = " << GetCount ());
+    throw out_of_range ("IdxFile::GetRecord (): Index out of range.");
+  }
+
+  return Data + RecordSize * Index;
+}
+
+/**
+  Get a value of a record, decoded from the file's data type.
+
+  @param[in]  Index  Index of the record along the first dimension.
+  @param[in]  Value  Index of the value in the record.
+
+  @throw  out_of_range  Index or Value is past the end.
+
+**/
+double
+IdxFile::GetValue (
+  const unsigned int  Index,
+  const size_t        Value
+  ) const
+{
+  if (Value >= GetRecordValues ()) {
+    DEBUG_LOG ("Value = " << Value << ", RecordValues = " << GetRecordValues ());
+    throw out_of_range ("IdxFile::GetValue (): Value out of range.");
+  }
+
+  return DecodeValue (GetRecord (Index) + Value * GetValueSize (DataType), DataType);
+}
+
+/**
+  Decode all values of a record, e.g. an image of any data type.
+
+  @param[in]   Index   Index of the record along the first dimension.
+  @param[out]  Values  GetRecordValues() values.
+
+  @throw  out_of_range  Index is past the last record.
+
+**/
+void
+IdxFile::ReadValues (
+  const unsigned int  Index,
+  double              *Values
+  ) const
+{
+  const u_int8_t  *Record    = GetRecord (Index);
+  size_t          Count      = GetRecordValues ();
+  size_t          ValueSize  = GetValueSize (DataType);
+
+  if (DataType == IDX_UNSIGNED_BYTE) {
+    for (size_t Value = 0; Value < Count; Value++) {
+      Values[Value] = Record[Value];
+    }
+    return;
+  }
+
+  for (size_t Value = 0; Value < Count; Value++) {
+    Values[Value] = DecodeValue (Record + Value * ValueSize, DataType);
+  }
+}
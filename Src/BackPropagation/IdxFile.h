@@ -0,0 +1,100 @@
+/**
+  Memory-mapped IDX file definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _IDX_FILE_H_
+#define _IDX_FILE_H_
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <sys/types.h>
+
+//
+// Type of the values of an IDX file, the third byte of its magic number.
+//
+typedef enum {
+  IDX_UNSIGNED_BYTE = 0x08,
+  IDX_SIGNED_BYTE   = 0x09,
+  IDX_SHORT         = 0x0B,
+  IDX_INT           = 0x0C,
+  IDX_FLOAT         = 0x0D,
+  IDX_DOUBLE        = 0x0E
+} IDX_DATA_TYPE;
+
+//
+// Read-only view of an IDX file(e.g. the MNIST images or labels) mapped into
+// memory. The file is
+//
+//   Magic(0x0000 | Type | Dimensions) | Size[0] ... Size[Dimensions - 1] | Data
+//
+// with big-endian 32-bit header fields and big-endian values of any IDX_DATA_TYPE.
+// Record Index is the Index-th item along the first dimension, e.g. one image,
+// of all the values of the other dimensions. GetRecord() points straight into the
+// mapping, so reading a record copies nothing. GetValue() and ReadValues() decode
+// the values of any type. The mapping is shared, so processes reading the same
+// file share its pages in the page cache.
+//
+class IdxFile
+{
+  public:
+    IdxFile ();
+    ~IdxFile ();
+
+    void Open (
+      const std::string  &FileName
+      );
+
+    void Close ();
+
+    const std::vector<unsigned int> &GetDimensions () const;
+
+    IDX_DATA_TYPE GetDataType () const;
+
+    unsigned int GetCount () const;
+
+    size_t GetRecordSize () const;
+
+    size_t GetRecordValues () const;
+
+    const u_int8_t *GetRecord (
+      const unsigned int  Index
+      ) const;
+
+    double GetValue (
+      const unsigned int  Index,
+      const size_t        Value
+      ) const;
+
+    void ReadValues (
+      const unsigned int  Index,
+      double              *Values
+      ) const;
+
+    static size_t GetValueSize (
+      const IDX_DATA_TYPE  DataType
+      );
+
+    static size_t ReadHeader (
+      const int                  Fd,
+      const std::string          &FileName,
+      IDX_DATA_TYPE              &DataType,
+      std::vector<unsigned int>  &Dimensions
+      );
+
+  private:
+    IdxFile (const IdxFile &);
+    IdxFile &operator= (const IdxFile &);
+
+    void                       *Mapping;
+    size_t                     MappingSize;
+    std::vector<unsigned int>  Dimensions;
+    IDX_DATA_TYPE              DataType;
+    const u_int8_t             *Data;          // First record.
+    size_t                     RecordSize;     // Bytes per record.
+};
+
+#endif
@@ -0,0 +1,251 @@
+/**
+  Training image augmentation implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "ImageAugmenter.h"
+#include "DebugLib.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+#define FIXED_ONE  ((int64_t)1 << 16)    // 1.0 in 16.16 fixed point.
+
+/**
+  Get a uniform random number in [-1, 1).
+
+**/
+static
+double
+UniformSigned (
+  CounterRng  &Rng
+  )
+{
+  return (double)(Rng.Next () >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+/**
+  Get a pixel of a byte image, 0 outside the image.
+
+**/
+static
+int
+PixelAt (
+  const u_int8_t  *Source,
+  const int       Rows,
+  const int       Columns,
+  const int       Row,
+  const int       Column
+  )
+{
+  if ((Row < 0) || (Row >= Rows) || (Column < 0) || (Column >= Columns)) {
+    return 0;
+  }
+
+  return Source[Row * Columns + Column];
+}
+
+ImageAugmenter::ImageAugmenter (
+  )
+{
+  memset (&Params, 0, sizeof (Params));
+}
+
+/**
+  Set the largest change of each kind, 0 turns a kind off.
+
+  @param[in]  Params  The largest changes.
+
+  @throw  invalid_argument  A rotation or elastic distortion is negative, or the noise is above 255.
+
+**/
+void
+ImageAugmenter::SetParams (
+  const AUGMENT_PARAMS  &Params
+  )
+{
+  if ((Params.MaxRotation < 0.0) || (Params.MaxElastic < 0.0) || (Params.MaxNoise > 255)) {
+    DEBUG_LOG ("MaxRotation = " << Params.MaxRotation << ", MaxElastic = " << Params.MaxElastic << ", MaxNoise = " << Params.MaxNoise);
+    throw invalid_argument ("ImageAugmenter::SetParams (): Invalid Params.");
+  }
+
+  this->Params = Params;
+}
+
+const AUGMENT_PARAMS &
+ImageAugmenter::GetParams (
+  ) const
+{
+  return Params;
+}
+
+bool
+ImageAugmenter::IsEnabled (
+  ) const
+{
+  return (Params.MaxShift != 0) || (Params.MaxRotation != 0.0) || (Params.MaxElastic != 0.0) || (Params.MaxNoise != 0);
+}
+
+/**
+  Write a randomly changed copy of an image. Draws the random amounts from Rng,
+  so the same stream gives the same copy.
+
+  @param[in]      Source   Rows * Columns bytes of the image.
+  @param[in]      Rows     Height of the image.
+  @param[in]      Columns  Width of the image.
+  @param[in,out]  Rng      Random stream of this image.
+  @param[out]     Target   Rows * Columns bytes of the changed image, not overlapping Source.
+
+**/
+void
+ImageAugmenter::Apply (
+  const u_int8_t      *Source,
+  const unsigned int  Rows,
+  const unsigned int  Columns,
+  CounterRng          &Rng,
+  u_int8_t            *Target
+  ) const
+{
+  const size_t  PixelCount = (size_t)Rows * Columns;
+  int           ShiftX = 0;
+  int           ShiftY = 0;
+  double        Angle  = 0.0;
+  int64_t       FieldX[AUGMENT_ELASTIC_GRID + 1][AUGMENT_ELASTIC_GRID + 1];
+  int64_t       FieldY[AUGMENT_ELASTIC_GRID + 1][AUGMENT_ELASTIC_GRID + 1];
+  bool          Elastic = (Params.MaxElastic != 0.0) && (Rows > 1) && (Columns > 1);
+
+  if (Params.MaxShift != 0) {
+    ShiftX = (int)Rng.Below (2 * Params.MaxShift + 1) - (int)Params.MaxShift;
+    ShiftY = (int)Rng.Below (2 * Params.MaxShift + 1) - (int)Params.MaxShift;
+  }
+  if (Params.MaxRotation != 0.0) {
+    Angle = UniformSigned (Rng) * Params.MaxRotation * M_PI / 180.0;
+  }
+  if (Elastic) {
+    for (unsigned int Row = 0; Row <= AUGMENT_ELASTIC_GRID; Row++) {
+      for (unsigned int Column = 0; Column <= AUGMENT_ELASTIC_GRID; Column++) {
+        FieldX[Row][Column] = llround (UniformSigned (Rng) * Params.MaxElastic * FIXED_ONE);
+        FieldY[Row][Column] = llround (UniformSigned (Rng) * Params.MaxElastic * FIXED_ONE);
+      }
+    }
+  }
+
+  if ((ShiftX == 0) && (ShiftY == 0) && (Angle == 0.0) && !Elastic) {
+    memcpy (Target, Source, PixelCount);
+  } else {
+    //
+    // Source position of a target pixel, rotated by -Angle around the center:
+    //   SourceX =  Cos * (X - CenterX - ShiftX) + Sin * (Y - CenterY - ShiftY) + CenterX
+    //   SourceY = -Sin * (X - CenterX - ShiftX) + Cos * (Y - CenterY - ShiftY) + CenterY
+    // Along a row both change by a constant step, so only the row start is multiplied.
+    //
+    const int64_t  Cos      = llround (cos (Angle) * FIXED_ONE);
+    const int64_t  Sin      = llround (sin (Angle) * FIXED_ONE);
+    const int64_t  CenterX  = (int64_t)(Columns - 1) * FIXED_ONE / 2;
+    const int64_t  CenterY  = (int64_t)(Rows - 1) * FIXED_ONE / 2;
+    const int64_t  StepU    = Elastic ? AUGMENT_ELASTIC_GRID * FIXED_ONE / (Columns - 1) : 0;
+    int64_t        RowFieldX[AUGMENT_ELASTIC_GRID + 1];
+    int64_t        RowFieldY[AUGMENT_ELASTIC_GRID + 1];
+
+    memset (RowFieldX, 0, sizeof (RowFieldX));
+    memset (RowFieldY, 0, sizeof (RowFieldY));
+
+    for (unsigned int Y = 0; Y < Rows; Y++) {
+      int64_t  DeltaX  = -(int64_t)ShiftX * FIXED_ONE - CenterX;
+      int64_t  DeltaY  = ((int64_t)Y - ShiftY) * FIXED_ONE - CenterY;
+      int64_t  SourceX = ((Cos * DeltaX + Sin * DeltaY) >> 16) + CenterX;
+      int64_t  SourceY = ((Cos * DeltaY - Sin * DeltaX) >> 16) + CenterY;
+      u_int8_t *Line   = Target + (size_t)Y * Columns;
+
+      //
+      // The elastic field of this row, between the two grid rows around it.
+      //
+      if (Elastic) {
+        int64_t  V     = (int64_t)Y * AUGMENT_ELASTIC_GRID * FIXED_ONE / (Rows - 1);
+        int64_t  Above = min (V >> 16, (int64_t)AUGMENT_ELASTIC_GRID - 1);
+        int64_t  Part  = V - Above * FIXED_ONE;
+
+        for (unsigned int Column = 0; Column <= AUGMENT_ELASTIC_GRID; Column++) {
+          RowFieldX[Column] = FieldX[Above][Column] + (((FieldX[Above + 1][Column] - FieldX[Above][Column]) * Part) >> 16);
+          RowFieldY[Column] = FieldY[Above][Column] + (((FieldY[Above + 1][Column] - FieldY[Above][Column]) * Part) >> 16);
+        }
+      }
+
+      for (unsigned int X = 0; X < Columns; X++, SourceX += Cos, SourceY -= Sin) {
+        int64_t  PointX = SourceX;
+        int64_t  PointY = SourceY;
+
+        if (Elastic) {
+          int64_t  U    = (int64_t)X * StepU;
+          int64_t  Left = min (U >> 16, (int64_t)AUGMENT_ELASTIC_GRID - 1);
+          int64_t  Part = U - Left * FIXED_ONE;
+
+          PointX += RowFieldX[Left] + (((RowFieldX[Left + 1] - RowFieldX[Left]) * Part) >> 16);
+          PointY += RowFieldY[Left] + (((RowFieldY[Left + 1] - RowFieldY[Left]) * Part) >> 16);
+        }
+
+        //
+        // Bilinear sample with 8-bit weights, exact for whole-pixel positions.
+        //
+        int  Column0 = (int)(PointX >> 16);
+        int  Row0    = (int)(PointY >> 16);
+        int  WeightX = (int)((PointX >> 8) & 0xFF);
+        int  WeightY = (int)((PointY >> 8) & 0xFF);
+        int  P00, P01, P10, P11;
+
+        if ((Column0 >= 0) && (Column0 + 1 < (int)Columns) && (Row0 >= 0) && (Row0 + 1 < (int)Rows)) {
+          const u_int8_t  *Pixel = Source + (size_t)Row0 * Columns + Column0;
+
+          P00 = Pixel[0];
+          P01 = Pixel[1];
+          P10 = Pixel[Columns];
+          P11 = Pixel[Columns + 1];
+        } else {
+          P00 = PixelAt (Source, (int)Rows, (int)Columns, Row0, Column0);
+          P01 = PixelAt (Source, (int)Rows, (int)Columns, Row0, Column0 + 1);
+          P10 = PixelAt (Source, (int)Rows, (int)Columns, Row0 + 1, Column0);
+          P11 = PixelAt (Source, (int)Rows, (int)Columns, Row0 + 1, Column0 + 1);
+        }
+
+        Line[X] = (u_int8_t)(((P00 * (256 - WeightX) + P01 * WeightX) * (256 - WeightY) +
+                              (P10 * (256 - WeightX) + P11 * WeightX) * WeightY + 32768) >> 16);
+      }
+    }
+  }
+
+  //
+  // Noise in [-MaxNoise, MaxNoise] from 8 bits per pixel, added with saturation.
+  //
+  if (Params.MaxNoise != 0) {
+    const int  Range = 2 * (int)Params.MaxNoise + 1;
+
+    for (size_t First = 0; First < PixelCount; First += 8) {
+      u_int64_t  Bits = Rng.Next ();
+      size_t     End  = min (First + 8, PixelCount);
+
+      for (size_t Pixel = First; Pixel < End; Pixel++, Bits >>= 8) {
+        int  Value = Target[Pixel] + (((int)(Bits & 0xFF) * Range) >> 8) - (int)Params.MaxNoise;
+
+        Target[Pixel] = (u_int8_t)min (max (Value, 0), 255);
+      }
+    }
+  }
+}
+
+void
+ImageAugmenter::ShowInfo (
+  ) const
+{
+  if (!IsEnabled ()) {
+    return;
+  }
+
+  cout << "  Augmentation  : shift " << Params.MaxShift << ", rotation " << Params.MaxRotation
+       << " deg, elastic " << Params.MaxElastic << ", noise " << Params.MaxNoise << endl;
+}
@@ -0,0 +1,70 @@
+/**
+  Training image augmentation definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _IMAGE_AUGMENTER_H_
+#define _IMAGE_AUGMENTER_H_
+
+#include "CounterRng.h"
+
+#include <sys/types.h>
+
+//
+// Control points per side of the elastic displacement field, which is smooth
+// between them.
+//
+#define AUGMENT_ELASTIC_GRID  4
+
+//
+// Largest random change of each kind, each applied with a random amount in
+// [-Max, Max]. 0 turns a kind off.
+//
+typedef struct {
+  unsigned int  MaxShift;          // Pixels, horizontally and vertically.
+  double        MaxRotation;       // Degrees around the image center.
+  double        MaxElastic;        // Pixels a control point of the elastic field moves.
+  unsigned int  MaxNoise;          // Change of each pixel value.
+} AUGMENT_PARAMS;
+
+//
+// Random shifts, small rotations, elastic distortions and noise applied to a
+// byte image while training, so no augmented copies of the data set are stored.
+//
+// Apply() maps every target pixel back into the source image with one 16.16
+// fixed-point transform (shift, rotation and the elastic field together) and
+// samples it bilinearly with 8-bit weights. Pixels from outside the source are
+// 0. The noise is added with saturation. Everything is integer arithmetic on
+// the bytes, and nothing is allocated, so threads can share one augmenter,
+// each with its own random stream.
+//
+class ImageAugmenter
+{
+  public:
+    ImageAugmenter ();
+
+    void SetParams (
+      const AUGMENT_PARAMS  &Params
+      );
+
+    const AUGMENT_PARAMS &GetParams () const;
+
+    bool IsEnabled () const;
+
+    void Apply (
+      const u_int8_t      *Source,
+      const unsigned int  Rows,
+      const unsigned int  Columns,
+      CounterRng          &Rng,
+      u_int8_t            *Target
+      ) const;
+
+    void ShowInfo () const;
+
+  private:
+    AUGMENT_PARAMS  Params;
+};
+
+#endif
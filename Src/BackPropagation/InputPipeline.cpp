@@ -0,0 +1,362 @@
+/**
+  Background input pipeline implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "InputPipeline.h"
+#include "DebugLib.h"
+
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+InputPipeline::InputPipeline (
+  ) : ChunkSize (0),
+      InputSize (0),
+      Data (NULL),
+      Order (NULL),
+      Augmenter (NULL),
+      AugmentSeed (0),
+      ChunkCount (0),
+      ActiveThreads (0),
+      Position (0),
+      Current (NULL),
+      Generation (0),
+      NextChunk (0),
+      Released (0),
+      Busy (0),
+      Cancelled (false),
+      Stopping (false),
+      StallSeconds (0.0),
+      WaitSeconds (0.0)
+{
+}
+
+InputPipeline::~InputPipeline (
+  )
+{
+  Stop ();
+}
+
+/**
+  Start the threads and allocate their buffers, unless they already match.
+
+  @param[in]  Threads    Number of background threads, Threads + 1 buffers.
+  @param[in]  ChunkSize  Number of samples per buffer.
+  @param[in]  InputSize  Number of values of a sample's input.
+
+  @throw  invalid_argument  A parameter is 0.
+
+**/
+void
+InputPipeline::Init (
+  const unsigned int  Threads,
+  const unsigned int  ChunkSize,
+  const unsigned int  InputSize
+  )
+{
+  if ((Threads == 0) || (ChunkSize == 0) || (InputSize == 0)) {
+    DEBUG_LOG ("Threads = " << Threads << ", ChunkSize = " << ChunkSize << ", InputSize = " << InputSize);
+    throw invalid_argument ("InputPipeline::Init (): Invalid parameter.");
+  }
+
+  if ((Threads == GetThreads ()) && (ChunkSize == this->ChunkSize) && (InputSize == this->InputSize)) {
+    return;
+  }
+
+  Stop ();
+
+  this->ChunkSize = ChunkSize;
+  this->InputSize = InputSize;
+
+  Slots.resize (Threads + 1);
+  for (unsigned int SlotIdx = 0; SlotIdx < (unsigned int)Slots.size(); SlotIdx++) {
+    Slots[SlotIdx].Buffers.assign (ChunkSize, matrix (InputSize, 1));
+    Slots[SlotIdx].Inputs.assign (ChunkSize, NULL);
+    Slots[SlotIdx].Chunk  = 0;
+    Slots[SlotIdx].Filled = false;
+  }
+
+  Scratch.assign (Threads, vector<u_int8_t> (InputSize));
+
+  Stopping = false;
+  for (unsigned int Thread = 0; Thread < Threads; Thread++) {
+    Producers.push_back (thread (&InputPipeline::ProducerLoop, this, Thread, Generation, GetHeapAllocationCounter ()));
+  }
+}
+
+unsigned int
+InputPipeline::GetThreads (
+  ) const
+{
+  return (unsigned int)Producers.size();
+}
+
+unsigned int
+InputPipeline::GetSlotCount (
+  ) const
+{
+  return (unsigned int)Slots.size();
+}
+
+unsigned int
+InputPipeline::GetChunkSize (
+  ) const
+{
+  return ChunkSize;
+}
+
+/**
+  Start filling the inputs of an epoch. Data, Order and Augmenter must stay valid
+  until Finish().
+
+  @param[in]  Data         The data samples.
+  @param[in]  Order        Indices of the samples, in the order Next() returns them.
+  @param[in]  Augmenter    Changes every image at random, NULL for none.
+  @param[in]  AugmentSeed  Seed of this epoch's changes.
+
+  @throw  logic_error  Not initialized, or the previous epoch isn't finished.
+
+**/
+void
+InputPipeline::Start (
+  const DataSource            &Data,
+  const vector<unsigned int>  &Order,
+  const ImageAugmenter        *Augmenter,
+  const u_int64_t             AugmentSeed
+  )
+{
+  lock_guard<mutex>  Guard (Lock);
+
+  if (Producers.empty () || (Busy != 0)) {
+    throw logic_error ("InputPipeline::Start (): Not initialized or not finished.");
+  }
+
+  for (unsigned int SlotIdx = 0; SlotIdx < (unsigned int)Slots.size(); SlotIdx++) {
+    Slots[SlotIdx].Filled = false;
+  }
+
+  this->Data        = &Data;
+  this->Order       = &Order;
+  this->Augmenter   = Augmenter;
+  this->AugmentSeed = AugmentSeed;
+  ChunkCount    = (unsigned int)((Order.size() + ChunkSize - 1) / ChunkSize);
+  ActiveThreads = Data.IsConcurrent () ? GetThreads () : 1;
+  Position      = 0;
+  Current       = NULL;
+  NextChunk     = 0;
+  Released      = 0;
+  Busy          = GetThreads ();
+  Cancelled     = false;
+  Failure       = nullptr;
+  StallSeconds  = 0.0;
+  WaitSeconds   = 0.0;
+  Generation++;
+
+  Started.notify_all ();
+}
+
+/**
+  Get the input of the next sample of the epoch, waiting for its buffer if needed.
+  The previous input is invalid afterwards.
+
+  @throw  out_of_range  All samples of the epoch were returned.
+  @throw  The exception a thread got while filling the buffer.
+
+**/
+const matrix &
+InputPipeline::Next (
+  void
+  )
+{
+  if ((Order == NULL) || (Position >= (unsigned int)Order->size())) {
+    throw out_of_range ("InputPipeline::Next (): No more samples in this epoch.");
+  }
+
+  if ((Position % ChunkSize) == 0) {
+    unsigned int        Chunk = Position / ChunkSize;
+    INPUT_SLOT          &Slot = Slots[Chunk % Slots.size()];
+    unique_lock<mutex>  Guard (Lock);
+
+    //
+    // Done with the previous chunk, its slot can take the next one.
+    //
+    if (Current != NULL) {
+      Current->Filled = false;
+      Released        = Chunk;
+      Freed.notify_all ();
+    }
+
+    if (!(Slot.Filled && (Slot.Chunk == Chunk)) && !Failure) {
+      chrono::steady_clock::time_point  WaitStart = chrono::steady_clock::now ();
+
+      Filled.wait (Guard, [&] { return (Slot.Filled && (Slot.Chunk == Chunk)) || Failure; });
+      StallSeconds += chrono::duration<double> (chrono::steady_clock::now () - WaitStart).count ();
+    }
+
+    if (Failure) {
+      rethrow_exception (Failure);
+    }
+
+    Current = &Slot;
+  }
+
+  return *Current->Inputs[Position++ % ChunkSize];
+}
+
+/**
+  End the epoch: stop the threads filling, wait until they are idle and release
+  every buffer. Also called to leave an epoch early, e.g. on an exception.
+
+**/
+void
+InputPipeline::Finish (
+  void
+  )
+{
+  unique_lock<mutex>  Guard (Lock);
+
+  Cancelled = true;
+  Freed.notify_all ();
+  Idle.wait (Guard, [this] { return Busy == 0; });
+
+  Data      = NULL;
+  Order     = NULL;
+  Augmenter = NULL;
+  Current   = NULL;
+}
+
+double
+InputPipeline::GetStallSeconds (
+  ) const
+{
+  return StallSeconds;
+}
+
+double
+InputPipeline::GetWaitSeconds (
+  ) const
+{
+  return WaitSeconds;
+}
+
+/**
+  End the threads. Must not be called between Start() and Finish().
+
+**/
+void
+InputPipeline::Stop (
+  void
+  )
+{
+  {
+    lock_guard<mutex>  Guard (Lock);
+
+    Stopping = true;
+  }
+  Started.notify_all ();
+
+  for (unsigned int Thread = 0; Thread < (unsigned int)Producers.size(); Thread++) {
+    Producers[Thread].join ();
+  }
+  Producers.clear ();
+}
+
+/**
+  [Background thread] Convert the inputs of a chunk's samples into a slot,
+  changing them with the augmenter if there is one.
+
+**/
+void
+InputPipeline::FillSlot (
+  INPUT_SLOT    &Slot,
+  unsigned int  Chunk,
+  unsigned int  Thread
+  )
+{
+  unsigned int  First = Chunk * ChunkSize;
+  unsigned int  Count = min (ChunkSize, (unsigned int)Order->size() - First);
+
+  for (unsigned int Sample = 0; Sample < Count; Sample++) {
+    unsigned int  Index = (*Order)[First + Sample];
+
+    if (Augmenter == NULL) {
+      Slot.Inputs[Sample] = &Data->GetInput (Index, Slot.Buffers[Sample]);
+    } else {
+      CounterRng  Rng (AugmentSeed, Index);
+
+      Slot.Inputs[Sample] = &Data->GetAugmentedInput (Index, *Augmenter, Rng, Scratch[Thread], Slot.Buffers[Sample]);
+    }
+  }
+}
+
+/**
+  [Background thread] Take the next chunk of every epoch, wait until its slot is
+  free and fill it, until all chunks are taken or the epoch is cancelled.
+
+**/
+void
+InputPipeline::ProducerLoop (
+  unsigned int             Thread,
+  unsigned int             Seen,
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+  SetHeapAllocationCounter (Counter);
+
+  unique_lock<mutex>  Guard (Lock);
+
+  while (true) {
+    Started.wait (Guard, [this, Seen] { return Stopping || (Generation != Seen); });
+    if (Stopping) {
+      return;
+    }
+    Seen = Generation;
+
+    while ((Thread < ActiveThreads) && !Cancelled && (NextChunk < ChunkCount)) {
+      unsigned int  Chunk = NextChunk++;
+      INPUT_SLOT    &Slot = Slots[Chunk % Slots.size()];
+
+      //
+      // The slot is free once the trainer is done with the chunk it held before.
+      //
+      if (Chunk + 1 > Released + (unsigned int)Slots.size()) {
+        chrono::steady_clock::time_point  WaitStart = chrono::steady_clock::now ();
+
+        Freed.wait (Guard, [&] { return Cancelled || (Chunk + 1 <= Released + (unsigned int)Slots.size()); });
+        WaitSeconds += chrono::duration<double> (chrono::steady_clock::now () - WaitStart).count ();
+      }
+      if (Cancelled) {
+        break;
+      }
+
+      Guard.unlock ();
+      try {
+        FillSlot (Slot, Chunk, Thread);
+      }
+      catch (...) {
+        Guard.lock ();
+        if (!Failure) {
+          Failure = current_exception ();
+        }
+        Cancelled = true;
+        Filled.notify_all ();
+        Freed.notify_all ();
+        break;
+      }
+      Guard.lock ();
+
+      Slot.Chunk  = Chunk;
+      Slot.Filled = true;
+      Filled.notify_all ();
+    }
+
+    if (--Busy == 0) {
+      Idle.notify_all ();
+    }
+  }
+}
@@ -0,0 +1,134 @@
+/**
+  Background input pipeline definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _INPUT_PIPELINE_H_
+#define _INPUT_PIPELINE_H_
+
+#include "matrix.h"
+#include "DataSource.h"
+#include "ImageAugmenter.h"
+#include "AllocCounter.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+//
+// One buffer of the pipeline: the inputs of ChunkSize consecutive samples.
+//
+typedef struct {
+  std::vector<matrix>          Buffers;   // Converted inputs, sized once by Init().
+  std::vector<const matrix *>  Inputs;    // Input of every sample, a buffer or the source's own matrix.
+  unsigned int                 Chunk;     // Number of the chunk held, valid when Filled.
+  bool                         Filled;
+} INPUT_SLOT;
+
+//
+// Prepares the inputs of an epoch's samples on background threads while the
+// trainer works through them, e.g. converting compact bytes into doubles or
+// reading them from disk.
+//
+// Start() takes the samples in the order they will be trained, and the threads
+// fill them ChunkSize at a time into Threads + 1 buffers. With one thread the
+// trainer reads one buffer while the other one is filled. A buffer is only
+// refilled after the trainer has moved past it, so the memory is bounded.
+//
+// Next() returns the input of the next sample, valid until the following call.
+// Time the trainer waits in Next() is its stall time, time the threads wait for
+// a free buffer is their wait time: a stall says the threads are too slow, a
+// wait says they are ahead.
+//
+// With an augmenter, the threads also change every image on its way into its
+// buffer. Sample Index draws from stream Index of the epoch's seed, so the
+// changes don't depend on the number of threads or on which thread fills it.
+//
+// A source that can't be read by several threads at once is read by one thread.
+// Start(), Next() and Finish() don't allocate, so they can be part of a
+// steady-state training step.
+//
+class InputPipeline
+{
+  public:
+    InputPipeline ();
+    ~InputPipeline ();
+
+    void Init (
+      const unsigned int  Threads,
+      const unsigned int  ChunkSize,
+      const unsigned int  InputSize
+      );
+
+    unsigned int GetThreads () const;
+    unsigned int GetSlotCount () const;
+    unsigned int GetChunkSize () const;
+
+    void Start (
+      const DataSource                 &Data,
+      const std::vector<unsigned int>  &Order,
+      const ImageAugmenter             *Augmenter,
+      const u_int64_t                  AugmentSeed
+      );
+
+    const matrix &Next ();
+
+    void Finish ();
+
+    //
+    // Seconds since the last Start(), the wait time summed over the threads.
+    //
+    double GetStallSeconds () const;
+    double GetWaitSeconds () const;
+
+    void Stop ();
+
+  private:
+    void ProducerLoop (
+      unsigned int             Thread,
+      unsigned int             Seen,       // Generation before the thread's first epoch.
+      HEAP_ALLOCATION_COUNTER  *Counter    // Allocation counter of the starting thread.
+      );
+
+    void FillSlot (
+      INPUT_SLOT    &Slot,
+      unsigned int  Chunk,
+      unsigned int  Thread
+      );
+
+    std::vector<INPUT_SLOT>           Slots;
+    std::vector<std::thread>          Producers;
+    std::vector<std::vector<u_int8_t> > Scratch;      // Augmented image of every thread.
+    unsigned int                      ChunkSize;
+    unsigned int                      InputSize;
+
+    const DataSource                  *Data;          // Source and order of the current epoch.
+    const std::vector<unsigned int>   *Order;
+    const ImageAugmenter              *Augmenter;     // NULL for unchanged inputs.
+    u_int64_t                         AugmentSeed;
+    unsigned int                      ChunkCount;
+    unsigned int                      ActiveThreads;
+    unsigned int                      Position;      // Samples returned by Next().
+    INPUT_SLOT                        *Current;       // Slot of the last sample returned.
+
+    std::mutex                        Lock;
+    std::condition_variable           Started;       // New epoch or Stopping, for the threads.
+    std::condition_variable           Filled;        // A slot filled or a failure, for Next().
+    std::condition_variable           Freed;         // A slot released or Cancelled, for the threads.
+    std::condition_variable           Idle;          // All threads done with the epoch, for Finish().
+    unsigned int                      Generation;    // Epochs started, the threads wait for the next one.
+    unsigned int                      NextChunk;     // Next chunk a thread takes.
+    unsigned int                      Released;      // Chunks the trainer is done with.
+    unsigned int                      Busy;          // Threads not done with this epoch.
+    bool                              Cancelled;
+    bool                              Stopping;
+    std::exception_ptr                Failure;
+    double                            StallSeconds;
+    double                            WaitSeconds;
+};
+
+#endif
@@ -0,0 +1,233 @@
+/**
+  Learning rate scheduler class implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "LrScheduler.h"
+#include "DebugLib.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+  Constructor for LrScheduler class. Defaults to a constant learning rate.
+
+**/
+LrScheduler::LrScheduler (
+  ) : Type (LR_SCHEDULE_CONSTANT),
+      BaseLearningRate (0.1),
+      MinLearningRate (0.0),
+      Epochs (1),
+      StepEpochs (10),
+      Gamma (0.5),
+      Patience (3),
+      Factor (0.5),
+      PlateauLearningRate (0.1),
+      PlateauBestLoss (numeric_limits<double>::infinity()),
+      PlateauBadEpochs (0)
+{
+}
+
+void
+LrScheduler::SetType (
+  const LR_SCHEDULE_TYPE  Type
+  )
+{
+  if (Type >= LR_SCHEDULE_TYPE_MAX) {
+    DEBUG_LOG ("LR schedule type = " << Type << " is unsupported.");
+    throw invalid_argument ("LrScheduler::SetType (): Unsupported schedule type.");
+  }
+
+  this->Type = Type;
+}
+
+void
+LrScheduler::SetStepParams (
+  const unsigned int  StepEpochs,
+  const double        Gamma
+  )
+{
+  if (StepEpochs == 0 || Gamma <= 0.0) {
+    DEBUG_LOG ("StepEpochs = " << StepEpochs << ", Gamma = " << Gamma);
+    throw invalid_argument ("LrScheduler::SetStepParams (): Invalid step parameters.");
+  }
+
+  this->StepEpochs = StepEpochs;
+  this->Gamma      = Gamma;
+}
+
+void
+LrScheduler::SetCosineParams (
+  const double  MinLearningRate
+  )
+{
+  if (MinLearningRate < 0.0) {
+    DEBUG_LOG ("MinLearningRate = " << MinLearningRate);
+    throw invalid_argument ("LrScheduler::SetCosineParams (): Invalid minimum learning rate.");
+  }
+
+  this->MinLearningRate = MinLearningRate;
+}
+
+void
+LrScheduler::SetPlateauParams (
+  const unsigned int  Patience,
+  const double        Factor,
+  const double        MinLearningRate
+  )
+{
+  if (Patience == 0 || Factor <= 0.0 || Factor >= 1.0 || MinLearningRate < 0.0) {
+    DEBUG_LOG ("Patience = " << Patience << ", Factor = " << Factor << ", MinLearningRate = " << MinLearningRate);
+    throw invalid_argument ("LrScheduler::SetPlateauParams (): Invalid plateau parameters.");
+  }
+
+  this->Patience        = Patience;
+  this->Factor          = Factor;
+  this->MinLearningRate = MinLearningRate;
+}
+
+/**
+  Reset the schedule at the start of a training run.
+
+  @param[in]  BaseLearningRate  Learning rate of the first epoch.
+  @param[in]  Epochs            Total number of epochs of the run.
+
+**/
+void
+LrScheduler::Init (
+  const double        BaseLearningRate,
+  const unsigned int  Epochs
+  )
+{
+  this->BaseLearningRate = BaseLearningRate;
+  this->Epochs           = (Epochs == 0) ? 1 : Epochs;
+
+  PlateauLearningRate = BaseLearningRate;
+  PlateauBestLoss     = numeric_limits<double>::infinity();
+  PlateauBadEpochs    = 0;
+}
+
+/**
+  Get the learning rate to be used in an epoch.
+
+  @param[in]  Epoch  Epoch number, starting from 1.
+
+  @return  The learning rate of Epoch.
+
+**/
+double
+LrScheduler::GetLearningRate (
+  const unsigned int  Epoch
+  ) const
+{
+  unsigned int  Elapsed = (Epoch == 0) ? 0 : Epoch - 1;
+
+  switch (Type) {
+    case LR_SCHEDULE_STEP:
+      return BaseLearningRate * pow (Gamma, (double)(Elapsed / StepEpochs));
+
+    case LR_SCHEDULE_COSINE:
+      return MinLearningRate +
+             (BaseLearningRate - MinLearningRate) * 0.5 * (1.0 + cos (M_PI * (double)Elapsed / (double)Epochs));
+
+    case LR_SCHEDULE_PLATEAU:
+      return PlateauLearningRate;
+
+    default:
+      return BaseLearningRate;
+  }
+}
+
+/**
+  Feed the monitored loss of a finished epoch to the schedule.
+  Only PLATEAU schedule reacts to it.
+
+  @param[in]  MonitoredLoss  Validation loss, or training loss if there is no validation set.
+
+**/
+void
+LrScheduler::Observe (
+  const double  MonitoredLoss
+  )
+{
+  if (Type != LR_SCHEDULE_PLATEAU) {
+    return;
+  }
+
+  if (MonitoredLoss < PlateauBestLoss) {
+    PlateauBestLoss  = MonitoredLoss;
+    PlateauBadEpochs = 0;
+    return;
+  }
+
+  PlateauBadEpochs++;
+  if (PlateauBadEpochs >= Patience) {
+    PlateauLearningRate = fmax (PlateauLearningRate * Factor, MinLearningRate);
+    PlateauBadEpochs    = 0;
+    DEBUG_LOG ("Loss plateau, learning rate reduced to " << PlateauLearningRate);
+  }
+}
+
+/**
+  Get the state PLATEAU schedule has built up from the observed losses, to be checkpointed.
+
+**/
+void
+LrScheduler::GetPlateauState (
+  double        &LearningRate,
+  double        &BestLoss,
+  unsigned int  &BadEpochs
+  ) const
+{
+  LearningRate = PlateauLearningRate;
+  BestLoss     = PlateauBestLoss;
+  BadEpochs    = PlateauBadEpochs;
+}
+
+/**
+  Restore the state saved by GetPlateauState(), after Init() when resuming a training.
+
+**/
+void
+LrScheduler::RestorePlateauState (
+  const double        LearningRate,
+  const double        BestLoss,
+  const unsigned int  BadEpochs
+  )
+{
+  PlateauLearningRate = LearningRate;
+  PlateauBestLoss     = BestLoss;
+  PlateauBadEpochs    = BadEpochs;
+}
+
+void
+LrScheduler::ShowInfo (
+  void
+  ) const
+{
+  static const char  *TypeName[] = { "CONSTANT", "STEP", "COSINE", "PLATEAU" };
+
+  cout << "  LR Schedule   : " << TypeName[Type];
+  switch (Type) {
+    case LR_SCHEDULE_STEP:
+      cout << " (every " << StepEpochs << " epochs x " << Gamma << ")";
+      break;
+
+    case LR_SCHEDULE_COSINE:
+      cout << " (min " << MinLearningRate << ")";
+      break;
+
+    case LR_SCHEDULE_PLATEAU:
+      cout << " (patience " << Patience << ", x " << Factor << ", min " << MinLearningRate << ")";
+      break;
+
+    default:
+      break;
+  }
+  cout << endl;
+}
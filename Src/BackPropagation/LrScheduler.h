@@ -0,0 +1,94 @@
+/**
+  Learning rate scheduler class definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _LR_SCHEDULER_H_
+#define _LR_SCHEDULER_H_
+
+typedef enum {
+  LR_SCHEDULE_CONSTANT = 0,
+  LR_SCHEDULE_STEP,
+  LR_SCHEDULE_COSINE,
+  LR_SCHEDULE_PLATEAU,
+  LR_SCHEDULE_TYPE_MAX
+} LR_SCHEDULE_TYPE;
+
+//
+// Per-epoch learning rate policy.
+//
+//   CONSTANT : Lr = Base
+//   STEP     : Lr = Base * Gamma ^ floor((Epoch - 1) / StepEpochs)
+//   COSINE   : Lr = Min + (Base - Min) * (1 + cos(pi * (Epoch - 1) / Epochs)) / 2
+//   PLATEAU  : Lr *= Factor whenever the monitored loss hasn't improved for Patience epochs
+//
+class LrScheduler
+{
+  public:
+    LrScheduler ();
+
+    void SetType (
+      const LR_SCHEDULE_TYPE  Type
+      );
+
+    void SetStepParams (
+      const unsigned int  StepEpochs,
+      const double        Gamma
+      );
+
+    void SetCosineParams (
+      const double  MinLearningRate
+      );
+
+    void SetPlateauParams (
+      const unsigned int  Patience,
+      const double        Factor,
+      const double        MinLearningRate
+      );
+
+    void Init (
+      const double        BaseLearningRate,
+      const unsigned int  Epochs
+      );
+
+    double GetLearningRate (
+      const unsigned int  Epoch
+      ) const;
+
+    void Observe (
+      const double  MonitoredLoss
+      );
+
+    void GetPlateauState (
+      double        &LearningRate,
+      double        &BestLoss,
+      unsigned int  &BadEpochs
+      ) const;
+
+    void RestorePlateauState (
+      const double        LearningRate,
+      const double        BestLoss,
+      const unsigned int  BadEpochs
+      );
+
+    void ShowInfo () const;
+
+  private:
+    LR_SCHEDULE_TYPE  Type;
+    double            BaseLearningRate;
+    double            MinLearningRate;
+    unsigned int      Epochs;
+
+    unsigned int      StepEpochs;
+    double            Gamma;
+
+    unsigned int      Patience;
+    double            Factor;
+    double            PlateauLearningRate;
+    double            PlateauBestLoss;
+    unsigned int      PlateauBadEpochs;
+};
+
+#endif
@@ -0,0 +1,462 @@
+/**
+  Mixed precision training pass implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "MixedPrecision.h"
+#include "DebugLib.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+  Convert a float to bfloat16 with round-to-nearest-even.
+
+**/
+static
+inline
+uint16_t
+FloatToBf16 (
+  float  Value
+  )
+{
+  uint32_t  Bits;
+
+  memcpy (&Bits, &Value, sizeof (Bits));
+  if ((Bits & 0x7FFFFFFF) > 0x7F800000) {
+    return 0x7FC0; // NaN
+  }
+
+  Bits += 0x7FFF + ((Bits >> 16) & 1);
+
+  return (uint16_t)(Bits >> 16);
+}
+
+static
+inline
+float
+ToFloat (
+  uint16_t  Bf16
+  )
+{
+  uint32_t  Bits = (uint32_t)Bf16 << 16;
+  float     Value;
+
+  memcpy (&Value, &Bits, sizeof (Value));
+
+  return Value;
+}
+
+static
+inline
+float
+ToFloat (
+  float  Value
+  )
+{
+  return Value;
+}
+
+/**
+  The activation function f(x) = 1 / (1 + e^(-x)) in float.
+
+**/
+static
+inline
+float
+SigmoldF32 (
+  float  x
+  )
+{
+  return 1.0f / (1.0f + expf (-x));
+}
+
+MixedPrecision::MixedPrecision (
+  ) : Mode (PRECISION_DOUBLE),
+      LossScale (1.0),
+      DynamicLossScale (false),
+      GoodBatches (0),
+      Overflow (false)
+{
+}
+
+void
+MixedPrecision::SetMode (
+  const PRECISION_MODE  Mode
+  )
+{
+  if (Mode >= PRECISION_MODE_MAX) {
+    DEBUG_LOG ("Precision mode = " << Mode << " is unsupported.");
+    throw invalid_argument ("MixedPrecision::SetMode (): Unsupported precision mode.");
+  }
+
+  this->Mode = Mode;
+}
+
+PRECISION_MODE
+MixedPrecision::GetMode (
+  void
+  ) const
+{
+  return Mode;
+}
+
+/**
+  Set the loss scale applied to the output deltas.
+
+  @param[in]  LossScale  Initial scale, should be a power of 2 to keep scaling exact.
+  @param[in]  Dynamic    Adjust the scale on overflow/after a run of clean batches.
+
+**/
+void
+MixedPrecision::SetLossScale (
+  const double  LossScale,
+  const bool    Dynamic
+  )
+{
+  if (!(LossScale > 0.0) || isinf (LossScale)) {
+    DEBUG_LOG ("Loss scale = " << LossScale);
+    throw invalid_argument ("MixedPrecision::SetLossScale (): Invalid loss scale.");
+  }
+
+  this->LossScale        = LossScale;
+  this->DynamicLossScale = Dynamic;
+  GoodBatches            = 0;
+}
+
+double
+MixedPrecision::GetLossScale (
+  void
+  ) const
+{
+  return LossScale;
+}
+
+bool
+MixedPrecision::IsDynamicLossScale (
+  void
+  ) const
+{
+  return DynamicLossScale;
+}
+
+/**
+  Allocate the compute copy of weights and the activation/delta buffers.
+
+  @param[in]  Layout          Number of nodes in each layer of the network.
+  @param[in]  ActivationType  Activation function of the network.
+
+**/
+void
+MixedPrecision::Init (
+  const vector<unsigned int>  &Layout,
+  const ACTIVATION_TYPE       ActivationType
+  )
+{
+  if (Mode == PRECISION_DOUBLE) {
+    return;
+  }
+  if (ActivationType != SIGMOLD) {
+    DEBUG_LOG ("Unsupported activation type = " << ActivationType);
+    throw runtime_error ("MixedPrecision::Init (): Unsupported activation type.");
+  }
+
+  this->Layout = Layout;
+
+  WeightsF32.assign (Layout.size() - 1, vector<float> ());
+  WeightsBf16.assign (Layout.size() - 1, vector<uint16_t> ());
+  Activation.assign (Layout.size(), vector<float> ());
+  Delta.assign (Layout.size(), vector<float> ());
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    Activation[Index].resize (Layout[Index]);
+    Delta[Index].resize (Layout[Index]);
+
+    if (Index + 1 < (unsigned int)Layout.size()) {
+      if (Mode == PRECISION_BF16) {
+        WeightsBf16[Index].resize ((size_t)Layout[Index + 1] * Layout[Index]);
+      } else {
+        WeightsF32[Index].resize ((size_t)Layout[Index + 1] * Layout[Index]);
+      }
+    }
+  }
+
+  Overflow    = false;
+  GoodBatches = 0;
+}
+
+/**
+  Refresh the compute copy of weights from the double master weights.
+
+  @param[in]  MasterWeights  Weights of each layer of the network.
+
+**/
+void
+MixedPrecision::SyncWeights (
+  const vector<matrix>  &MasterWeights
+  )
+{
+  if (Mode == PRECISION_DOUBLE) {
+    return;
+  }
+
+  for (unsigned int Layer = 0; Layer < (unsigned int)MasterWeights.size(); Layer++) {
+    const double  *Master = MasterWeights[Layer].Data();
+    size_t        Count   = MasterWeights[Layer].Size();
+
+    if (Mode == PRECISION_BF16) {
+      uint16_t  *Weight = WeightsBf16[Layer].data();
+      for (size_t Index = 0; Index < Count; Index++) {
+        Weight[Index] = FloatToBf16 ((float)Master[Index]);
+      }
+    } else {
+      float  *Weight = WeightsF32[Layer].data();
+      for (size_t Index = 0; Index < Count; Index++) {
+        Weight[Index] = (float)Master[Index];
+      }
+    }
+  }
+}
+
+/**
+  Activation(Layer + 1) = f(Weight(Layer) * Activation(Layer)).
+
+**/
+template <typename WEIGHT_T>
+void
+MixedPrecision::ForwardLayer (
+  const WEIGHT_T  *Weight,
+  unsigned int    Layer
+  )
+{
+  const unsigned int  Rows    = Layout[Layer + 1];
+  const unsigned int  Columns = Layout[Layer];
+  const float         *In     = Activation[Layer].data();
+  float               *Out    = Activation[Layer + 1].data();
+
+  for (unsigned int RowIdx = 0; RowIdx < Rows; RowIdx++) {
+    const WEIGHT_T  *WeightRow = Weight + (size_t)RowIdx * Columns;
+    float           Z = 0.0f;
+
+    for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+      Z += ToFloat (WeightRow[ColumnIdx]) * In[ColumnIdx];
+    }
+
+    Out[RowIdx] = SigmoldF32 (Z);
+  }
+}
+
+/**
+  Delta(Layer) = (Weight(Layer)^T * Delta(Layer + 1)) .* f'(Activation(Layer)).
+
+**/
+template <typename WEIGHT_T>
+void
+MixedPrecision::BackwardLayer (
+  const WEIGHT_T  *Weight,
+  unsigned int    Layer
+  )
+{
+  const unsigned int  Rows      = Layout[Layer + 1];
+  const unsigned int  Columns   = Layout[Layer];
+  const float         *NextDelta = Delta[Layer + 1].data();
+  const float         *Act       = Activation[Layer].data();
+  float               *Out       = Delta[Layer].data();
+
+  for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+    Out[ColumnIdx] = 0.0f;
+  }
+
+  for (unsigned int RowIdx = 0; RowIdx < Rows; RowIdx++) {
+    const WEIGHT_T  *WeightRow = Weight + (size_t)RowIdx * Columns;
+    const float     RowDelta   = NextDelta[RowIdx];
+
+    for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+      Out[ColumnIdx] += ToFloat (WeightRow[ColumnIdx]) * RowDelta;
+    }
+  }
+
+  for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+    Out[ColumnIdx] *= Act[ColumnIdx] * (1.0f - Act[ColumnIdx]);
+  }
+}
+
+/**
+  Perform the forward pass of one data sample in reduced precision.
+
+  @param[in]  InputData  A matrix representing the input data to the network.
+
+**/
+void
+MixedPrecision::Forward (
+  const matrix  &InputData
+  )
+{
+  if (InputData.Size() != Layout[0]) {
+    DEBUG_LOG ("InputData size: " << InputData.Size() << ", Expected size: " << Layout[0]);
+    throw runtime_error ("Input data size does not match input layer size.");
+  }
+
+  const double  *Input = InputData.Data();
+  for (unsigned int Index = 0; Index < Layout[0]; Index++) {
+    Activation[0][Index] = (float)Input[Index];
+  }
+
+  for (unsigned int Layer = 0; Layer + 1 < (unsigned int)Layout.size(); Layer++) {
+    if (Mode == PRECISION_BF16) {
+      ForwardLayer (WeightsBf16[Layer].data(), Layer);
+    } else {
+      ForwardLayer (WeightsF32[Layer].data(), Layer);
+    }
+  }
+}
+
+/**
+  Perform the backward pass of the data sample passed to the last Forward() and
+  accumulate its delta weights into double BatchDeltaWeights.
+
+  @param[in]      DesiredOutput      The desired output values, or the output node of a class.
+  @param[in,out]  BatchDeltaWeights  Delta weights of each layer, summed over the batch.
+
+  @return  Mean square error of this data sample.
+
+**/
+double
+MixedPrecision::Backward (
+  const DESIRED_OUTPUT  &DesiredOutput,
+  vector<matrix>        &BatchDeltaWeights
+  )
+{
+  const unsigned int  LastLayer = (unsigned int)Layout.size() - 1;
+  const double        *Desired  = (DesiredOutput.Values != NULL) ? DesiredOutput.Values->Data() : NULL;
+  const float         Scale     = (float)LossScale;
+  const double        Unscale   = 1.0 / LossScale;
+  double              Loss      = 0.0;
+
+  CheckDesiredOutput (DesiredOutput, Layout[LastLayer]);
+
+  //
+  // Loss and scaled output layer delta in one pass, a class target expanded to one-hot on the way.
+  //
+  for (unsigned int Index = 0; Index < Layout[LastLayer]; Index++) {
+    float  Actual = Activation[LastLayer][Index];
+    float  Target = (Desired != NULL) ? (float)Desired[Index] : ((Index == DesiredOutput.Class) ? 1.0f : 0.0f);
+    float  Gap    = Target - Actual;
+
+    Loss += (double)Gap * Gap;
+    Delta[LastLayer][Index] = Scale * Gap * Actual * (1.0f - Actual);
+  }
+
+  for (unsigned int Layer = LastLayer - 1; Layer > 0; Layer--) {
+    if (Mode == PRECISION_BF16) {
+      BackwardLayer (WeightsBf16[Layer].data(), Layer);
+    } else {
+      BackwardLayer (WeightsF32[Layer].data(), Layer);
+    }
+  }
+
+  //
+  // BatchDeltaWeights(Layer) += Delta(Layer + 1) * Activation(Layer)^T / LossScale
+  //
+  for (unsigned int Layer = 0; Layer < LastLayer; Layer++) {
+    const unsigned int  Rows    = Layout[Layer + 1];
+    const unsigned int  Columns = Layout[Layer];
+    const float         *Act    = Activation[Layer].data();
+    double              *Batch  = BatchDeltaWeights[Layer].Data();
+
+    for (unsigned int RowIdx = 0; RowIdx < Rows; RowIdx++) {
+      const float  RowDelta = Delta[Layer + 1][RowIdx];
+      double       *BatchRow = Batch + (size_t)RowIdx * Columns;
+
+      if (!isfinite (RowDelta)) {
+        Overflow = true;
+      }
+
+      for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+        BatchRow[ColumnIdx] += (double)(RowDelta * Act[ColumnIdx]) * Unscale;
+      }
+    }
+  }
+
+  return Loss / Layout[LastLayer];
+}
+
+/**
+  Check whether the gradients accumulated in the current batch overflowed.
+
+**/
+bool
+MixedPrecision::HasOverflow (
+  void
+  ) const
+{
+  return Overflow;
+}
+
+/**
+  Mark the current batch as overflowed, e.g. when another data-parallel worker's
+  share of the batch did, so that all workers skip the same batches.
+
+**/
+void
+MixedPrecision::FlagOverflow (
+  void
+  )
+{
+  Overflow = true;
+}
+
+/**
+  Finish a batch and decide whether its delta weights can be applied.
+
+  @retval  true   The batch gradients are finite, apply them.
+  @retval  false  The batch overflowed, skip the weight update.
+
+**/
+bool
+MixedPrecision::EndBatch (
+  void
+  )
+{
+  if (Mode == PRECISION_DOUBLE) {
+    return true;
+  }
+
+  if (Overflow) {
+    Overflow    = false;
+    GoodBatches = 0;
+    if (DynamicLossScale) {
+      LossScale = fmax (LossScale * 0.5, 1.0);
+      DEBUG_LOG ("Gradient overflow, loss scale reduced to " << LossScale);
+    }
+    return false;
+  }
+
+  GoodBatches++;
+  if (DynamicLossScale && (GoodBatches >= LOSS_SCALE_GROWTH_INTERVAL)) {
+    LossScale  *= 2.0;
+    GoodBatches = 0;
+  }
+
+  return true;
+}
+
+void
+MixedPrecision::ShowInfo (
+  void
+  ) const
+{
+  static const char  *ModeName[] = { "DOUBLE", "FLOAT", "BF16" };
+
+  cout << "  Precision     : " << ModeName[Mode];
+  if (Mode != PRECISION_DOUBLE) {
+    cout << " (loss scale " << LossScale << (DynamicLossScale ? ", dynamic" : "") << ")";
+  }
+  cout << endl;
+}
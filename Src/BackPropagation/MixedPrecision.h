@@ -0,0 +1,113 @@
+/**
+  Mixed precision training pass definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _MIXED_PRECISION_H_
+#define _MIXED_PRECISION_H_
+
+#include "matrix.h"
+#include "Activation.h"
+#include "DataSource.h"
+
+#include <vector>
+#include <cstdint>
+
+typedef enum {
+  PRECISION_DOUBLE = 0,   // All computation on the double master weights.
+  PRECISION_FLOAT,        // Forward/backward in float, weights copied to float.
+  PRECISION_BF16,         // Forward/backward in float, weights stored as bfloat16.
+  PRECISION_MODE_MAX
+} PRECISION_MODE;
+
+//
+// Forward and backward pass of one data sample in reduced precision.
+//
+// The double weights in FullyConnectedNetwork stay the master copy, which
+// the optimizer updates. This class keeps a float/bf16 compute copy of them
+// (refreshed by SyncWeights() after every update), runs the GEMMs on it and
+// accumulates the gradients back into double.
+//
+// Output deltas are multiplied by the loss scale before the backward pass and
+// the gradients are divided by it when accumulated, so small gradients don't
+// flush to zero. With dynamic loss scaling, a batch producing non-finite
+// gradients is skipped and the scale halved; the scale doubles again after
+// LOSS_SCALE_GROWTH_INTERVAL clean batches.
+//
+class MixedPrecision
+{
+  public:
+    MixedPrecision ();
+
+    void SetMode (
+      const PRECISION_MODE  Mode
+      );
+
+    PRECISION_MODE GetMode () const;
+
+    void SetLossScale (
+      const double  LossScale,
+      const bool    Dynamic
+      );
+
+    double GetLossScale () const;
+
+    bool IsDynamicLossScale () const;
+
+    void Init (
+      const std::vector<unsigned int>  &Layout,
+      const ACTIVATION_TYPE            ActivationType
+      );
+
+    void SyncWeights (
+      const std::vector<matrix>  &MasterWeights
+      );
+
+    void Forward (
+      const matrix  &InputData
+      );
+
+    double Backward (
+      const DESIRED_OUTPUT &DesiredOutput,
+      std::vector<matrix>  &BatchDeltaWeights
+      );
+
+    bool HasOverflow () const;
+
+    void FlagOverflow ();
+
+    bool EndBatch ();
+
+    void ShowInfo () const;
+
+  private:
+    template <typename WEIGHT_T>
+    void ForwardLayer (
+      const WEIGHT_T  *Weight,
+      unsigned int    Layer
+      );
+
+    template <typename WEIGHT_T>
+    void BackwardLayer (
+      const WEIGHT_T  *Weight,
+      unsigned int    Layer
+      );
+
+    PRECISION_MODE                       Mode;
+    double                               LossScale;
+    bool                                 DynamicLossScale;
+    unsigned int                         GoodBatches;
+    bool                                 Overflow;
+
+    std::vector<unsigned int>            Layout;
+    std::vector< std::vector<float> >    WeightsF32;
+    std::vector< std::vector<uint16_t> > WeightsBf16;
+    std::vector< std::vector<float> >    Activation;
+    std::vector< std::vector<float> >    Delta;
+};
+
+#define LOSS_SCALE_GROWTH_INTERVAL  1000
+
+#endif
@@ -7,10 +7,15 @@
 
 #include "BpMisc.h"
 #include "MnistDataSet.h"
+#include "IdxFile.h"
+#include "ParallelFor.h"
 
 #include <iostream>
-#include <cstring>
 #include <filesystem>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -19,6 +24,16 @@ using namespace std;
 #define  TEST_IMAGES_IDX_FILE   (string)"t10k-images.idx3-ubyte"
 #define  TEST_LABELS_IDX_FILE   (string)"t10k-labels.idx1-ubyte"
 
+//
+// Fewest records decoded by a thread of their own.
+//
+#define  MIN_RECORDS_PER_THREAD  1024
+
+//
+// Records read at once when streaming, 784 KB of MNIST images.
+//
+#define  STREAM_SHARD_RECORDS    1000
+
 /**
   Get the root path for MNIST dataset files.
 
@@ -45,136 +60,143 @@ GetRootPath (
 }
 
 /**
-  Convert a 32-bit unsigned integer from big-endian to little-endian format.
+  Map the image and label files of the MNIST dataset and check that they match.
+  The files can be IDX files of any data type, e.g. Fashion-MNIST, EMNIST or our
+  own exports. Images need at least two dimensions and labels one value each.
 
-  @param[in]  BigEndian  The big-endian unsigned integer to be converted.
+  @param[in]   DataType      An unsigned short indicating whether to read training or test data.
+  @param[out]  ImagesFile    The mapped image file.
+  @param[out]  LabelsFile    The mapped label file.
+  @param[in]   LabelsToRead  The vector of labels to be read, only checked here.
 
-  @return     The converted little-endian unsigned integer.
+  @throw  runtime_error  One of the following conditions is met:
+                          * No labels are specified in LabelsToRead.
+                          * Too many labels are specified in LabelsToRead, or one is above 255.
+                          * The image file cannot be opened or has an invalid header.
+                          * The label file cannot be opened or has an invalid header.
+                          * The total number of images does not match the amount number of all labels.
 
 **/
 static
-unsigned int
-BigEndianToLittleEndianU32 (
-  unsigned int BigEndian
+void
+OpenMNIST (
+  unsigned short  DataType,
+  IdxFile         &ImagesFile,
+  IdxFile         &LabelsFile,
+  LABELS          &LabelsToRead
   )
 {
-  return ((BigEndian & 0x000000FF) << 24) |
-         ((BigEndian & 0x0000FF00) << 8)  |
-         ((BigEndian & 0x00FF0000) >> 8)  |
-         ((BigEndian & 0xFF000000) >> 24);
-}
-
-/**
-  Open an IDX file and read its header.
-
-  @param[in]   filename             The name of the IDX file to be opened.
-  @param[in]   ExpectedMagicNumber  The expected magic number for the IDX file.
-  @param[out]  Header               The header read from the IDX file.
-
-  @return      The opened file stream.
-
-  @throw       runtime_error        One of the following conditions is met:
-                                      * File cannot be opened.
-                                      * The magic number in the file is invalid.
+  string        DataSetIdxFile;
+  string        LabelSetIdxFile;
+  string        RootPath = GetRootPath();
 
-**/
-ifstream
-OpenIdxFile (
-  const string        &filename,
-  const unsigned int  ExpectedMagicNumber,
-  IDX_HEADER          &Header
-  )
-{
-  ifstream      File;
-  unsigned int  MagicNumber = 0;
-  int           Dimension = 0;
-  unsigned int  Value = 0;
-
-  File.open (filename, ios::binary);
-  if (!File.is_open ()) {
-    throw runtime_error ("Error: Cannot open file " + filename);
+  if (LabelsToRead.size() == 0) {
+    throw runtime_error ("Error: No labels to read");
+  }
+  if (LabelsToRead.size() > LABEL_COUNT_MAX) {
+    throw runtime_error ("Error: Too many labels to read");
+  }
+  if (*max_element (LabelsToRead.begin (), LabelsToRead.end ()) >= LABEL_COUNT_MAX) {
+    throw runtime_error ("Error: Labels to read must be 0 to " + to_string (LABEL_COUNT_MAX - 1));
   }
 
-  File.read ((char*)&MagicNumber, sizeof(MagicNumber));
-  MagicNumber = BigEndianToLittleEndianU32 (MagicNumber);
-
-  if (MagicNumber != ExpectedMagicNumber) {
-    throw runtime_error ("Error: Invalid magic number in file " + filename +
-                         ". Expected " + to_string(ExpectedMagicNumber) +
-                         ", got " + to_string(MagicNumber)
-                        );
+  //
+  // Map the image file.
+  //
+  DataSetIdxFile = (DataType == TRAINING_DATA) ? TRAIN_IMAGES_IDX_FILE : TEST_IMAGES_IDX_FILE;
+  ImagesFile.Open (RootPath + DataSetIdxFile);
+  if ((ImagesFile.GetDimensions ().size() < 2) || (ImagesFile.GetRecordValues () == 0)) {
+    throw runtime_error ("Error: Invalid image file header");
   }
 
-  Dimension = (int)(MagicNumber & 0xFF);
+  //
+  // Map the label file.
+  //
+  LabelSetIdxFile = (DataType == TRAINING_DATA) ? TRAIN_LABELS_IDX_FILE : TEST_LABELS_IDX_FILE;
+  LabelsFile.Open (RootPath + LabelSetIdxFile);
+  if (LabelsFile.GetRecordValues () != 1) {
+    throw runtime_error ("Error: Invalid label file header");
+  }
 
-  Header.resize (Dimension);
-  for (int Index = 0; Index < Dimension; Index++) {
-    File.read ((char *)&Value, sizeof(Value));
-    Header[Index] = BigEndianToLittleEndianU32 (Value);
+  if (ImagesFile.GetCount () != LabelsFile.GetCount ()) {
+    throw runtime_error ("Error: The number of images does not match the number of labels");
   }
 
-  return File;
+  cout << "Number of images: " << ImagesFile.GetCount () << endl;
 }
 
 /**
-  Read a single image from an IDX file.
+  Get the shape of the images of an IDX file: the second dimension is the rows,
+  and the other ones flatten into the columns, 1 for a file of feature vectors.
 
-  @param[in]   File            The file stream of the opened IDX file.
-                               The position of the file pointer should be at the beginning of the image data.
-  @param[in]   NumberOfRows    The number of rows in the image.
-  @param[in]   NumberOfColumns The number of columns in the image.
+**/
+static
+void
+GetImageShape (
+  const IdxFile  &ImagesFile,
+  unsigned int   &Rows,
+  unsigned int   &Columns
+  )
+{
+  Rows    = ImagesFile.GetDimensions ()[1];
+  Columns = (unsigned int)(ImagesFile.GetRecordValues () / Rows);
+}
+
+/**
+  Find where the kept records of each part of ParallelFor() go in the data set,
+  counting the records with a trained label part by part in parallel.
 
-  @return      The image read from the file, represented as a vector of doubles.
-               Pixels are stored in row-major order.
+  @param[in]   LabelsFile     The mapped label file.
+  @param[in]   LabelMap       Output node of every label.
+  @param[out]  PartFirstSlot  Data set index of the first kept record of every part.
 
-  @throw       runtime_error   One of the following conditions is met:
-                                * The file is not open or has reached the end of file.  
+  @return  Number of kept records.
 
 **/
 static
-vector<double>
-ReadImageFromIdxToVector (
-  ifstream      &File,
-  unsigned int  NumberOfRows,
-  unsigned int  NumberOfColumns
+unsigned int
+FindKeptSlots (
+  const IdxFile         &LabelsFile,
+  const LABEL_MAP       &LabelMap,
+  vector<unsigned int>  &PartFirstSlot
   )
 {
-  vector<double> ImageVector;
-  unsigned char  Pixel = 0;
-
-  if (!File.is_open () || File.eof ()) {
-    throw runtime_error ("Error: Cannot read image from file");
-  }
+  unsigned int  KeptCount = 0;
 
-  ImageVector.resize (NumberOfRows * NumberOfColumns);
+  PartFirstSlot.assign (ParallelPartCount (LabelsFile.GetCount (), MIN_RECORDS_PER_THREAD), 0);
 
-  for (unsigned int Row = 0; Row < NumberOfRows; Row++) {
-    for (unsigned int Column = 0; Column < NumberOfColumns; Column++) {
-      File.read ((char*)&Pixel, sizeof(Pixel));
-      ImageVector[Row * NumberOfColumns + Column] = (double)Pixel;
+  ParallelFor (LabelsFile.GetCount (), MIN_RECORDS_PER_THREAD, [&] (unsigned int Part, unsigned int First, unsigned int End) {
+    for (unsigned int Index = First; Index < End; Index++) {
+      PartFirstSlot[Part] += (LookUpLabel (LabelMap, LabelsFile.GetValue (Index, 0)) != LABEL_NOT_TRAINED) ? 1 : 0;
     }
+  });
+
+  //
+  // Counts to exclusive prefix sums.
+  //
+  for (unsigned int Part = 0; Part < (unsigned int)PartFirstSlot.size(); Part++) {
+    unsigned int  Count = PartFirstSlot[Part];
+
+    PartFirstSlot[Part] = KeptCount;
+    KeptCount += Count;
   }
 
-  return ImageVector;
+  return KeptCount;
 }
 
 /**
   Read images and labels from the MNIST dataset files.
 
   This function reads images and their corresponding labels from the MNIST data set files.
-  Only images with labels specified in LabelsToRead are kept.
+  Only images with labels specified in LabelsToRead are kept. Values of any IDX data
+  type are read as they are, float and double images must not hold NaN or infinity.
 
   @param[out]  DataSet       The vector to store the read images.
                              Each image is represented as a vector of doubles, and pixels are in row-major order.
   @param[out]  LabelSet      The vector to store the corresponding labels for the images in DataSet.
   @param[in]   LabelsToRead  The vector of labels to be read. Only images with these labels will be kept.
 
-  @throw  runtime_error  One of the following conditions is met:
-                          * No labels are specified in LabelsToRead.
-                          * Too many labels are specified in LabelsToRead.
-                          * The image file cannot be opened or has an invalid header.
-                          * The label file cannot be opened or has an invalid header.
-                          * The total number of images does not match the amount number of all labels.
+  @throw  runtime_error  See OpenMNIST(), or a float or double image holds NaN or infinity.
 
 **/
 void
@@ -185,98 +207,303 @@ ReadMNIST_and_label (
   LABELS          &LabelsToRead
   )
 {
-  ifstream      ImagesFile;
-  ifstream      LabelsFile;
-  IDX_HEADER    ImagesFileHeader;
-  IDX_HEADER    LabelsFileHeader;
-  unsigned int  NumberOfImages = 0;
-  unsigned int  NumberOfRows = 0;
-  unsigned int  NumberOfColumns = 0;
-  unsigned int  NumberOfLabels = 0;
-  string        DataSetIdxFile;
-  string        LabelSetIdxFile;
-  string        RootPath = GetRootPath();
+  IdxFile       ImagesFile;
+  IdxFile       LabelsFile;
 
-  if (LabelsToRead.size() == 0) {
-    throw runtime_error ("Error: No labels to read");
-  }
-  if (LabelsToRead.size() > 10) {
-    throw runtime_error ("Error: Too many labels to read");
-  }
+  OpenMNIST (DataType, ImagesFile, LabelsFile, LabelsToRead);
 
-  //
-  // Clear DataSet and LabelSet.
-  //
-  DataSet.clear ();
-  LabelSet.clear ();
+  unsigned int  NumberOfImages  = ImagesFile.GetCount ();
+  unsigned int  NumberOfRows;
+  unsigned int  NumberOfColumns;
+  bool          IsReal = (ImagesFile.GetDataType () == IDX_FLOAT) || (ImagesFile.GetDataType () == IDX_DOUBLE);
+
+  GetImageShape (ImagesFile, NumberOfRows, NumberOfColumns);
 
   //
-  // Open the image file.
+  // Every thread converts a range of records straight into the slots of its kept images.
   //
-  DataSetIdxFile = (DataType == TRAINING_DATA) ? TRAIN_IMAGES_IDX_FILE : TEST_IMAGES_IDX_FILE;
-  ImagesFile = OpenIdxFile (
-                 RootPath + DataSetIdxFile,
-                 0x00000803,
-                 ImagesFileHeader
-                 );
-  if (ImagesFileHeader.size() != 3) {
-    throw runtime_error ("Error: Invalid image file header");
+  LABEL_MAP             LabelMap;
+  vector<unsigned int>  PartFirstSlot;
+  unsigned int          KeptCount;
+
+  BuildLabelMap (LabelsToRead, LabelMap);
+  KeptCount = FindKeptSlots (LabelsFile, LabelMap, PartFirstSlot);
+
+  DataSet.assign (KeptCount, matrix ());
+  LabelSet.assign (KeptCount, 0);
+
+  ParallelFor (NumberOfImages, MIN_RECORDS_PER_THREAD, [&] (unsigned int Part, unsigned int First, unsigned int End) {
+    unsigned int  Slot = PartFirstSlot[Part];
+
+    for (unsigned int Index = First; Index < End; Index++) {
+      double  LabelValue = LabelsFile.GetValue (Index, 0);
+
+      if (LookUpLabel (LabelMap, LabelValue) == LABEL_NOT_TRAINED) {
+        //
+        // This is not the label we want, skip this image.
+        //
+        continue;
+      }
+
+      DataSet[Slot] = matrix (NumberOfRows, NumberOfColumns);
+      ImagesFile.ReadValues (Index, DataSet[Slot].Data());
+
+      for (size_t Pixel = 0; IsReal && (Pixel < DataSet[Slot].Size ()); Pixel++) {
+        if (!isfinite (DataSet[Slot].Data()[Pixel])) {
+          throw runtime_error ("Error: Image " + to_string (Index) + " holds a NaN or infinite value");
+        }
+      }
+      LabelSet[Slot] = (unsigned int)LabelValue;
+      Slot++;
+    }
+  });
+
+  cout << "Number of images read: " << DataSet.size() << endl;
+}
+
+/**
+  Hash bytes with FNV-1a, 8 bytes at a time, so hashing a whole data set takes
+  a few milliseconds.
+
+  @param[in]  Data  Bytes to hash.
+  @param[in]  Size  Number of bytes.
+  @param[in]  Hash  Hash of the data before, or the FNV offset basis.
+
+  @return  The hash of the data before and this data.
+
+**/
+static
+u_int64_t
+HashBytes (
+  const void  *Data,
+  size_t      Size,
+  u_int64_t   Hash
+  )
+{
+  const u_int8_t  *Bytes = (const u_int8_t *)Data;
+  u_int64_t       Word;
+
+  for (; Size >= sizeof (Word); Size -= sizeof (Word), Bytes += sizeof (Word)) {
+    memcpy (&Word, Bytes, sizeof (Word));
+    Hash = (Hash ^ Word) * 0x100000001B3ULL;
+  }
+  for (; Size != 0; Size--, Bytes++) {
+    Hash = (Hash ^ *Bytes) * 0x100000001B3ULL;
   }
 
-  NumberOfImages  = ImagesFileHeader[0];
-  NumberOfRows    = ImagesFileHeader[1];
-  NumberOfColumns = ImagesFileHeader[2];
+  return Hash;
+}
 
-  //
-  // Open the label file.
-  //
-  LabelSetIdxFile = (DataType == TRAINING_DATA) ? TRAIN_LABELS_IDX_FILE : TEST_LABELS_IDX_FILE;
-  LabelsFile = OpenIdxFile (
-                 RootPath + LabelSetIdxFile,
-                 0x00000801,
-                 LabelsFileHeader
-                 );
-  if (LabelsFileHeader.size() != 1) {
-    throw runtime_error ("Error: Invalid image file header");
+/**
+  Hash the data type, the dimensions and the records of a mapped IDX file.
+
+**/
+static
+u_int64_t
+HashIdxFile (
+  const IdxFile  &File,
+  u_int64_t      Hash
+  )
+{
+  const vector<unsigned int>  &Dimensions = File.GetDimensions ();
+  IDX_DATA_TYPE               DataType   = File.GetDataType ();
+
+  Hash = HashBytes (&DataType, sizeof (DataType), Hash);
+  Hash = HashBytes (Dimensions.data (), Dimensions.size () * sizeof (unsigned int), Hash);
+  if (File.GetCount () != 0) {
+    Hash = HashBytes (File.GetRecord (0), File.GetRecordSize () * File.GetCount (), Hash);
   }
 
-  NumberOfLabels  = LabelsFileHeader[0];
+  return Hash;
+}
 
-  if (NumberOfImages != NumberOfLabels) {
-    throw runtime_error ("Error: The number of images does not match the number of labels");
+/**
+  Read images and labels from the MNIST dataset files into a compact data set.
+
+  Pixels are kept as bytes. The output node of an image is the position of its label
+  in LabelsToRead. Only images with labels specified in LabelsToRead are kept.
+
+  The compact data set and its cache keep pixels as bytes, so the image file must
+  be of unsigned bytes. Read images of the other IDX data types at full precision
+  with ReadMNIST_and_label().
+
+  With a CacheFileName, the data set is loaded from that cache file when the file
+  was saved from the same IDX file contents and LabelsToRead, and otherwise it is
+  read from the IDX files and saved there for the next run.
+
+  @param[in]   DataType       An unsigned short indicating whether to read training or test data.
+  @param[out]  DataSet        The data set to store the read images and labels.
+  @param[in]   LabelsToRead   The vector of labels to be read. Only images with these labels will be kept.
+  @param[in]   CacheFileName  The cache file, or empty not to use one.
+
+  @throw  runtime_error  See OpenMNIST(), or the images aren't unsigned bytes.
+
+**/
+void
+ReadMNIST (
+  unsigned short  DataType,
+  CompactDataSet  &DataSet,
+  LABELS          &LabelsToRead,
+  const string    &CacheFileName
+  )
+{
+  IdxFile       ImagesFile;
+  IdxFile       LabelsFile;
+  u_int64_t     CacheKey = 0xCBF29CE484222325ULL;
+
+  OpenMNIST (DataType, ImagesFile, LabelsFile, LabelsToRead);
+
+  if (ImagesFile.GetDataType () != IDX_UNSIGNED_BYTE) {
+    throw runtime_error ("Error: A compact data set needs unsigned byte images, read other IDX data types with ReadMNIST_and_label ()");
+  }
+
+  if (!CacheFileName.empty ()) {
+    //
+    // Everything the cached samples depend on: the source files and the label filter.
+    //
+    CacheKey = HashIdxFile (ImagesFile, CacheKey);
+    CacheKey = HashIdxFile (LabelsFile, CacheKey);
+    CacheKey = HashBytes (LabelsToRead.data (), LabelsToRead.size () * sizeof (unsigned int), CacheKey);
+
+    if (DataSet.LoadCache (CacheFileName, CacheKey)) {
+      cout << "Number of images read: " << DataSet.GetSampleCount () << " (from " << CacheFileName << ")" << endl;
+      return;
+    }
   }
 
-  cout << "Number of images: " << NumberOfImages << endl;
+  unsigned int  NumberOfImages = ImagesFile.GetCount ();
+  unsigned int  NumberOfRows;
+  unsigned int  NumberOfColumns;
+
+  GetImageShape (ImagesFile, NumberOfRows, NumberOfColumns);
 
   //
-  // Read all images and labels, but only keep those with labels in LabelsToRead.
+  // Every thread copies a range of records straight into the slots of its kept images.
   //
-  for (int Index = 0; Index < (int)NumberOfImages; Index++) {
-    vector<double> ImageVector;
-    unsigned char  Pixel = 0;
-    unsigned char  LabelValue = 0;
-
-    LabelsFile.read ((char*)&LabelValue, sizeof(LabelValue));
-
-    if (!ValueInVector (LabelsToRead, (unsigned int)LabelValue)) {
-      //
-      // This is not the label we want, skip this image.
-      //
-      ImagesFile.seekg (NumberOfRows * NumberOfColumns * sizeof(Pixel), ios::cur);
-      continue;
+  LABEL_MAP             LabelMap;
+  vector<unsigned int>  PartFirstSlot;
+  unsigned int          KeptCount;
+
+  BuildLabelMap (LabelsToRead, LabelMap);
+  KeptCount = FindKeptSlots (LabelsFile, LabelMap, PartFirstSlot);
+
+  DataSet.Init (NumberOfRows, NumberOfColumns, (unsigned int)LabelsToRead.size());
+  DataSet.Resize (KeptCount);
+
+  ParallelFor (NumberOfImages, MIN_RECORDS_PER_THREAD, [&] (unsigned int Part, unsigned int First, unsigned int End) {
+    unsigned int  Slot = PartFirstSlot[Part];
+
+    for (unsigned int Index = First; Index < End; Index++) {
+      double        LabelValue  = LabelsFile.GetValue (Index, 0);
+      unsigned int  OutputIndex = LookUpLabel (LabelMap, LabelValue);
+
+      if (OutputIndex == LABEL_NOT_TRAINED) {
+        continue;
+      }
+
+      DataSet.SetSample (Slot, ImagesFile.GetRecord (Index), (unsigned int)LabelValue, OutputIndex);
+      Slot++;
     }
-  
-    ImageVector = ReadImageFromIdxToVector (ImagesFile, NumberOfRows, NumberOfColumns);
+  });
+
+  cout << "Number of images read: " << DataSet.GetSampleCount () << endl;
 
-    matrix  Image (NumberOfRows, NumberOfColumns, ImageVector);
-  
-    DataSet.push_back (Image);
-    LabelSet.push_back ((int)LabelValue);
+  if (!CacheFileName.empty () && !DataSet.SaveCache (CacheFileName, CacheKey)) {
+    cout << "Warning: Cannot write data set cache " << CacheFileName << endl;
   }
+}
 
-  cout << "Number of images read: " << DataSet.size() << endl;
-  ImagesFile.close ();
-  LabelsFile.close ();
+/**
+  Read images and labels from the MNIST dataset files at full precision, as network
+  samples for a MatrixDataSource. For the images of other IDX data types than
+  unsigned bytes, which ReadMNIST() can't keep.
+
+  @param[in]   DataType        An unsigned short indicating whether to read training or test data.
+  @param[out]  Inputs          The images as (Rows * Columns) * 1 matrices.
+  @param[out]  DesiredOutputs  The output of each image, 1 at the position of its label in LabelsToRead.
+  @param[in]   LabelsToRead    The vector of labels to be read. Only images with these labels will be kept.
+
+  @throw  runtime_error  Same conditions as ReadMNIST_and_label().
+
+**/
+void
+ReadMNIST_full_precision (
+  unsigned short  DataType,
+  DATA_SET        &Inputs,
+  DATA_SET        &DesiredOutputs,
+  LABELS          &LabelsToRead
+  )
+{
+  LABELS     LabelSet;
+  LABEL_MAP  LabelMap;
+
+  ReadMNIST_and_label (DataType, Inputs, LabelSet, LabelsToRead);
+  BuildLabelMap (LabelsToRead, LabelMap);
+
+  DesiredOutputs.assign (Inputs.size(), matrix ((unsigned int)LabelsToRead.size(), 1, 0.0));
+  for (unsigned int Index = 0; Index < (unsigned int)Inputs.size(); Index++) {
+    Inputs[Index].Reshape ((unsigned int)Inputs[Index].Size(), 1);
+    DesiredOutputs[Index].Data()[LookUpLabel (LabelMap, LabelSet[Index])] = 1.0;
+  }
+}
+
+/**
+  Check whether the images of the MNIST dataset are unsigned bytes, so ReadMNIST()
+  can keep them.
+
+  @param[in]  DataType  An unsigned short indicating whether to check training or test data.
+
+  @return  true if the image file is of unsigned bytes.
+
+  @throw  runtime_error  The image file cannot be opened or has an invalid header.
+
+**/
+bool
+IsMNISTByteImages (
+  unsigned short  DataType
+  )
+{
+  IdxFile  ImagesFile;
+
+  ImagesFile.Open (GetRootPath () + ((DataType == TRAINING_DATA) ? TRAIN_IMAGES_IDX_FILE : TEST_IMAGES_IDX_FILE));
+
+  return ImagesFile.GetDataType () == IDX_UNSIGNED_BYTE;
+}
+
+/**
+  Open the MNIST dataset files for streaming, so only a window of the images is in
+  memory at a time. The output node of an image is the position of its label in
+  LabelsToRead.
+
+  @param[in]   DataType      An unsigned short indicating whether to read training or test data.
+  @param[out]  DataSet       The data set to stream the images and labels from.
+  @param[in]   LabelsToRead  The vector of labels to be read. Only images with these labels will be kept.
+  @param[in]   MemoryBudget  Bytes of images kept in memory.
+
+  @throw  runtime_error     The files cannot be opened or have invalid headers.
+  @throw  invalid_argument  MemoryBudget is smaller than one shard.
+
+**/
+void
+StreamMNIST (
+  unsigned short    DataType,
+  StreamingDataSet  &DataSet,
+  LABELS            &LabelsToRead,
+  size_t            MemoryBudget
+  )
+{
+  string  RootPath = GetRootPath();
+
+  DataSet.Open (
+    RootPath + ((DataType == TRAINING_DATA) ? TRAIN_IMAGES_IDX_FILE : TEST_IMAGES_IDX_FILE),
+    RootPath + ((DataType == TRAINING_DATA) ? TRAIN_LABELS_IDX_FILE : TEST_LABELS_IDX_FILE),
+    LabelsToRead,
+    MemoryBudget,
+    STREAM_SHARD_RECORDS
+    );
+
+  cout << "Number of images streamed: " << DataSet.GetSampleCount () << ", "
+       << DataSet.GetWindowShards () << " shards of " << STREAM_SHARD_RECORDS << " in memory" << endl;
 }
 
 /**
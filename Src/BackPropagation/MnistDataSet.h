@@ -10,8 +10,8 @@
 
 #include "matrix.h"
 #include "BackPropagator.h"
-
-typedef std::vector< unsigned int >  IDX_HEADER;
+#include "CompactDataSet.h"
+#include "StreamingDataSet.h"
 
 #define TRAINING_DATA  0x0001
 #define TEST_DATA      0x0002
@@ -24,7 +24,8 @@ typedef std::vector< unsigned int >  LABELS;
   Read images and labels from the MNIST dataset files.
 
   This function reads images and their corresponding labels from the MNIST data set files.
-  Only images with labels specified in LabelsToRead are kept.
+  Only images with labels specified in LabelsToRead are kept. Values of any IDX data
+  type are read as they are, float and double images must not hold NaN or infinity.
 
   @param[in]   DataType      An unsigned short indicating whether to read training or test data.
   @param[out]  DataSet       The vector to store the read images.
@@ -34,10 +35,11 @@ typedef std::vector< unsigned int >  LABELS;
 
   @throw  runtime_error  One of the following conditions is met:
                           * No labels are specified in LabelsToRead.
-                          * Too many labels are specified in LabelsToRead.
+                          * Too many labels are specified in LabelsToRead, or one is above 255.
                           * The image file cannot be opened or has an invalid header.
                           * The label file cannot be opened or has an invalid header.
                           * The total number of images does not match the amount number of all labels.
+                          * A float or double image holds NaN or infinity.
 
 **/
 void
@@ -48,6 +50,94 @@ ReadMNIST_and_label (
   LABELS          &LabelsToRead
   );
 
+/**
+  Read images and labels from the MNIST dataset files into a compact data set.
+
+  Pixels are kept as bytes. The output node of an image is the position of its label
+  in LabelsToRead. Only images with labels specified in LabelsToRead are kept. The
+  image file must be of unsigned bytes, ReadMNIST_and_label() reads the other IDX
+  data types at full precision.
+
+  With a CacheFileName, the data set is loaded from that cache file when the file
+  was saved from the same IDX file contents and LabelsToRead, and otherwise it is
+  read from the IDX files and saved there for the next run.
+
+  @param[in]   DataType       An unsigned short indicating whether to read training or test data.
+  @param[out]  DataSet        The data set to store the read images and labels.
+  @param[in]   LabelsToRead   The vector of labels to be read. Only images with these labels will be kept.
+  @param[in]   CacheFileName  The cache file, or empty not to use one.
+
+  @throw  runtime_error  Same conditions as ReadMNIST_and_label(), or the images
+                         aren't unsigned bytes.
+
+**/
+void
+ReadMNIST (
+  unsigned short     DataType,
+  CompactDataSet     &DataSet,
+  LABELS             &LabelsToRead,
+  const std::string  &CacheFileName
+  );
+
+/**
+  Read images and labels from the MNIST dataset files at full precision, as network
+  samples for a MatrixDataSource. For the images of other IDX data types than
+  unsigned bytes, which ReadMNIST() can't keep.
+
+  @param[in]   DataType        An unsigned short indicating whether to read training or test data.
+  @param[out]  Inputs          The images as (Rows * Columns) * 1 matrices.
+  @param[out]  DesiredOutputs  The output of each image, 1 at the position of its label in LabelsToRead.
+  @param[in]   LabelsToRead    The vector of labels to be read. Only images with these labels will be kept.
+
+  @throw  runtime_error  Same conditions as ReadMNIST_and_label().
+
+**/
+void
+ReadMNIST_full_precision (
+  unsigned short  DataType,
+  DATA_SET        &Inputs,
+  DATA_SET        &DesiredOutputs,
+  LABELS          &LabelsToRead
+  );
+
+/**
+  Check whether the images of the MNIST dataset are unsigned bytes, so ReadMNIST()
+  can keep them.
+
+  @param[in]  DataType  An unsigned short indicating whether to check training or test data.
+
+  @return  true if the image file is of unsigned bytes.
+
+  @throw  runtime_error  The image file cannot be opened or has an invalid header.
+
+**/
+bool
+IsMNISTByteImages (
+  unsigned short  DataType
+  );
+
+/**
+  Open the MNIST dataset files for streaming, so only a window of the images is in
+  memory at a time. The output node of an image is the position of its label in
+  LabelsToRead.
+
+  @param[in]   DataType      An unsigned short indicating whether to read training or test data.
+  @param[out]  DataSet       The data set to stream the images and labels from.
+  @param[in]   LabelsToRead  The vector of labels to be read. Only images with these labels will be kept.
+  @param[in]   MemoryBudget  Bytes of images kept in memory.
+
+  @throw  runtime_error     The files cannot be opened or have invalid headers.
+  @throw  invalid_argument  MemoryBudget is smaller than one shard.
+
+**/
+void
+StreamMNIST (
+  unsigned short    DataType,
+  StreamingDataSet  &DataSet,
+  LABELS            &LabelsToRead,
+  size_t            MemoryBudget
+  );
+
 /**
   Dump an MNIST image to the standard output.
 
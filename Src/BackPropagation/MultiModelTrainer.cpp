@@ -0,0 +1,312 @@
+/**
+  Multi-model trainer implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "MultiModelTrainer.h"
+#include "BpMisc.h"
+#include "AllocCounter.h"
+#include "DebugLib.h"
+
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+MultiModelTrainer::MultiModelTrainer (
+  ) : Epochs (10),
+      BatchSize (200)
+{
+}
+
+/**
+  Add a model to be trained. Its network must have the same input size as the
+  models added before, and its BackPropagator's optimizer, learning rate and
+  schedule are used for it. All models train for the set number of epochs, so
+  the model must not hold out a validation split, stop early or have a target
+  loss(set it to 0).
+
+  @param[in]  Model  BackPropagator of the model, must outlive Train().
+
+  @throw  invalid_argument  The input size doesn't match, or the model is
+                            configured with validation, early stopping or a
+                            target loss.
+
+**/
+void
+MultiModelTrainer::AddModel (
+  BackPropagator  &Model
+  )
+{
+  const NETWORK_LAYOUT  &Layout = Model.Network.GetLayout ();
+
+  if (!Models.empty () && (Layout[0] != Models[0]->Network.GetLayout ()[0])) {
+    DEBUG_LOG ("Input size = " << Layout[0] << ", expected " << Models[0]->Network.GetLayout ()[0]);
+    throw invalid_argument ("MultiModelTrainer::AddModel (): Models should have the same input size.");
+  }
+
+  if ((Model.ValidationSplit != 0.0) || (Model.EarlyStopPatience != 0) || (Model.TargetLoss > 0.0)) {
+    DEBUG_LOG ("Validation split = " << Model.ValidationSplit << ", early stopping patience = " << Model.EarlyStopPatience << ", target loss = " << Model.TargetLoss);
+    throw invalid_argument ("MultiModelTrainer::AddModel (): Models should train without validation, early stopping and target loss.");
+  }
+
+  Models.push_back (&Model);
+}
+
+void
+MultiModelTrainer::SetEpochs (
+  const unsigned int  Epochs
+  )
+{
+  if (Epochs == 0) {
+    DEBUG_LOG ("Epochs should at least be 1.");
+    throw invalid_argument ("MultiModelTrainer::SetEpochs (): Invalid Epochs.");
+  }
+
+  this->Epochs = Epochs;
+}
+
+void
+MultiModelTrainer::SetBatchSize (
+  const unsigned int  BatchSize
+  )
+{
+  if (BatchSize == 0) {
+    DEBUG_LOG ("BatchSize should at least be 1.");
+    throw invalid_argument ("MultiModelTrainer::SetBatchSize (): Invalid BatchSize.");
+  }
+
+  this->BatchSize = BatchSize;
+}
+
+/**
+  Copy the first weight layer of a model into its rows of the stacked weights.
+
+**/
+void
+MultiModelTrainer::StackFirstLayer (
+  unsigned int  ModelIdx
+  )
+{
+  const matrix  &Weight = Models[ModelIdx]->Network.GetWeightsRef ()[0];
+
+  memcpy (
+    StackedWeights.Data() + (size_t)RowOffset[ModelIdx] * StackedWeights.getcolumn(),
+    Weight.Data(),
+    Weight.Size() * sizeof (double)
+    );
+}
+
+/**
+  Prepare every model for training and allocate the stacked buffers.
+
+**/
+void
+MultiModelTrainer::Init (
+  void
+  )
+{
+  unsigned int  InputSize   = Models[0]->Network.GetLayout ()[0];
+  unsigned int  TotalHidden = 0;
+
+  RowOffset.clear ();
+  for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+    BackPropagator  &Model = *Models[ModelIdx];
+
+    if ((Model.LowPrecision.GetMode () != PRECISION_DOUBLE) || (Model.DataParallelGroup != NULL) ||
+        (Model.ActivationCheckpointInterval > 1)) {
+      throw invalid_argument ("MultiModelTrainer::Train (): Models should train in double precision, alone and with all activations.");
+    }
+
+    Model.InitTrainingMode ();
+    Model.Scheduler.Init (Model.LearningRate, Epochs);
+
+    RowOffset.push_back (TotalHidden);
+    TotalHidden += Model.Network.GetLayout ()[1];
+  }
+
+  StackedWeights      = matrix (TotalHidden, InputSize);
+  StackedDeltaWeights = matrix (TotalHidden, InputSize);
+  BatchInput          = matrix (BatchSize, InputSize);
+  BatchHidden         = matrix (BatchSize, TotalHidden);
+  BatchDelta          = matrix (BatchSize, TotalHidden);
+
+  for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+    StackFirstLayer (ModelIdx);
+  }
+}
+
+/**
+  Train all models with one batch of data samples and update their weights.
+
+  @param[in]      Data              The data samples.
+  @param[in]      Indices           Shuffled sample indices of the epoch.
+  @param[in]      First             Position of the batch in Indices.
+  @param[in]      Count             Number of samples in the batch, at most BatchSize.
+  @param[in]      LearningRates     Learning rate of each model in this epoch.
+  @param[in,out]  Losses            Loss of each model, the batch's losses are added.
+
+**/
+void
+MultiModelTrainer::TrainOneBatch (
+  const DataSource            &Data,
+  const vector<unsigned int>  &Indices,
+  unsigned int                First,
+  unsigned int                Count,
+  const vector<double>        &LearningRates,
+  vector<double>              &Losses
+  )
+{
+  unsigned int  InputSize   = BatchInput.getcolumn();
+  unsigned int  TotalHidden = BatchHidden.getcolumn();
+
+  //
+  // Gather the batch, one sample per row. Unused rows of a short last batch
+  // get zero delta, so they add nothing to the weight gradients.
+  //
+  Data.GatherInputs (&Indices[First], Count, BatchInput);
+  if (Count < BatchSize) {
+    BatchDelta.Fill (0.0);
+  }
+
+  //
+  // First layer of all models for the whole batch.
+  //
+  MultiplyTransposeInto (BatchInput, StackedWeights, BatchHidden);
+
+  for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+    BackPropagator   &Model      = *Models[ModelIdx];
+    unsigned int     HiddenSize  = Model.Network.GetLayout ()[1];
+    ACTIVATION_FUNC  Activate    = GetActivationFunction (Model.Network.GetActivationType ());
+    vector<matrix>   &Activation = Model.Workspace.Activation;
+
+    for (unsigned int Sample = 0; Sample < Count; Sample++) {
+      const double  *Hidden = BatchHidden.Data() + (size_t)Sample * TotalHidden + RowOffset[ModelIdx];
+      double        *Act1   = Activation[1].Data();
+
+      for (unsigned int Node = 0; Node < HiddenSize; Node++) {
+        Act1[Node] = Activate (Hidden[Node]);
+      }
+
+      Model.Network.ForwardFrom (1, Activation);
+
+      Losses[ModelIdx] += Model.NodeDeltaCalculation (Data.GetDesiredOutput (Indices[First + Sample]));
+      Model.DeltaWeightsCalculation (1);
+
+      memcpy (
+        BatchDelta.Data() + (size_t)Sample * TotalHidden + RowOffset[ModelIdx],
+        Model.Workspace.NodeDelta[1].Data(),
+        HiddenSize * sizeof (double)
+        );
+    }
+  }
+
+  //
+  // First layer delta weights of all models for the whole batch.
+  //
+  TransposeMultiplyInto (BatchDelta, BatchInput, StackedDeltaWeights);
+
+  for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+    BackPropagator  &Model = *Models[ModelIdx];
+    matrix          &FirstDeltaWeights = Model.Workspace.BatchDeltaWeights[0];
+
+    memcpy (
+      FirstDeltaWeights.Data(),
+      StackedDeltaWeights.Data() + (size_t)RowOffset[ModelIdx] * InputSize,
+      FirstDeltaWeights.Size() * sizeof (double)
+      );
+
+    Model.CommitBatch (LearningRates[ModelIdx], Count);
+    StackFirstLayer (ModelIdx);
+  }
+}
+
+/**
+  Train all models on data samples already in network format.
+
+  @param[in]  InputDataSet      Input data samples.
+  @param[in]  DesiredOutputSet  Desired output of each sample.
+
+**/
+void
+MultiModelTrainer::Train (
+  const vector<matrix>  &InputDataSet,
+  const vector<matrix>  &DesiredOutputSet
+  )
+{
+  Train (MatrixDataSource (InputDataSet, DesiredOutputSet));
+}
+
+/**
+  Train all models on the same data set, with the same shuffled batches.
+
+  @param[in]  Data  The data samples.
+
+**/
+void
+MultiModelTrainer::Train (
+  const DataSource  &Data
+  )
+{
+  if (Models.empty ()) {
+    throw runtime_error ("MultiModelTrainer::Train (): No model to train.");
+  }
+  if ((Data.GetSampleCount () == 0) || BatchSize > Data.GetSampleCount ()) {
+    DEBUG_LOG (__FUNCTION__ << ": Batch size = " << BatchSize << ", Training data count = " << Data.GetSampleCount ());
+    throw runtime_error ("Batch size can't be larger than total training data set size.");
+  }
+
+  Init ();
+
+  vector<unsigned int>  Indices (Data.GetSampleCount ());
+  vector<double>        LearningRates (Models.size());
+  vector<double>        Losses (Models.size());
+
+  for (unsigned int Index = 0; Index < (unsigned int)Indices.size(); Index++) {
+    Indices[Index] = Index;
+  }
+
+  cout << endl << "Training " << Models.size() << " models on shared batches of " << BatchSize << endl;
+
+  for (unsigned int Epoch = 1; Epoch <= Epochs; Epoch++) {
+    uint64_t  StepAllocations;
+
+    for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+      LearningRates[ModelIdx] = Models[ModelIdx]->Scheduler.GetLearningRate (Epoch);
+      Losses[ModelIdx]        = 0.0;
+    }
+
+    Data.ShuffleEpoch (Indices, NULL);
+
+    for (unsigned int First = 0; First < (unsigned int)Indices.size(); First += BatchSize) {
+      StepAllocations = GetHeapAllocationCount ();
+
+      TrainOneBatch (
+        Data,
+        Indices,
+        First,
+        min (BatchSize, (unsigned int)Indices.size() - First),
+        LearningRates,
+        Losses
+        );
+
+      if (GetHeapAllocationCount () != StepAllocations) {
+        DEBUG_LOG ((GetHeapAllocationCount () - StepAllocations) << " heap allocations in a training step");
+        throw runtime_error ("Heap allocation in a steady-state training step.");
+      }
+    }
+
+    cout << "Epoch #" << Epoch << ": Loss =";
+    for (unsigned int ModelIdx = 0; ModelIdx < (unsigned int)Models.size(); ModelIdx++) {
+      Models[ModelIdx]->FinishPendingUpdate ();
+      StackFirstLayer (ModelIdx);
+      Losses[ModelIdx] /= Indices.size();
+      Models[ModelIdx]->Scheduler.Observe (Losses[ModelIdx]);
+      cout << " " << Losses[ModelIdx];
+    }
+    cout << endl;
+  }
+}
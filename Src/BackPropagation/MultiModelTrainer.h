@@ -0,0 +1,88 @@
+/**
+  Multi-model trainer definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _MULTI_MODEL_TRAINER_H_
+#define _MULTI_MODEL_TRAINER_H_
+
+#include "matrix.h"
+#include "BackPropagator.h"
+#include "DataSource.h"
+
+#include <vector>
+
+//
+// Trains K networks with the same input size on the same batches, e.g. an
+// ensemble or several seeds of one layout.
+//
+// The first weight layers of all networks are stacked into one
+// (Sum of first hidden layer sizes) * InputSize matrix, and the first layer of a
+// whole batch is done with two GEMMs over the stack:
+//
+//   Hidden(Batch * Sum H)       = Input(Batch * In) * Stacked^T
+//   StackedDelta(Sum H * In)    = Delta(Batch * Sum H)^T * Input(Batch * In)
+//
+// so each input batch is read once for all K models. Each model's own
+// BackPropagator does the layers after the first and the weight update, with its
+// own optimizer, learning rate and schedule. Validation, early stopping and a
+// target loss are rejected by AddModel(), reduced precision, activation
+// checkpointing and data-parallel training by Train().
+//
+class MultiModelTrainer
+{
+  public:
+    MultiModelTrainer ();
+
+    void AddModel (
+      BackPropagator  &Model
+      );
+
+    void SetEpochs (
+      const unsigned int  Epochs
+      );
+
+    void SetBatchSize (
+      const unsigned int  BatchSize
+      );
+
+    void Train (
+      const DataSource  &Data
+      );
+
+    void Train (
+      const std::vector<matrix>  &InputDataSet,
+      const std::vector<matrix>  &DesiredOutputSet
+      );
+
+  private:
+    void Init ();
+
+    void StackFirstLayer (
+      unsigned int  ModelIdx
+      );
+
+    void TrainOneBatch (
+      const DataSource                 &Data,
+      const std::vector<unsigned int>  &Indices,
+      unsigned int                     First,
+      unsigned int                     Count,
+      const std::vector<double>        &LearningRates,
+      std::vector<double>              &Losses
+      );
+
+    std::vector<BackPropagator *>  Models;
+    std::vector<unsigned int>      RowOffset;      // First row of each model in the stacked matrices.
+    unsigned int                   Epochs;
+    unsigned int                   BatchSize;
+
+    matrix                         StackedWeights;       // Sum H * In
+    matrix                         StackedDeltaWeights;  // Sum H * In
+    matrix                         BatchInput;           // BatchSize * In, one sample per row.
+    matrix                         BatchHidden;          // BatchSize * Sum H
+    matrix                         BatchDelta;           // BatchSize * Sum H
+};
+
+#endif
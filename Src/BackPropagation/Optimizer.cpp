@@ -0,0 +1,433 @@
+/**
+  Optimizer class implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "Optimizer.h"
+#include "DebugLib.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+/**
+  Constructor for Optimizer class. Defaults to plain SGD.
+
+**/
+Optimizer::Optimizer (
+  ) : Type (OPTIMIZER_SGD),
+      Momentum (0.9),
+      Beta1 (0.9),
+      Beta2 (0.999),
+      Epsilon (1e-8),
+      StepCount (0)
+{
+}
+
+void
+Optimizer::SetType (
+  const OPTIMIZER_TYPE  Type
+  )
+{
+  if (Type >= OPTIMIZER_TYPE_MAX) {
+    DEBUG_LOG ("Optimizer type = " << Type << " is unsupported.");
+    throw invalid_argument ("Optimizer::SetType (): Unsupported optimizer type.");
+  }
+
+  if (this->Type != Type) {
+    State0.clear ();
+    State1.clear ();
+    StepCount = 0;
+  }
+
+  this->Type = Type;
+}
+
+OPTIMIZER_TYPE
+Optimizer::GetType (
+  void
+  ) const
+{
+  return Type;
+}
+
+void
+Optimizer::SetMomentum (
+  const double  Momentum
+  )
+{
+  if (Momentum < 0.0 || Momentum >= 1.0) {
+    DEBUG_LOG ("Momentum = " << Momentum << " should be in [0, 1).");
+    throw invalid_argument ("Optimizer::SetMomentum (): Invalid momentum.");
+  }
+
+  this->Momentum = Momentum;
+}
+
+void
+Optimizer::SetAdamParams (
+  const double  Beta1,
+  const double  Beta2,
+  const double  Epsilon
+  )
+{
+  if (Beta1 < 0.0 || Beta1 >= 1.0 || Beta2 < 0.0 || Beta2 >= 1.0 || Epsilon <= 0.0) {
+    DEBUG_LOG ("Beta1 = " << Beta1 << ", Beta2 = " << Beta2 << ", Epsilon = " << Epsilon);
+    throw invalid_argument ("Optimizer::SetAdamParams (): Invalid Adam parameters.");
+  }
+
+  this->Beta1   = Beta1;
+  this->Beta2   = Beta2;
+  this->Epsilon = Epsilon;
+}
+
+/**
+  Get the number of state matrices kept per weight layer by current optimizer type.
+
+**/
+unsigned int
+Optimizer::StateCount (
+  void
+  ) const
+{
+  switch (Type) {
+    case OPTIMIZER_MOMENTUM:
+    case OPTIMIZER_NESTEROV:
+      return 1;
+
+    case OPTIMIZER_ADAM:
+      return 2;
+
+    default:
+      return 0;
+  }
+}
+
+/**
+  Check whether the optimizer state is allocated for a network layout.
+
+  @param[in]  Layout  Number of nodes in each layer of the network.
+
+  @retval  true   State matrices exist and match Layout.
+  @retval  false  Init() is required before Step().
+
+**/
+bool
+Optimizer::IsReady (
+  const vector<unsigned int>  &Layout
+  ) const
+{
+  unsigned int  Count = StateCount ();
+
+  for (unsigned int Index = 0; Index < Count; Index++) {
+    const vector<matrix>  &State = (Index == 0) ? State0 : State1;
+
+    if (State.size () + 1 != Layout.size ()) {
+      return false;
+    }
+    for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)State.size(); LayerIdx++) {
+      if (State[LayerIdx].getrow () != Layout[LayerIdx + 1] ||
+          State[LayerIdx].getcolumn () != Layout[LayerIdx]) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+  Allocate optimizer state for a network layout, all state is reset to zero.
+
+  @param[in]  Layout  Number of nodes in each layer of the network.
+
+**/
+void
+Optimizer::Init (
+  const vector<unsigned int>  &Layout
+  )
+{
+  unsigned int  Count = StateCount ();
+
+  State0.clear ();
+  State1.clear ();
+  StepCount = 0;
+
+  for (unsigned int Index = 0; Index + 1 < (unsigned int)Layout.size(); Index++) {
+    if (Count >= 1) {
+      State0.push_back (matrix (Layout[Index + 1], Layout[Index]));
+    }
+    if (Count >= 2) {
+      State1.push_back (matrix (Layout[Index + 1], Layout[Index]));
+    }
+  }
+}
+
+/**
+  Update the state and the weights of one layer in a single pass.
+
+  @param[in,out]  Weight         Weights of the layer.
+  @param[in]      Gradient       Descent direction of the layer, summed over the batch.
+  @param[in,out]  State0         Velocity or first moment, NULL for SGD.
+  @param[in,out]  State1         Second moment, NULL unless Adam.
+  @param[in]      Count          Number of elements of the layer.
+  @param[in]      LearningRate   Step size.
+  @param[in]      GradientScale  Factor applied to Gradient before use (e.g. 1 / batch size).
+
+**/
+void
+Optimizer::StepLayer (
+  double        *Weight,
+  const double  *Gradient,
+  double        *State0,
+  double        *State1,
+  size_t        Count,
+  double        LearningRate,
+  double        GradientScale
+  )
+{
+  const double  Mu = Momentum;
+
+  switch (Type) {
+    case OPTIMIZER_SGD:
+      {
+        const double  Rate = LearningRate * GradientScale;
+        for (size_t Index = 0; Index < Count; Index++) {
+          Weight[Index] += Rate * Gradient[Index];
+        }
+      }
+      break;
+
+    case OPTIMIZER_MOMENTUM:
+      //
+      // V = Mu * V + G,  W = W + Lr * V
+      //
+      for (size_t Index = 0; Index < Count; Index++) {
+        double  V = Mu * State0[Index] + GradientScale * Gradient[Index];
+        State0[Index]  = V;
+        Weight[Index] += LearningRate * V;
+      }
+      break;
+
+    case OPTIMIZER_NESTEROV:
+      //
+      // V = Mu * V + G,  W = W + Lr * (G + Mu * V)
+      //
+      for (size_t Index = 0; Index < Count; Index++) {
+        double  G = GradientScale * Gradient[Index];
+        double  V = Mu * State0[Index] + G;
+        State0[Index]  = V;
+        Weight[Index] += LearningRate * (G + Mu * V);
+      }
+      break;
+
+    case OPTIMIZER_ADAM:
+      {
+        //
+        // M = B1 * M + (1 - B1) * G,  S = B2 * S + (1 - B2) * G^2
+        // W = W + Lr * (M / (1 - B1^t)) / (sqrt (S / (1 - B2^t)) + Eps)
+        //
+        const double  B1         = Beta1;
+        const double  B2         = Beta2;
+        const double  Eps        = Epsilon;
+        const double  Correct1   = 1.0 / (1.0 - pow (B1, (double)StepCount));
+        const double  Correct2   = 1.0 / (1.0 - pow (B2, (double)StepCount));
+
+        for (size_t Index = 0; Index < Count; Index++) {
+          double  G = GradientScale * Gradient[Index];
+          double  M = B1 * State0[Index] + (1.0 - B1) * G;
+          double  S = B2 * State1[Index] + (1.0 - B2) * G * G;
+          State0[Index]  = M;
+          State1[Index]  = S;
+          Weight[Index] += LearningRate * (M * Correct1) / (sqrt (S * Correct2) + Eps);
+        }
+      }
+      break;
+
+    default:
+      DEBUG_LOG ("Unsupported optimizer type = " << Type);
+      throw runtime_error ("Unsupported optimizer type.");
+  }
+}
+
+/**
+  Apply one optimizer step to all weight layers.
+
+  @param[in,out]  Weights        Weights of each layer of the network.
+  @param[in]      Gradients      Descent direction of each layer, summed over the batch.
+  @param[in]      LearningRate   Step size.
+  @param[in]      GradientScale  Factor applied to Gradients before use (e.g. 1 / batch size).
+
+  @throw  std::runtime_error  Layer count or size of Gradients doesn't match Weights,
+                              or the optimizer state is not initialized.
+
+**/
+void
+Optimizer::Step (
+  vector<matrix>        &Weights,
+  const vector<matrix>  &Gradients,
+  const double          LearningRate,
+  const double          GradientScale
+  )
+{
+  unsigned int  Count = StateCount ();
+
+  if (Gradients.size() != Weights.size()) {
+    DEBUG_LOG ("Layer count of Gradients = " << Gradients.size() << " , Weights = " << Weights.size());
+    throw runtime_error ("Optimizer::Step (): Layer count of Gradients and Weights are different.");
+  }
+  if (((Count >= 1) && (State0.size() != Weights.size())) ||
+      ((Count >= 2) && (State1.size() != Weights.size()))) {
+    DEBUG_LOG ("Optimizer state has " << State0.size() << " layers, Weights has " << Weights.size());
+    throw runtime_error ("Optimizer::Step (): Optimizer state is not initialized.");
+  }
+
+  StepCount++;
+
+  for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)Weights.size(); LayerIdx++) {
+    if ((LayerIdx < (unsigned int)Frozen.size()) && Frozen[LayerIdx]) {
+      continue;
+    }
+    if (Gradients[LayerIdx].Size() != Weights[LayerIdx].Size()) {
+      DEBUG_LOG ("Layer " << LayerIdx << ": Gradient size = " << Gradients[LayerIdx].Size() << ", Weight size = " << Weights[LayerIdx].Size());
+      throw runtime_error ("Optimizer::Step (): Size of Gradients and Weights are different.");
+    }
+
+    StepLayer (
+      Weights[LayerIdx].Data(),
+      Gradients[LayerIdx].Data(),
+      (Count >= 1) ? State0[LayerIdx].Data() : NULL,
+      (Count >= 2) ? State1[LayerIdx].Data() : NULL,
+      Weights[LayerIdx].Size(),
+      LearningRate,
+      GradientScale
+      );
+  }
+}
+
+/**
+  Select the weight layers Step() doesn't update, e.g. the frozen layers of a fine-tuning.
+  Their optimizer state is kept as it is.
+
+  @param[in]  Frozen  true for each weight layer to leave alone.
+
+**/
+void
+Optimizer::SetFrozenLayers (
+  const vector<bool>  &Frozen
+  )
+{
+  this->Frozen = Frozen;
+}
+
+void
+Optimizer::ShowInfo (
+  void
+  ) const
+{
+  static const char  *TypeName[] = { "SGD", "MOMENTUM", "NESTEROV", "ADAM" };
+
+  cout << "  Optimizer     : " << TypeName[Type] << endl;
+  if (Type == OPTIMIZER_MOMENTUM || Type == OPTIMIZER_NESTEROV) {
+    cout << "  Momentum      : " << Momentum << endl;
+  }
+  if (Type == OPTIMIZER_ADAM) {
+    cout << "  Adam (B1, B2, Eps) : (" << Beta1 << ", " << Beta2 << ", " << Epsilon << ")" << endl;
+  }
+}
+
+/**
+  Write the optimizer header and state matrices to the given stream.
+
+  @param  fs  The file or memory stream to write to, positioned after the network weights.
+
+**/
+void
+Optimizer::ExportState (
+  ostream  &fs
+  ) const
+{
+  OPTIMIZER_FILE  FileHeader;
+  unsigned int    Count = StateCount ();
+
+  memset (&FileHeader, 0, sizeof (FileHeader));
+
+  FileHeader.Signature  = OPTIMIZER_FILE_SIGNATURE;
+  FileHeader.HdrSize    = sizeof (OPTIMIZER_FILE);
+  FileHeader.Type       = (u_int32_t)Type;
+  FileHeader.StateCount = (Count != 0 && State0.empty ()) ? 0 : Count;
+  FileHeader.StepCount  = StepCount;
+  FileHeader.Momentum   = Momentum;
+  FileHeader.Beta1      = Beta1;
+  FileHeader.Beta2      = Beta2;
+  FileHeader.Epsilon    = Epsilon;
+
+  fs.write (reinterpret_cast<const char *>(&FileHeader), sizeof (FileHeader));
+
+  for (unsigned int Index = 0; Index < FileHeader.StateCount; Index++) {
+    const vector<matrix>  &State = (Index == 0) ? State0 : State1;
+    for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)State.size(); LayerIdx++) {
+      fs.write (reinterpret_cast<const char *>(State[LayerIdx].Data()), State[LayerIdx].Size() * sizeof(double));
+    }
+  }
+}
+
+/**
+  Read the optimizer header and state matrices from the given stream.
+  The optimizer type and hyperparameters are taken from the file, and the
+  state is re-allocated for Layout before it's read.
+
+  @param  fs      The file or memory stream to read from, positioned after the network weights.
+  @param  Layout  Number of nodes in each layer of the network.
+
+  @throw  std::runtime_error  The optimizer section is missing or invalid.
+
+**/
+void
+Optimizer::ImportState (
+  istream                     &fs,
+  const vector<unsigned int>  &Layout
+  )
+{
+  OPTIMIZER_FILE  FileHeader;
+
+  fs.read (reinterpret_cast<char *>(&FileHeader), sizeof (FileHeader));
+  if (!fs || FileHeader.Signature != OPTIMIZER_FILE_SIGNATURE) {
+    DEBUG_LOG ("Optimizer section is missing or has invalid signature.");
+    throw runtime_error ("Optimizer::ImportState (): No optimizer state in file.");
+  }
+  if (FileHeader.HdrSize != sizeof (OPTIMIZER_FILE) || FileHeader.Type >= OPTIMIZER_TYPE_MAX) {
+    DEBUG_LOG ("Optimizer HdrSize = " << FileHeader.HdrSize << ", Type = " << FileHeader.Type);
+    throw runtime_error ("Optimizer::ImportState (): Invalid optimizer header.");
+  }
+
+  Type     = (OPTIMIZER_TYPE)FileHeader.Type;
+  Momentum = FileHeader.Momentum;
+  Beta1    = FileHeader.Beta1;
+  Beta2    = FileHeader.Beta2;
+  Epsilon  = FileHeader.Epsilon;
+
+  Init (Layout);
+
+  if (FileHeader.StateCount != 0 && FileHeader.StateCount != StateCount ()) {
+    DEBUG_LOG ("StateCount in file = " << FileHeader.StateCount << ", expected " << StateCount ());
+    throw runtime_error ("Optimizer::ImportState (): Invalid optimizer state count.");
+  }
+
+  for (unsigned int Index = 0; Index < FileHeader.StateCount; Index++) {
+    vector<matrix>  &State = (Index == 0) ? State0 : State1;
+    for (unsigned int LayerIdx = 0; LayerIdx < (unsigned int)State.size(); LayerIdx++) {
+      fs.read (reinterpret_cast<char *>(State[LayerIdx].Data()), State[LayerIdx].Size() * sizeof(double));
+    }
+  }
+
+  if (!fs) {
+    throw runtime_error ("Optimizer::ImportState (): Optimizer state is truncated.");
+  }
+
+  StepCount = FileHeader.StepCount;
+}
@@ -0,0 +1,121 @@
+/**
+  Optimizer class definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _OPTIMIZER_H_
+#define _OPTIMIZER_H_
+
+#include "matrix.h"
+
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+typedef enum {
+  OPTIMIZER_SGD = 0,
+  OPTIMIZER_MOMENTUM,
+  OPTIMIZER_NESTEROV,
+  OPTIMIZER_ADAM,
+  OPTIMIZER_TYPE_MAX
+} OPTIMIZER_TYPE;
+
+//
+// Weight update rule applied once per batch.
+//
+// The gradients handed to Step() follow the BackPropagator convention: they
+// are the descent direction -dLoss/dWeight summed over the batch, so every
+// rule below *adds* to the weights.
+//
+class Optimizer
+{
+  public:
+    Optimizer ();
+
+    void SetType (
+      const OPTIMIZER_TYPE  Type
+      );
+
+    OPTIMIZER_TYPE GetType () const;
+
+    void SetMomentum (
+      const double  Momentum
+      );
+
+    void SetAdamParams (
+      const double  Beta1,
+      const double  Beta2,
+      const double  Epsilon
+      );
+
+    bool IsReady (
+      const std::vector<unsigned int>  &Layout
+      ) const;
+
+    void Init (
+      const std::vector<unsigned int>  &Layout
+      );
+
+    void SetFrozenLayers (
+      const std::vector<bool>  &Frozen
+      );
+
+    void Step (
+      std::vector<matrix>        &Weights,
+      const std::vector<matrix>  &Gradients,
+      const double               LearningRate,
+      const double               GradientScale
+      );
+
+    void ShowInfo () const;
+
+    void ExportState (std::ostream &) const;
+    void ImportState (std::istream &, const std::vector<unsigned int> &);
+
+  private:
+    unsigned int StateCount () const;
+
+    void StepLayer (
+      double        *Weight,
+      const double  *Gradient,
+      double        *State0,
+      double        *State1,
+      size_t        Count,
+      double        LearningRate,
+      double        GradientScale
+      );
+
+    OPTIMIZER_TYPE         Type;
+    double                 Momentum;
+    double                 Beta1;
+    double                 Beta2;
+    double                 Epsilon;
+    uint64_t               StepCount;
+    std::vector<bool>      Frozen;        // Layers Step() leaves alone, with their state.
+
+    //
+    // State0 holds the velocity (momentum, Nesterov) or first moment (Adam),
+    // State1 holds the second moment (Adam only).
+    //
+    std::vector<matrix>    State0;
+    std::vector<matrix>    State1;
+};
+
+typedef struct {
+  u_int32_t Signature;
+  u_int32_t HdrSize;     // Size of this header in bytes.
+  u_int32_t Type;        // OPTIMIZER_TYPE
+  u_int32_t StateCount;  // Number of state matrices per weight layer.
+  u_int64_t StepCount;
+  double    Momentum;
+  double    Beta1;
+  double    Beta2;
+  double    Epsilon;
+  // double State0[...] for each weight layer, then State1[...] if StateCount == 2.
+} OPTIMIZER_FILE;
+
+#define OPTIMIZER_FILE_SIGNATURE 0x5354504F  // "OPTS" in ASCII
+
+#endif
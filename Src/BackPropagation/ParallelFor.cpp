@@ -0,0 +1,81 @@
+/**
+  Parallel loop implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "ParallelFor.h"
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <sys/types.h>
+
+using namespace std;
+
+/**
+  Get the number of parts ParallelFor() splits Count items into.
+
+  @param[in]  Count        Number of items.
+  @param[in]  MinPartSize  Fewest items worth a thread of their own.
+
+  @return  Number of parts, at least 1.
+
+**/
+unsigned int
+ParallelPartCount (
+  const unsigned int  Count,
+  const unsigned int  MinPartSize
+  )
+{
+  unsigned int  Cpus = max (1u, thread::hardware_concurrency ());
+
+  return max (1u, min (Cpus, Count / max (1u, MinPartSize)));
+}
+
+/**
+  Run Work on every part of the items, part 0 on the calling thread and each other
+  part on a thread of its own, and wait for all of them. If parts throw, the
+  exception of the lowest one is passed on once all parts have ended.
+
+  @param[in]  Count        Number of items.
+  @param[in]  MinPartSize  Fewest items worth a thread of their own.
+  @param[in]  Work         Called once per part with the part and its item range.
+
+**/
+void
+ParallelFor (
+  const unsigned int   Count,
+  const unsigned int   MinPartSize,
+  const PARALLEL_WORK  &Work
+  )
+{
+  unsigned int           Parts = ParallelPartCount (Count, MinPartSize);
+  vector<exception_ptr>  Errors (Parts);
+  vector<thread>         Workers;
+
+  auto  RunPart = [&] (unsigned int Part) {
+    try {
+      Work (Part, (unsigned int)((u_int64_t)Part * Count / Parts), (unsigned int)((u_int64_t)(Part + 1) * Count / Parts));
+    } catch (...) {
+      Errors[Part] = current_exception ();
+    }
+  };
+
+  for (unsigned int Part = 1; Part < Parts; Part++) {
+    Workers.push_back (thread (RunPart, Part));
+  }
+  RunPart (0);
+
+  for (unsigned int Index = 0; Index < (unsigned int)Workers.size(); Index++) {
+    Workers[Index].join ();
+  }
+
+  for (unsigned int Part = 0; Part < Parts; Part++) {
+    if (Errors[Part]) {
+      rethrow_exception (Errors[Part]);
+    }
+  }
+}
@@ -0,0 +1,39 @@
+/**
+  Parallel loop definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _PARALLEL_FOR_H_
+#define _PARALLEL_FOR_H_
+
+#include <functional>
+
+//
+// Splits the items [0, Count) into parts of consecutive items, one per thread,
+// for one-off work such as loading a data set. Part Part covers
+//
+//   [Part * Count / Parts, (Part + 1) * Count / Parts)
+//
+// and the split only depends on Count and MinPartSize, so two loops over the same
+// items get the same parts, e.g. one counting per part and one writing from the
+// counts' prefix sums. Parts has at most one per CPU and at least MinPartSize
+// items each, so small loops stay on the calling thread.
+//
+typedef std::function<void (unsigned int Part, unsigned int First, unsigned int End)>  PARALLEL_WORK;
+
+unsigned int
+ParallelPartCount (
+  const unsigned int  Count,
+  const unsigned int  MinPartSize
+  );
+
+void
+ParallelFor (
+  const unsigned int   Count,
+  const unsigned int   MinPartSize,
+  const PARALLEL_WORK  &Work
+  );
+
+#endif
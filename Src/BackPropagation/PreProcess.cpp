@@ -5,22 +5,304 @@
   Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
 **/
 
-#include "BpMisc.h"
+#include "PreProcess.h"
+#include "CompactDataSet.h"
+#include "ParallelFor.h"
+#include "DebugLib.h"
 
 #include <vector>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 
 using namespace std;
 
-double
-PixelBinarization (
-  double x
+//
+// Fewest samples summed or converted by a thread of their own.
+//
+#define  MIN_SAMPLES_PER_THREAD  1024
+
+InputPreProcessor::InputPreProcessor (
+  ) : Mode (PREPROCESS_NONE),
+      FeatureCount (0),
+      Fitted (true)
+{
+}
+
+/**
+  Set how pixels are converted. Every mode but standardization is ready right
+  away, standardization needs Fit() afterwards.
+
+  @param[in]  Mode          The conversion.
+  @param[in]  FeatureCount  Number of pixels of a sample.
+
+  @throw  invalid_argument  Mode is unknown.
+
+**/
+void
+InputPreProcessor::SetMode (
+  const PREPROCESS_MODE  Mode,
+  const unsigned int     FeatureCount
   )
 {
-  return (x > 128) ? 1.0 : 0.0;
+  if (Mode >= PREPROCESS_MODE_MAX) {
+    DEBUG_LOG ("Mode = " << Mode);
+    throw invalid_argument ("InputPreProcessor::SetMode (): Invalid Mode.");
+  }
+
+  this->Mode         = Mode;
+  this->FeatureCount = FeatureCount;
+
+  Gain.assign (FeatureCount, (Mode == PREPROCESS_SCALE) ? 1.0 / 255.0 : 1.0);
+  Offset.assign (FeatureCount, 0.0);
+  Fitted = (Mode != PREPROCESS_STANDARDIZE);
+}
+
+PREPROCESS_MODE
+InputPreProcessor::GetMode (
+  ) const
+{
+  return Mode;
 }
 
 /**
-  Binarize the pixel values in the dataset.
+  Compute the mean and standard deviation of every feature over a training set,
+  for standardization. Does nothing in the other modes.
+
+  The threads sum the pixels and their squares of consecutive samples into
+  integers of their own, so the sums are exact and the same for any number of
+  threads.
+
+  @param[in]  Data  The training set, before it is split between workers.
+
+  @throw  invalid_argument  Data is empty or doesn't have FeatureCount pixels per sample.
+
+**/
+void
+InputPreProcessor::Fit (
+  const CompactDataSet  &Data
+  )
+{
+  unsigned int  SampleCount = Data.GetSampleCount ();
+
+  if (Mode != PREPROCESS_STANDARDIZE) {
+    return;
+  }
+
+  if ((SampleCount == 0) || (Data.GetRows () * Data.GetColumns () != FeatureCount)) {
+    DEBUG_LOG ("SampleCount = " << SampleCount << ", Rows = " << Data.GetRows () << ", Columns = " << Data.GetColumns () << ", FeatureCount = " << FeatureCount);
+    throw invalid_argument ("InputPreProcessor::Fit (): Data doesn't match the preprocessor.");
+  }
+
+  unsigned int               Parts = ParallelPartCount (SampleCount, MIN_SAMPLES_PER_THREAD);
+  vector<vector<u_int64_t> > Sum (Parts, vector<u_int64_t> (FeatureCount, 0));
+  vector<vector<u_int64_t> > SquareSum (Parts, vector<u_int64_t> (FeatureCount, 0));
+
+  ParallelFor (SampleCount, MIN_SAMPLES_PER_THREAD, [&] (unsigned int Part, unsigned int First, unsigned int End) {
+    u_int64_t  *PartSum       = Sum[Part].data ();
+    u_int64_t  *PartSquareSum = SquareSum[Part].data ();
+
+    for (unsigned int Index = First; Index < End; Index++) {
+      const u_int8_t  *Pixels = Data.GetPixels (Index);
+
+      #pragma omp simd
+      for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+        u_int32_t  Pixel = Pixels[Feature];
+
+        PartSum[Feature]       += Pixel;
+        PartSquareSum[Feature] += Pixel * Pixel;
+      }
+    }
+  });
+
+  //
+  // Input = (Pixel - Mean) / Std = Pixel * (1 / Std) - Mean / Std
+  //
+  for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+    u_int64_t  TotalSum       = 0;
+    u_int64_t  TotalSquareSum = 0;
+
+    for (unsigned int Part = 0; Part < Parts; Part++) {
+      TotalSum       += Sum[Part][Feature];
+      TotalSquareSum += SquareSum[Part][Feature];
+    }
+
+    double  Mean     = (double)TotalSum / SampleCount;
+    double  Variance = (double)TotalSquareSum / SampleCount - Mean * Mean;
+
+    if (Variance > 0.0) {
+      Gain[Feature]   = 1.0 / sqrt (Variance);
+      Offset[Feature] = -Mean * Gain[Feature];
+    } else {
+      Gain[Feature]   = 0.0;
+      Offset[Feature] = 0.0;
+    }
+  }
+
+  Fitted = true;
+}
+
+/**
+  Whether Convert() can be used, i.e. a standardization is fitted.
+
+**/
+bool
+InputPreProcessor::IsReady (
+  ) const
+{
+  return Fitted;
+}
+
+/**
+  Convert the pixels of a sample into network input values.
+
+  @param[in]   Source  FeatureCount pixel bytes.
+  @param[out]  Target  FeatureCount input values.
+
+**/
+void
+InputPreProcessor::Convert (
+  const u_int8_t  *Source,
+  double          *Target
+  ) const
+{
+  const double  *FeatureGain   = Gain.data ();
+  const double  *FeatureOffset = Offset.data ();
+
+  if (Mode == PREPROCESS_BINARIZE) {
+    #pragma omp simd
+    for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+      Target[Feature] = (Source[Feature] > BINARIZE_THRESHOLD) ? 1.0 : 0.0;
+    }
+  } else {
+    #pragma omp simd
+    for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+      Target[Feature] = Source[Feature] * FeatureGain[Feature] + FeatureOffset[Feature];
+    }
+  }
+}
+
+/**
+  Convert a data set of pixel values, stored as doubles, in place and in parallel.
+
+  @param[in,out]  DataSet  Samples of FeatureCount pixel values each.
+
+  @throw  invalid_argument  A sample doesn't have FeatureCount values, or the
+                            preprocessor is not ready.
+
+**/
+void
+InputPreProcessor::Apply (
+  vector<matrix>  &DataSet
+  ) const
+{
+  if (!Fitted) {
+    throw invalid_argument ("InputPreProcessor::Apply (): Standardization is not fitted.");
+  }
+
+  for (unsigned int Index = 0; Index < (unsigned int)DataSet.size(); Index++) {
+    if (DataSet[Index].Size () != FeatureCount) {
+      DEBUG_LOG ("Sample " << Index << " has " << DataSet[Index].Size () << " values, FeatureCount = " << FeatureCount);
+      throw invalid_argument ("InputPreProcessor::Apply (): Sample doesn't match the preprocessor.");
+    }
+  }
+
+  ParallelFor ((unsigned int)DataSet.size(), MIN_SAMPLES_PER_THREAD, [&] (unsigned int Part, unsigned int First, unsigned int End) {
+    const double  *FeatureGain   = Gain.data ();
+    const double  *FeatureOffset = Offset.data ();
+
+    for (unsigned int Index = First; Index < End; Index++) {
+      double  *Values = DataSet[Index].Data ();
+
+      if (Mode == PREPROCESS_BINARIZE) {
+        #pragma omp simd
+        for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+          Values[Feature] = (Values[Feature] > BINARIZE_THRESHOLD) ? 1.0 : 0.0;
+        }
+      } else {
+        #pragma omp simd
+        for (unsigned int Feature = 0; Feature < FeatureCount; Feature++) {
+          Values[Feature] = Values[Feature] * FeatureGain[Feature] + FeatureOffset[Feature];
+        }
+      }
+    }
+  });
+}
+
+void
+InputPreProcessor::ShowInfo (
+  ) const
+{
+  static const char  *ModeName[] = { "NONE", "BINARIZE", "SCALE", "STANDARDIZE" };
+
+  cout << "  Preprocessing : " << ModeName[Mode] << endl;
+}
+
+/**
+  Write the preprocessing header, gains and offsets to the given stream.
+
+  @param  fs  The file or memory stream to write to.
+
+**/
+void
+InputPreProcessor::ExportToStream (
+  ostream  &fs
+  ) const
+{
+  PREPROCESS_FILE  FileHeader;
+
+  memset (&FileHeader, 0, sizeof (FileHeader));
+
+  FileHeader.Signature    = PREPROCESS_FILE_SIGNATURE;
+  FileHeader.HdrSize      = sizeof (PREPROCESS_FILE);
+  FileHeader.Mode         = (u_int32_t)Mode;
+  FileHeader.FeatureCount = FeatureCount;
+
+  fs.write (reinterpret_cast<const char *>(&FileHeader), sizeof (FileHeader));
+  fs.write (reinterpret_cast<const char *>(Gain.data ()), Gain.size () * sizeof (double));
+  fs.write (reinterpret_cast<const char *>(Offset.data ()), Offset.size () * sizeof (double));
+}
+
+/**
+  Read the preprocessing header, gains and offsets from the given stream, e.g.
+  to convert inputs for inference the way the model was trained.
+
+  @param  fs  The file or memory stream to read from.
+
+  @throw  std::runtime_error  The preprocessing section is missing, invalid or truncated.
+
+**/
+void
+InputPreProcessor::ImportFromStream (
+  istream  &fs
+  )
+{
+  PREPROCESS_FILE  FileHeader;
+
+  fs.read (reinterpret_cast<char *>(&FileHeader), sizeof (FileHeader));
+  if (!fs || (FileHeader.Signature != PREPROCESS_FILE_SIGNATURE)) {
+    DEBUG_LOG ("Preprocessing section is missing or has invalid signature.");
+    throw runtime_error ("InputPreProcessor::ImportFromStream (): No preprocessing in file.");
+  }
+  if ((FileHeader.HdrSize != sizeof (PREPROCESS_FILE)) || (FileHeader.Mode >= PREPROCESS_MODE_MAX)) {
+    DEBUG_LOG ("Preprocessing HdrSize = " << FileHeader.HdrSize << ", Mode = " << FileHeader.Mode);
+    throw runtime_error ("InputPreProcessor::ImportFromStream (): Invalid preprocessing header.");
+  }
+
+  SetMode ((PREPROCESS_MODE)FileHeader.Mode, FileHeader.FeatureCount);
+
+  fs.read (reinterpret_cast<char *>(Gain.data ()), Gain.size () * sizeof (double));
+  fs.read (reinterpret_cast<char *>(Offset.data ()), Offset.size () * sizeof (double));
+  if (!fs) {
+    DEBUG_LOG ("Preprocessing section is truncated.");
+    throw runtime_error ("InputPreProcessor::ImportFromStream (): Truncated preprocessing section.");
+  }
+
+  Fitted = true;
+}
+
+/**
+  Binarize the pixel values in the dataset, in place.
 
   This function converts pixel values in the dataset to binary values.
   Pixel values greater than 128 are set to 1, and others are set to 0.
@@ -34,9 +316,12 @@ DataBinarization (
   vector<matrix>  &DataSet
   )
 {
-  function<double(double)> Binarization = PixelBinarization;
+  InputPreProcessor  Binarization;
 
-  for(int Index = 0; Index < (int)DataSet.size(); Index++) {
-    DataSet[Index].ApplyElementWise (Binarization);
+  if (DataSet.empty ()) {
+    return;
   }
-}
\ No newline at end of file
+
+  Binarization.SetMode (PREPROCESS_BINARIZE, DataSet[0].Size ());
+  Binarization.Apply (DataSet);
+}
@@ -8,12 +8,89 @@
 #ifndef _PRE_PROCESS_H_
 #define _PRE_PROCESS_H_
 
-#include "BpMisc.h"
+#include "matrix.h"
 
 #include <vector>
+#include <iostream>
+#include <sys/types.h>
+
+class CompactDataSet;
+
+typedef enum {
+  PREPROCESS_NONE = 0,       // Pixel values as they are.
+  PREPROCESS_BINARIZE,       // 1 above 128, else 0.
+  PREPROCESS_SCALE,          // Pixel / 255, in [0, 1].
+  PREPROCESS_STANDARDIZE,    // (Pixel - Mean) / Std of each feature over the training set.
+  PREPROCESS_MODE_MAX
+} PREPROCESS_MODE;
+
+#define BINARIZE_THRESHOLD  128
+
+//
+// Turns the pixel bytes of a sample into network input values. Every mode but
+// binarization is Pixel * Gain[Feature] + Offset[Feature], so the conversion is
+// one multiply-add per feature, in SIMD loops, into the caller's buffer with no
+// copy of the data set. CompactDataSet and StreamingDataSet convert through it,
+// and Apply() converts a data set of matrices in place.
+//
+// Fit() computes the standardization statistics of a training set in one
+// parallel pass of exact integer sums. Features that never change, e.g. the
+// border of MNIST, get Gain 0 and are always 0. The same preprocessor must be
+// used for validation, testing and inference, ExportToStream() saves it with
+// the model.
+//
+class InputPreProcessor
+{
+  public:
+    InputPreProcessor ();
+
+    void SetMode (
+      const PREPROCESS_MODE  Mode,
+      const unsigned int     FeatureCount
+      );
+
+    PREPROCESS_MODE GetMode () const;
+
+    void Fit (
+      const CompactDataSet  &Data
+      );
+
+    bool IsReady () const;
+
+    void Convert (
+      const u_int8_t  *Source,
+      double          *Target
+      ) const;
+
+    void Apply (
+      std::vector<matrix>  &DataSet
+      ) const;
+
+    void ShowInfo () const;
+
+    void ExportToStream (std::ostream &) const;
+    void ImportFromStream (std::istream &);
+
+  private:
+    PREPROCESS_MODE      Mode;
+    unsigned int         FeatureCount;
+    bool                 Fitted;       // Gain and Offset are set for Mode.
+    std::vector<double>  Gain;
+    std::vector<double>  Offset;
+};
+
+typedef struct {
+  u_int32_t  Signature;
+  u_int32_t  HdrSize;        // Size of this header in bytes.
+  u_int32_t  Mode;           // PREPROCESS_MODE
+  u_int32_t  FeatureCount;
+  // double Gain[FeatureCount], then double Offset[FeatureCount].
+} PREPROCESS_FILE;
+
+#define PREPROCESS_FILE_SIGNATURE  0x50455250  // "PREP" in ASCII
 
 /**
-  Binarize the pixel values in the dataset.
+  Binarize the pixel values in the dataset, in place.
 
   This function converts pixel values in the dataset to binary values.
   Pixel values greater than 128 are set to 1, and others are set to 0.
@@ -27,4 +104,4 @@ DataBinarization (
   std::vector<matrix>  &DataSet
   );
 
-#endif
\ No newline at end of file
+#endif
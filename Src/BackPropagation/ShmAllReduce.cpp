@@ -0,0 +1,390 @@
+/**
+  Shared memory allreduce group implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "ShmAllReduce.h"
+#include "DebugLib.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+static
+size_t
+AlignUp (
+  size_t  Size
+  )
+{
+  return (Size + SHM_ALL_REDUCE_ALIGNMENT - 1) & ~(size_t)(SHM_ALL_REDUCE_ALIGNMENT - 1);
+}
+
+static
+size_t
+GetSlotSize (
+  const size_t  Capacity
+  )
+{
+  return AlignUp (Capacity * sizeof (double));
+}
+
+/**
+  Get the size of the shared memory segment of a group: header, result area and one slot per rank.
+
+**/
+static
+size_t
+GetSegmentSize (
+  const unsigned int  WorldSize,
+  const size_t        Capacity
+  )
+{
+  return AlignUp (sizeof (SHM_ALL_REDUCE_HEADER)) + GetSlotSize (Capacity) * (WorldSize + 1);
+}
+
+/**
+  Constructor for ShmAllReduce class. The object is unusable until Attach() is called.
+
+**/
+ShmAllReduce::ShmAllReduce (
+  ) : Mapping (NULL),
+      MappingSize (0),
+      Rank (0),
+      WorldSize (1),
+      Capacity (0),
+      Result (NULL),
+      Slot (NULL),
+      Slots (NULL)
+{
+}
+
+ShmAllReduce::~ShmAllReduce (
+  )
+{
+  if (Mapping != NULL) {
+    munmap (Mapping, MappingSize);
+  }
+}
+
+/**
+  Create and initialize the shared memory segment of a group.
+  Called once by the launcher before any worker is started.
+
+  @param[in]  Name       POSIX shared memory object name, e.g. "/BpProgram.1234".
+  @param[in]  WorldSize  Number of worker processes.
+  @param[in]  Capacity   Largest number of doubles to be reduced in one call.
+
+  @throw std::runtime_error if the segment can't be created.
+
+**/
+void
+ShmAllReduce::Create (
+  const string        &Name,
+  const unsigned int  WorldSize,
+  const size_t        Capacity
+  )
+{
+  if (WorldSize == 0 || Capacity == 0) {
+    DEBUG_LOG ("WorldSize = " << WorldSize << ", Capacity = " << Capacity);
+    throw invalid_argument ("ShmAllReduce::Create (): Invalid group size.");
+  }
+
+  size_t  SegmentSize = GetSegmentSize (WorldSize, Capacity);
+  int     Fd;
+
+  Fd = shm_open (Name.c_str (), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (Fd < 0) {
+    DEBUG_LOG ("shm_open (" << Name << "): " << strerror (errno));
+    throw runtime_error ("ShmAllReduce::Create (): Failed to create shared memory object.");
+  }
+
+  if (ftruncate (Fd, (off_t)SegmentSize) != 0) {
+    DEBUG_LOG ("ftruncate (" << SegmentSize << "): " << strerror (errno));
+    close (Fd);
+    shm_unlink (Name.c_str ());
+    throw runtime_error ("ShmAllReduce::Create (): Failed to size shared memory object.");
+  }
+
+  void  *Segment = mmap (NULL, SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  close (Fd);
+  if (Segment == MAP_FAILED) {
+    shm_unlink (Name.c_str ());
+    throw runtime_error ("ShmAllReduce::Create (): Failed to map shared memory object.");
+  }
+
+  SHM_ALL_REDUCE_HEADER  *Header = (SHM_ALL_REDUCE_HEADER *)Segment;
+  pthread_barrierattr_t  Attribute;
+
+  pthread_barrierattr_init (&Attribute);
+  pthread_barrierattr_setpshared (&Attribute, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init (&Header->Barrier, &Attribute, WorldSize);
+  pthread_barrierattr_destroy (&Attribute);
+
+  Header->WorldSize = WorldSize;
+  Header->Capacity  = Capacity;
+  Header->Signature = SHM_ALL_REDUCE_SIGNATURE;
+
+  munmap (Segment, SegmentSize);
+}
+
+/**
+  Remove the shared memory object of a group. Mappings of running workers stay valid.
+
+  @param[in]  Name  POSIX shared memory object name given to Create().
+
+**/
+void
+ShmAllReduce::Destroy (
+  const string  &Name
+  )
+{
+  shm_unlink (Name.c_str ());
+}
+
+/**
+  Join a group created by Create().
+
+  @param[in]  Name  POSIX shared memory object name given to Create().
+  @param[in]  Rank  Rank of this worker, 0 to WorldSize - 1.
+
+  @throw std::runtime_error if the segment can't be mapped or isn't a group segment.
+
+**/
+void
+ShmAllReduce::Attach (
+  const string        &Name,
+  const unsigned int  Rank
+  )
+{
+  SHM_ALL_REDUCE_HEADER  Header;
+  int                    Fd;
+
+  if (Mapping != NULL) {
+    throw runtime_error ("ShmAllReduce::Attach (): Already attached.");
+  }
+
+  Fd = shm_open (Name.c_str (), O_RDWR, 0600);
+  if (Fd < 0) {
+    DEBUG_LOG ("shm_open (" << Name << "): " << strerror (errno));
+    throw runtime_error ("ShmAllReduce::Attach (): Failed to open shared memory object.");
+  }
+
+  if (pread (Fd, &Header, sizeof (Header), 0) != (ssize_t)sizeof (Header) ||
+      Header.Signature != SHM_ALL_REDUCE_SIGNATURE) {
+    close (Fd);
+    throw runtime_error ("ShmAllReduce::Attach (): Invalid shared memory segment.");
+  }
+
+  if (Rank >= Header.WorldSize) {
+    close (Fd);
+    DEBUG_LOG ("Rank = " << Rank << ", WorldSize = " << Header.WorldSize);
+    throw invalid_argument ("ShmAllReduce::Attach (): Rank out of range.");
+  }
+
+  MappingSize = GetSegmentSize (Header.WorldSize, Header.Capacity);
+  Mapping     = mmap (NULL, MappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  close (Fd);
+  if (Mapping == MAP_FAILED) {
+    Mapping = NULL;
+    throw runtime_error ("ShmAllReduce::Attach (): Failed to map shared memory object.");
+  }
+
+  size_t  SlotDoubles = GetSlotSize (Header.Capacity) / sizeof (double);
+
+  this->Rank      = Rank;
+  this->WorldSize = Header.WorldSize;
+  this->Capacity  = Header.Capacity;
+
+  Result = (double *)((char *)Mapping + AlignUp (sizeof (SHM_ALL_REDUCE_HEADER)));
+  Slots  = Result + SlotDoubles;
+  Slot   = Slots + SlotDoubles * Rank;
+}
+
+unsigned int
+ShmAllReduce::GetRank (
+  ) const
+{
+  return Rank;
+}
+
+unsigned int
+ShmAllReduce::GetWorldSize (
+  ) const
+{
+  return WorldSize;
+}
+
+/**
+  Wait until every worker of the group reaches the barrier.
+
+**/
+void
+ShmAllReduce::Barrier (
+  void
+  )
+{
+  if (Mapping == NULL) {
+    throw runtime_error ("ShmAllReduce::Barrier (): Not attached.");
+  }
+
+  pthread_barrier_wait (&((SHM_ALL_REDUCE_HEADER *)Mapping)->Barrier);
+}
+
+/**
+  Sum the first Count values of every slot into Result. Each rank reduces its own
+  chunk, which is complete once all ranks pass the following barrier.
+
+**/
+void
+ShmAllReduce::ReduceScatter (
+  size_t  Count
+  )
+{
+  size_t  SlotDoubles = GetSlotSize (Capacity) / sizeof (double);
+  size_t  ChunkSize   = (Count + WorldSize - 1) / WorldSize;
+  size_t  Begin       = min (Count, ChunkSize * Rank);
+  size_t  End         = min (Count, Begin + ChunkSize);
+
+  Barrier ();
+
+  //
+  // Pairwise tree over the ranks, ((0 + 1) + (2 + 3)) + ..., summed in place in the
+  // slots. This rank is the only one touching the chunk until the next barrier.
+  //
+  for (unsigned int Stride = 1; Stride < WorldSize; Stride *= 2) {
+    for (unsigned int Peer = 0; Peer + Stride < WorldSize; Peer += 2 * Stride) {
+      double        *LeftSlot  = Slots + SlotDoubles * Peer;
+      const double  *RightSlot = Slots + SlotDoubles * (Peer + Stride);
+
+      for (size_t Index = Begin; Index < End; Index++) {
+        LeftSlot[Index] += RightSlot[Index];
+      }
+    }
+  }
+  memcpy (Result + Begin, Slots + Begin, (End - Begin) * sizeof (double));
+
+  Barrier ();
+}
+
+/**
+  Replace Values on every rank with their sum across all ranks.
+
+  @param[in,out]  Values  Values of this rank, the sum on return.
+  @param[in]      Count   Number of values, at most the capacity of the group.
+
+**/
+void
+ShmAllReduce::AllReduceSum (
+  double  *Values,
+  size_t  Count
+  )
+{
+  if (Count > Capacity) {
+    DEBUG_LOG ("Count = " << Count << ", Capacity = " << Capacity);
+    throw invalid_argument ("ShmAllReduce::AllReduceSum (): Too many values.");
+  }
+
+  memcpy (Slot, Values, Count * sizeof (double));
+  ReduceScatter (Count);
+  memcpy (Values, Result, Count * sizeof (double));
+}
+
+/**
+  Replace a set of matrices and some extra values on every rank with their sum
+  across all ranks, in one exchange.
+
+  @param[in,out]  Matrices    Matrices of this rank, e.g. accumulated delta weights.
+  @param[in,out]  Extra       Extra values to be reduced with them, e.g. sample count.
+  @param[in]      ExtraCount  Number of extra values.
+
+**/
+void
+ShmAllReduce::AllReduceSum (
+  vector<matrix>  &Matrices,
+  double          *Extra,
+  unsigned int    ExtraCount
+  )
+{
+  size_t  Count = ExtraCount;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+    Count += Matrices[Index].Size();
+  }
+  if (Count > Capacity) {
+    DEBUG_LOG ("Count = " << Count << ", Capacity = " << Capacity);
+    throw invalid_argument ("ShmAllReduce::AllReduceSum (): Too many values.");
+  }
+
+  double  *Cursor = Slot;
+  for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+    memcpy (Cursor, Matrices[Index].Data(), Matrices[Index].Size() * sizeof (double));
+    Cursor += Matrices[Index].Size();
+  }
+  memcpy (Cursor, Extra, ExtraCount * sizeof (double));
+
+  ReduceScatter (Count);
+
+  const double  *Sum = Result;
+  for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+    memcpy (Matrices[Index].Data(), Sum, Matrices[Index].Size() * sizeof (double));
+    Sum += Matrices[Index].Size();
+  }
+  memcpy (Extra, Sum, ExtraCount * sizeof (double));
+}
+
+/**
+  Copy a set of matrices of the root rank to every other rank.
+
+  @param[in,out]  Matrices  Matrices to be sent on Root, overwritten on other ranks.
+  @param[in]      Root      Rank owning the values.
+
+**/
+void
+ShmAllReduce::Broadcast (
+  vector<matrix>      &Matrices,
+  const unsigned int  Root
+  )
+{
+  size_t  Count = 0;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+    Count += Matrices[Index].Size();
+  }
+  if (Count > Capacity || Root >= WorldSize) {
+    DEBUG_LOG ("Count = " << Count << ", Capacity = " << Capacity << ", Root = " << Root);
+    throw invalid_argument ("ShmAllReduce::Broadcast (): Invalid broadcast.");
+  }
+
+  //
+  // Result may still be read by a rank finishing the previous reduction.
+  //
+  Barrier ();
+
+  if (Rank == Root) {
+    double  *Cursor = Result;
+    for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+      memcpy (Cursor, Matrices[Index].Data(), Matrices[Index].Size() * sizeof (double));
+      Cursor += Matrices[Index].Size();
+    }
+  }
+
+  Barrier ();
+
+  if (Rank != Root) {
+    const double  *Cursor = Result;
+    for (unsigned int Index = 0; Index < (unsigned int)Matrices.size(); Index++) {
+      memcpy (Matrices[Index].Data(), Cursor, Matrices[Index].Size() * sizeof (double));
+      Cursor += Matrices[Index].Size();
+    }
+  }
+
+  Barrier ();
+}
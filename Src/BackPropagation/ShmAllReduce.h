@@ -0,0 +1,101 @@
+/**
+  Shared memory allreduce group definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _SHM_ALL_REDUCE_H_
+#define _SHM_ALL_REDUCE_H_
+
+#include "matrix.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <pthread.h>
+
+//
+// Gradient exchange between local worker processes over POSIX shared memory.
+//
+// The launcher creates the segment with Create() before it starts the
+// workers, every worker then Attach()es with its own rank. The segment holds
+// one send slot per rank and one result area:
+//
+//   SHM_ALL_REDUCE_HEADER | Result[Capacity] | Slot[0][Capacity] ... Slot[WorldSize - 1][Capacity]
+//
+// AllReduceSum() is a reduce-scatter followed by an all-gather: every rank
+// copies its vector into its slot, sums its own 1/WorldSize chunk across all
+// slots into Result, then copies the whole Result back. Every element is
+// summed in the same pairwise tree over the ranks, ((0 + 1) + (2 + 3)) + ...,
+// so all ranks get bit-identical results, and with a power of two ranks the
+// tree continues the one of deterministic training.
+//
+class ShmAllReduce
+{
+  public:
+    ShmAllReduce ();
+    ~ShmAllReduce ();
+
+    static void Create (
+      const std::string  &Name,
+      const unsigned int WorldSize,
+      const size_t       Capacity
+      );
+
+    static void Destroy (
+      const std::string  &Name
+      );
+
+    void Attach (
+      const std::string  &Name,
+      const unsigned int Rank
+      );
+
+    unsigned int GetRank () const;
+    unsigned int GetWorldSize () const;
+
+    void Barrier ();
+
+    void AllReduceSum (
+      double  *Values,
+      size_t  Count
+      );
+
+    void AllReduceSum (
+      std::vector<matrix>  &Matrices,
+      double               *Extra,
+      unsigned int         ExtraCount
+      );
+
+    void Broadcast (
+      std::vector<matrix>  &Matrices,
+      const unsigned int   Root
+      );
+
+  private:
+    void ReduceScatter (
+      size_t  Count
+      );
+
+    void             *Mapping;
+    size_t           MappingSize;
+    unsigned int     Rank;
+    unsigned int     WorldSize;
+    size_t           Capacity;
+    double           *Result;
+    double           *Slot;      // Slot of this rank.
+    double           *Slots;     // Slot of rank 0.
+};
+
+typedef struct {
+  u_int32_t          Signature;
+  u_int32_t          WorldSize;
+  u_int64_t          Capacity;   // Number of doubles per slot.
+  pthread_barrier_t  Barrier;    // Process-shared.
+} SHM_ALL_REDUCE_HEADER;
+
+#define SHM_ALL_REDUCE_SIGNATURE  0x52524853  // "SHRR" in ASCII
+#define SHM_ALL_REDUCE_ALIGNMENT  64
+
+#endif
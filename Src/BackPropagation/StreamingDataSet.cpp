@@ -0,0 +1,514 @@
+/**
+  Streaming data set implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "StreamingDataSet.h"
+#include "IdxFile.h"
+#include "BpMisc.h"
+#include "DebugLib.h"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+StreamingDataSet::StreamingDataSet (
+  ) : ImagesFd (-1),
+      DataOffset (0),
+      RecordCount (0),
+      Rows (0),
+      Columns (0),
+      FeatureCount (0),
+      OutputCount (0),
+      ShardRecords (0),
+      ShardCount (0),
+      PreProcessor (NULL),
+      WindowShards (0),
+      NextSlot (0),
+      ShardReads (0)
+{
+}
+
+StreamingDataSet::~StreamingDataSet (
+  )
+{
+  Close ();
+}
+
+/**
+  Open an image file and its label file for streaming. Only the label file is read
+  now, to index the samples with a label in LabelsToRead. Images are read by shard
+  when they are needed, as bytes, so the image file must be of unsigned bytes.
+
+  @param[in]  ImagesFileName  IDX file of unsigned byte images, of two or more dimensions.
+  @param[in]  LabelsFileName  IDX file of labels of any data type.
+  @param[in]  LabelsToRead    Labels to keep, the output node of a sample is the position
+                              of its label in LabelsToRead.
+  @param[in]  MemoryBudget    Bytes the window of shards may take.
+  @param[in]  ShardRecords    Records per shard.
+
+  @throw  runtime_error     A file cannot be opened or read, or has an invalid header.
+  @throw  invalid_argument  Not even one shard fits in MemoryBudget.
+
+**/
+void
+StreamingDataSet::Open (
+  const string                &ImagesFileName,
+  const string                &LabelsFileName,
+  const vector<unsigned int>  &LabelsToRead,
+  const size_t                MemoryBudget,
+  const unsigned int          ShardRecords
+  )
+{
+  vector<unsigned int>  ImageDimensions;
+  IDX_DATA_TYPE         ImageDataType;
+  IdxFile               LabelsFile;
+
+  Close ();
+
+  if (LabelsToRead.empty () || (LabelsToRead.size () > LABEL_COUNT_MAX) || (ShardRecords == 0)) {
+    DEBUG_LOG ("Labels = " << LabelsToRead.size () << ", ShardRecords = " << ShardRecords);
+    throw invalid_argument ("StreamingDataSet::Open (): Invalid labels or shard size.");
+  }
+
+  ImagesFd = open (ImagesFileName.c_str (), O_RDONLY);
+  if (ImagesFd < 0) {
+    throw runtime_error ("Error: Cannot open file " + ImagesFileName);
+  }
+
+  try {
+    DataOffset = IdxFile::ReadHeader (ImagesFd, ImagesFileName, ImageDataType, ImageDimensions);
+    if (ImageDataType != IDX_UNSIGNED_BYTE) {
+      throw runtime_error ("Error: Only unsigned byte images can be streamed, " + ImagesFileName);
+    }
+    if ((ImageDimensions.size () < 2) || (find (ImageDimensions.begin () + 1, ImageDimensions.end (), 0) != ImageDimensions.end ())) {
+      throw runtime_error ("Error: Invalid image file header");
+    }
+
+    LabelsFile.Open (LabelsFileName);
+    if (LabelsFile.GetRecordValues () != 1) {
+      throw runtime_error ("Error: Invalid label file header");
+    }
+    if (ImageDimensions[0] != LabelsFile.GetCount ()) {
+      throw runtime_error ("Error: The number of images does not match the number of labels");
+    }
+  } catch (...) {
+    Close ();
+    throw;
+  }
+
+  this->ImagesFileName = ImagesFileName;
+  this->ShardRecords   = ShardRecords;
+  RecordCount  = ImageDimensions[0];
+  Rows         = ImageDimensions[1];
+  FeatureCount = 1;
+  for (unsigned int Index = 1; Index < (unsigned int)ImageDimensions.size (); Index++) {
+    FeatureCount *= ImageDimensions[Index];
+  }
+  Columns      = FeatureCount / Rows;
+  OutputCount  = (unsigned int)LabelsToRead.size ();
+  ShardCount   = (RecordCount + ShardRecords - 1) / ShardRecords;
+  WindowShards = (unsigned int)min ((size_t)ShardCount, MemoryBudget / ((size_t)ShardRecords * FeatureCount));
+
+  if (WindowShards == 0) {
+    DEBUG_LOG ("Memory budget = " << MemoryBudget << ", shard = " << (size_t)ShardRecords * FeatureCount << " bytes");
+    Close ();
+    throw invalid_argument ("StreamingDataSet::Open (): Memory budget is smaller than one shard.");
+  }
+
+  //
+  // Index the kept samples from the mapped label file.
+  //
+  LABEL_MAP  LabelMap;
+
+  BuildLabelMap (LabelsToRead, LabelMap);
+
+  for (unsigned int Index = 0; Index < RecordCount; Index++) {
+    unsigned int  Output = LookUpLabel (LabelMap, LabelsFile.GetValue (Index, 0));
+
+    if (Output != LABEL_NOT_TRAINED) {
+      Records.push_back (Index);
+      OutputIndex.push_back ((u_int8_t)Output);
+    }
+  }
+
+  Window.assign ((size_t)WindowShards * ShardRecords * FeatureCount, 0);
+  ShardSlot.assign (ShardCount, -1);
+  SlotShard.assign (WindowShards, ShardCount);
+  NextSlot   = 0;
+  ShardReads = 0;
+}
+
+/**
+  Close the image file and free the window and the index.
+
+**/
+void
+StreamingDataSet::Close (
+  void
+  )
+{
+  if (ImagesFd >= 0) {
+    close (ImagesFd);
+  }
+
+  ImagesFd     = -1;
+  RecordCount  = 0;
+  ShardCount   = 0;
+  WindowShards = 0;
+  Records.clear ();
+  OutputIndex.clear ();
+  Window.clear ();
+  ShardSlot.clear ();
+  SlotShard.clear ();
+}
+
+/**
+  Set how pixels are converted on their way into the network. The default NULL
+  feeds the raw byte values.
+
+  @param[in]  PreProcessor  The conversion, must stay valid while the set is read.
+
+  @throw  invalid_argument  PreProcessor is not ready, e.g. its standardization isn't fitted.
+
+**/
+void
+StreamingDataSet::SetPreProcessor (
+  const InputPreProcessor  *PreProcessor
+  )
+{
+  if ((PreProcessor != NULL) && !PreProcessor->IsReady ()) {
+    throw invalid_argument ("StreamingDataSet::SetPreProcessor (): PreProcessor is not ready.");
+  }
+
+  this->PreProcessor = PreProcessor;
+}
+
+/**
+  Convert the pixels of a sample into FeatureCount input values.
+
+**/
+void
+StreamingDataSet::ConvertPixels (
+  const u_int8_t  *Source,
+  double          *Target
+  ) const
+{
+  if (PreProcessor != NULL) {
+    PreProcessor->Convert (Source, Target);
+    return;
+  }
+
+  #pragma omp simd
+  for (unsigned int Pixel = 0; Pixel < FeatureCount; Pixel++) {
+    Target[Pixel] = Source[Pixel];
+  }
+}
+
+/**
+  Keep only the share of the samples that belongs to one data-parallel worker,
+  dealt out round robin as CompactDataSet::KeepShard() does. Every worker still
+  reads every shard, but only uses its own samples of it.
+
+  @param[in]  Rank       Rank of this worker.
+  @param[in]  WorldSize  Number of workers.
+
+**/
+void
+StreamingDataSet::KeepShard (
+  const unsigned int  Rank,
+  const unsigned int  WorldSize
+  )
+{
+  unsigned int  ShardSize = (unsigned int)Records.size() / WorldSize;
+
+  for (unsigned int Index = 0; Index < ShardSize; Index++) {
+    Records[Index]     = Records[Index * WorldSize + Rank];
+    OutputIndex[Index] = OutputIndex[Index * WorldSize + Rank];
+  }
+
+  Records.resize (ShardSize);
+  OutputIndex.resize (ShardSize);
+}
+
+unsigned int
+StreamingDataSet::GetWindowShards (
+  ) const
+{
+  return WindowShards;
+}
+
+/**
+  Get the number of shards read from disk so far.
+
+**/
+u_int64_t
+StreamingDataSet::GetShardReads (
+  ) const
+{
+  return ShardReads;
+}
+
+/**
+  Get the bytes of a sample, reading its shard into the window first if needed.
+  Doesn't allocate.
+
+  @param[in]  Index  Index of the sample.
+
+  @return  FeatureCount bytes, valid until another shard replaces this one.
+
+  @throw  runtime_error  The shard cannot be read.
+
+**/
+const u_int8_t *
+StreamingDataSet::GetPixels (
+  const unsigned int  Index
+  ) const
+{
+  unsigned int  Record = Records[Index];
+  unsigned int  Shard  = Record / ShardRecords;
+
+  if (ShardSlot[Shard] < 0) {
+    unsigned int  Slot     = NextSlot;
+    unsigned int  Count    = min (ShardRecords, RecordCount - Shard * ShardRecords);
+    size_t        Bytes    = (size_t)Count * FeatureCount;
+    u_int8_t      *Target  = &Window[(size_t)Slot * ShardRecords * FeatureCount];
+    off_t         Position = (off_t)(DataOffset + (size_t)Shard * ShardRecords * FeatureCount);
+
+    if (SlotShard[Slot] != ShardCount) {
+      ShardSlot[SlotShard[Slot]] = -1;
+      SlotShard[Slot] = ShardCount;
+    }
+
+    for (size_t Done = 0; Done < Bytes; ) {
+      ssize_t  Read = pread (ImagesFd, Target + Done, Bytes - Done, Position + (off_t)Done);
+
+      if (Read <= 0) {
+        if ((Read < 0) && (errno == EINTR)) {
+          continue;
+        }
+        DEBUG_LOG ("Shard " << Shard << " of " << ImagesFileName << ": " << strerror (errno));
+        throw runtime_error ("Error: Cannot read file " + ImagesFileName);
+      }
+      Done += (size_t)Read;
+    }
+
+    ShardSlot[Shard] = (int)Slot;
+    SlotShard[Slot]  = Shard;
+    NextSlot         = (Slot + 1) % WindowShards;
+    ShardReads++;
+  }
+
+  return &Window[((size_t)ShardSlot[Shard] * ShardRecords + Record % ShardRecords) * FeatureCount];
+}
+
+unsigned int
+StreamingDataSet::GetSampleCount (
+  ) const
+{
+  return (unsigned int)Records.size();
+}
+
+/**
+  Convert a sample into a FeatureCount * 1 network input.
+
+  @param[in]   Index   Index of the sample.
+  @param[out]  Buffer  Receives the input. Doesn't allocate once it had this size.
+
+  @return  Buffer.
+
+**/
+const matrix &
+StreamingDataSet::GetInput (
+  const unsigned int  Index,
+  matrix              &Buffer
+  ) const
+{
+  const u_int8_t  *Source = GetPixels (Index);
+  double          *Input;
+
+  Buffer.Resize (FeatureCount, 1);
+  Input = Buffer.Data();
+  ConvertPixels (Source, Input);
+
+  return Buffer;
+}
+
+/**
+  Convert a sample into a (Rows * Columns) * 1 network input after changing its
+  image with Augmenter.
+
+  @param[in]      Index      Index of the sample.
+  @param[in]      Augmenter  The changes to apply.
+  @param[in,out]  Rng        Random stream of this sample.
+  @param[in,out]  Scratch    Receives the changed image. Doesn't allocate once it had this size.
+  @param[out]     Buffer     Receives the input. Doesn't allocate once it had this size.
+
+  @return  Buffer.
+
+**/
+const matrix &
+StreamingDataSet::GetAugmentedInput (
+  const unsigned int     Index,
+  const ImageAugmenter   &Augmenter,
+  CounterRng             &Rng,
+  vector<u_int8_t>       &Scratch,
+  matrix                 &Buffer
+  ) const
+{
+  double  *Input;
+
+  Scratch.resize (FeatureCount);
+  Augmenter.Apply (GetPixels (Index), Rows, Columns, Rng, Scratch.data ());
+
+  Buffer.Resize (FeatureCount, 1);
+  Input = Buffer.Data();
+  ConvertPixels (Scratch.data (), Input);
+
+  return Buffer;
+}
+
+bool
+StreamingDataSet::CanAugment (
+  ) const
+{
+  return true;
+}
+
+DESIRED_OUTPUT
+StreamingDataSet::GetDesiredOutput (
+  const unsigned int  Index
+  ) const
+{
+  DESIRED_OUTPUT  DesiredOutput = { NULL, OutputIndex[Index] };
+
+  return DesiredOutput;
+}
+
+unsigned int
+StreamingDataSet::GetClass (
+  const unsigned int  Index
+  ) const
+{
+  return OutputIndex[Index];
+}
+
+void
+StreamingDataSet::GatherInputs (
+  const unsigned int  *Indices,
+  const unsigned int  Count,
+  matrix              &Batch
+  ) const
+{
+  if ((Count > Batch.getrow()) || (Batch.getcolumn() != FeatureCount)) {
+    DEBUG_LOG ("Count = " << Count << ", Batch = " << Batch.getrow() << " * " << Batch.getcolumn() << ", FeatureCount = " << FeatureCount);
+    throw invalid_argument ("Input data size does not match input layer size.");
+  }
+
+  for (unsigned int Sample = 0; Sample < Count; Sample++) {
+    const u_int8_t  *Source = GetPixels (Indices[Sample]);
+    double          *Row    = Batch.Data() + (size_t)Sample * FeatureCount;
+
+    ConvertPixels (Source, Row);
+  }
+}
+
+/**
+  Order the training samples of an epoch window by window: the shards in random
+  order, WindowShards of them per window, and the samples of a window in random
+  order. Each shard is then read once per epoch.
+
+  @param[in,out]  Indices  Indices of the samples to train with.
+  @param[in,out]  Rng      Random stream to draw from, or NULL to use rand().
+
+**/
+void
+StreamingDataSet::ShuffleEpoch (
+  vector<unsigned int>  &Indices,
+  CounterRng            *Rng
+  ) const
+{
+  vector<unsigned int>  ShardOrder (ShardCount);
+  vector<unsigned int>  ShardRank (ShardCount);
+  vector<unsigned int>  Run;
+
+  //
+  // All shards stay in memory, shuffle like an in-memory data set so a seeded run is unchanged.
+  //
+  if (WindowShards >= ShardCount) {
+    DataSource::ShuffleEpoch (Indices, Rng);
+    return;
+  }
+
+  for (unsigned int Shard = 0; Shard < ShardCount; Shard++) {
+    ShardOrder[Shard] = Shard;
+  }
+  if (Rng == NULL) {
+    ShuffleIndices (ShardOrder);
+  } else {
+    ShuffleIndices (ShardOrder, *Rng);
+  }
+  for (unsigned int Position = 0; Position < ShardCount; Position++) {
+    ShardRank[ShardOrder[Position]] = Position;
+  }
+
+  //
+  // Group the samples by window, then shuffle each window's run of samples.
+  //
+  stable_sort (Indices.begin(), Indices.end(), [&] (unsigned int A, unsigned int B) {
+    return ShardRank[Records[A] / ShardRecords] / WindowShards < ShardRank[Records[B] / ShardRecords] / WindowShards;
+  });
+
+  for (unsigned int First = 0; First < (unsigned int)Indices.size(); ) {
+    unsigned int  WindowIdx = ShardRank[Records[Indices[First]] / ShardRecords] / WindowShards;
+    unsigned int  End = First;
+
+    while ((End < (unsigned int)Indices.size()) &&
+           (ShardRank[Records[Indices[End]] / ShardRecords] / WindowShards == WindowIdx)) {
+      End++;
+    }
+
+    Run.assign (Indices.begin() + First, Indices.begin() + End);
+    if (Rng == NULL) {
+      ShuffleIndices (Run);
+    } else {
+      ShuffleIndices (Run, *Rng);
+    }
+    copy (Run.begin(), Run.end(), Indices.begin() + First);
+
+    First = End;
+  }
+}
+
+/**
+  Order samples read once by their place in the file, so each shard is read once.
+
+  @param[in,out]  Indices  Indices of the samples to read.
+
+**/
+void
+StreamingDataSet::SortForReading (
+  vector<unsigned int>  &Indices
+  ) const
+{
+  sort (Indices.begin(), Indices.end());
+}
+
+/**
+  The shard window is loaded by whichever thread reads a sample, so only one
+  thread may read at a time.
+
+**/
+bool
+StreamingDataSet::IsConcurrent (
+  ) const
+{
+  return false;
+}
@@ -0,0 +1,145 @@
+/**
+  Streaming data set definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _STREAMING_DATA_SET_H_
+#define _STREAMING_DATA_SET_H_
+
+#include "matrix.h"
+#include "DataSource.h"
+#include "PreProcess.h"
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+
+//
+// Images of an IDX file read from disk while training, for data sets larger than
+// memory. The image file is split into shards of ShardRecords consecutive records,
+// and a window of as many shards as fit in the memory budget is kept in memory.
+// Each shard is read with one sequential read.
+//
+// ShuffleEpoch() shuffles the order of the shards, then the samples within each
+// window of shards, so an epoch reads every shard once. Reading a sample of a
+// shard outside the window replaces the shard loaded longest ago.
+//
+// Only the window counts against the budget. The index of the kept samples takes
+// 5 bytes per sample besides. Reading changes the window, so unlike other data
+// sources only one thread may read at a time.
+//
+class StreamingDataSet : public DataSource
+{
+  public:
+    StreamingDataSet ();
+    ~StreamingDataSet ();
+
+    void Open (
+      const std::string                &ImagesFileName,
+      const std::string                &LabelsFileName,
+      const std::vector<unsigned int>  &LabelsToRead,
+      const size_t                     MemoryBudget,
+      const unsigned int               ShardRecords
+      );
+
+    void Close ();
+
+    void SetPreProcessor (
+      const InputPreProcessor  *PreProcessor
+      );
+
+    void KeepShard (
+      const unsigned int  Rank,
+      const unsigned int  WorldSize
+      );
+
+    unsigned int GetWindowShards () const;
+    u_int64_t GetShardReads () const;
+
+    //
+    // DataSource
+    //
+    unsigned int GetSampleCount () const;
+
+    const matrix &GetInput (
+      const unsigned int  Index,
+      matrix              &Buffer
+      ) const;
+
+    const matrix &GetAugmentedInput (
+      const unsigned int     Index,
+      const ImageAugmenter   &Augmenter,
+      CounterRng             &Rng,
+      std::vector<u_int8_t>  &Scratch,
+      matrix                 &Buffer
+      ) const;
+
+    bool CanAugment () const;
+
+    DESIRED_OUTPUT GetDesiredOutput (
+      const unsigned int  Index
+      ) const;
+
+    unsigned int GetClass (
+      const unsigned int  Index
+      ) const;
+
+    void GatherInputs (
+      const unsigned int  *Indices,
+      const unsigned int  Count,
+      matrix              &Batch
+      ) const;
+
+    void ShuffleEpoch (
+      std::vector<unsigned int>  &Indices,
+      CounterRng                 *Rng
+      ) const;
+
+    void SortForReading (
+      std::vector<unsigned int>  &Indices
+      ) const;
+
+    bool IsConcurrent () const;
+
+  private:
+    StreamingDataSet (const StreamingDataSet &);
+    StreamingDataSet &operator= (const StreamingDataSet &);
+
+    const u_int8_t *GetPixels (
+      const unsigned int  Index
+      ) const;
+
+    void ConvertPixels (
+      const u_int8_t  *Source,
+      double          *Target
+      ) const;
+
+    int                        ImagesFd;
+    std::string                ImagesFileName;
+    size_t                     DataOffset;      // Of the first record in the image file.
+    unsigned int               RecordCount;     // In the image file.
+    unsigned int               Rows;
+    unsigned int               Columns;
+    unsigned int               FeatureCount;    // Bytes per image, Rows * Columns.
+    unsigned int               OutputCount;
+    unsigned int               ShardRecords;
+    unsigned int               ShardCount;
+    const InputPreProcessor    *PreProcessor;   // NULL for the raw pixel values.
+
+    std::vector<unsigned int>  Records;         // Record of each kept sample, ascending.
+    std::vector<u_int8_t>      OutputIndex;     // Per kept sample.
+
+    //
+    // The window: WindowShards slots of ShardRecords images, filled and replaced in turn.
+    //
+    unsigned int                       WindowShards;
+    mutable std::vector<u_int8_t>      Window;
+    mutable std::vector<int>           ShardSlot;     // Per shard, its slot or -1.
+    mutable std::vector<unsigned int>  SlotShard;     // Per slot, its shard or ShardCount.
+    mutable unsigned int               NextSlot;      // Slot to fill next.
+    mutable u_int64_t                  ShardReads;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/**
+  Task graph scheduler implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "TaskGraph.h"
+#include "DebugLib.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+TaskGraph::TaskGraph (
+  ) : Head (0),
+      Tail (0),
+      Remaining (0),
+      Stopping (false)
+{
+}
+
+TaskGraph::~TaskGraph (
+  )
+{
+  StopThreads ();
+}
+
+/**
+  Add a task to the graph.
+
+  @param[in]  Work  Function doing the task.
+
+  @return  Id of the task, for AddDependency().
+
+**/
+unsigned int
+TaskGraph::AddTask (
+  function<void ()>  Work
+  )
+{
+  TASK  Task;
+
+  Task.Work            = Work;
+  Task.DependencyCount = 0;
+  Task.Pending         = 0;
+  Tasks.push_back (Task);
+  Ready.resize (Tasks.size());
+
+  return (unsigned int)Tasks.size() - 1;
+}
+
+/**
+  Make a task wait for another one.
+
+  @param[in]  Before  Id of the task to be done first.
+  @param[in]  After   Id of the task depending on it.
+
+**/
+void
+TaskGraph::AddDependency (
+  unsigned int  Before,
+  unsigned int  After
+  )
+{
+  if ((Before >= (unsigned int)Tasks.size()) || (After >= (unsigned int)Tasks.size()) || (Before == After)) {
+    DEBUG_LOG ("Before = " << Before << ", After = " << After << ", Tasks = " << Tasks.size());
+    throw invalid_argument ("TaskGraph::AddDependency (): Invalid task.");
+  }
+
+  Tasks[Before].Dependents.push_back (After);
+  Tasks[After].DependencyCount++;
+}
+
+/**
+  Remove all tasks, e.g. to build the graph of another network layout.
+
+**/
+void
+TaskGraph::Clear (
+  void
+  )
+{
+  Tasks.clear ();
+  Ready.clear ();
+}
+
+/**
+  Set the number of helper threads running tasks together with the thread calling
+  Run(). 0(default) runs every task on the calling thread.
+
+**/
+void
+TaskGraph::SetThreads (
+  const unsigned int  Threads
+  )
+{
+  StopThreads ();
+
+  Stopping = false;
+  for (unsigned int Index = 0; Index < Threads; Index++) {
+    Workers.push_back (thread (&TaskGraph::WorkerLoop, this, GetHeapAllocationCounter ()));
+  }
+}
+
+void
+TaskGraph::StopThreads (
+  void
+  )
+{
+  {
+    lock_guard<mutex>  Guard (Lock);
+    Stopping = true;
+  }
+  Queued.notify_all ();
+
+  for (unsigned int Index = 0; Index < (unsigned int)Workers.size(); Index++) {
+    Workers[Index].join ();
+  }
+  Workers.clear ();
+}
+
+/**
+  Run ready tasks until the queue is empty. Called with Lock held, which is
+  released while a task runs.
+
+**/
+void
+TaskGraph::RunReadyTasks (
+  unique_lock<mutex>  &Guard
+  )
+{
+  while (Head < Tail) {
+    TASK  &Task = Tasks[Ready[Head++]];
+
+    Guard.unlock ();
+    try {
+      Task.Work ();
+    }
+    catch (...) {
+      //
+      // Let the run finish, so no task is left referencing the caller's state,
+      // and report the first failure from Run().
+      //
+      Guard.lock ();
+      if (!Failure) {
+        Failure = current_exception ();
+      }
+      Guard.unlock ();
+    }
+    Guard.lock ();
+
+    for (unsigned int Index = 0; Index < (unsigned int)Task.Dependents.size(); Index++) {
+      TASK  &Dependent = Tasks[Task.Dependents[Index]];
+
+      if (--Dependent.Pending == 0) {
+        Ready[Tail++] = Task.Dependents[Index];
+        Queued.notify_one ();
+      }
+    }
+
+    Remaining--;
+    Finished.notify_one ();
+  }
+}
+
+void
+TaskGraph::WorkerLoop (
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+  SetHeapAllocationCounter (Counter);
+
+  unique_lock<mutex>  Guard (Lock);
+
+  while (true) {
+    Queued.wait (Guard, [this] { return Stopping || (Head < Tail); });
+    if (Stopping) {
+      return;
+    }
+
+    RunReadyTasks (Guard);
+  }
+}
+
+/**
+  Run every task once, each after all of its dependencies, and return when all are done.
+
+  @throw  The first exception thrown by a task.
+
+**/
+void
+TaskGraph::Run (
+  void
+  )
+{
+  unique_lock<mutex>  Guard (Lock);
+
+  Head      = 0;
+  Tail      = 0;
+  Remaining = (unsigned int)Tasks.size();
+  Failure   = nullptr;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Tasks.size(); Index++) {
+    Tasks[Index].Pending = Tasks[Index].DependencyCount;
+    if (Tasks[Index].Pending == 0) {
+      Ready[Tail++] = Index;
+    }
+  }
+  Queued.notify_all ();
+
+  while (Remaining != 0) {
+    RunReadyTasks (Guard);
+    Finished.wait (Guard, [this] { return (Remaining == 0) || (Head < Tail); });
+  }
+
+  if (Failure) {
+    rethrow_exception (Failure);
+  }
+}
@@ -0,0 +1,87 @@
+/**
+  Task graph scheduler definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _TASK_GRAPH_H_
+#define _TASK_GRAPH_H_
+
+#include "AllocCounter.h"
+
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+//
+// A fixed set of tasks with dependencies between them, built once and run
+// many times, e.g. the kernels of one backward pass.
+//
+// Run() starts every task whose dependencies are done, on the calling thread
+// and on SetThreads() helper threads, until all tasks are done. A task that
+// finishes makes its dependents ready, in the order the dependencies were
+// added, so the task on the critical path should get its dependency first.
+// Without helper threads the tasks run in a fixed topological order.
+//
+// Run() doesn't allocate, so it can be part of a steady-state training step.
+//
+class TaskGraph
+{
+  public:
+    TaskGraph ();
+    ~TaskGraph ();
+
+    unsigned int AddTask (
+      std::function<void ()>  Work
+      );
+
+    void AddDependency (
+      unsigned int  Before,
+      unsigned int  After
+      );
+
+    void Clear ();
+
+    void SetThreads (
+      const unsigned int  Threads
+      );
+
+    void Run ();
+
+  private:
+    void WorkerLoop (
+      HEAP_ALLOCATION_COUNTER  *Counter     // Allocation counter of the starting thread.
+      );
+
+    void RunReadyTasks (
+      std::unique_lock<std::mutex>  &Guard
+      );
+
+    void StopThreads ();
+
+    typedef struct {
+      std::function<void ()>     Work;
+      std::vector<unsigned int>  Dependents;
+      unsigned int               DependencyCount;
+      unsigned int               Pending;          // Dependencies not done in this Run().
+    } TASK;
+
+    std::vector<TASK>          Tasks;
+    std::vector<unsigned int>  Ready;       // Every task is queued once per Run().
+    unsigned int               Head;
+    unsigned int               Tail;
+    unsigned int               Remaining;
+    std::exception_ptr         Failure;
+
+    std::vector<std::thread>   Workers;
+    std::mutex                 Lock;
+    std::condition_variable    Queued;      // Ready tasks or Stopping, for the helper threads.
+    std::condition_variable    Finished;    // Ready tasks or all done, for Run().
+    bool                       Stopping;
+};
+
+#endif
@@ -0,0 +1,246 @@
+/**
+  TrainingWorkspace class implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "TrainingWorkspace.h"
+
+#include <algorithm>
+
+using namespace std;
+
+TrainingWorkspace::TrainingWorkspace ()
+{
+}
+
+/**
+  Allocate all buffers for a network layout. Values are set to zero.
+
+  @param[in]  Layout  Number of nodes in each layer of the network.
+
+**/
+void
+TrainingWorkspace::Init (
+  const vector<unsigned int>  &Layout
+  )
+{
+  Activation.clear ();
+  NodeDelta.clear ();
+  BatchDeltaWeights.clear ();
+  LeafSums.clear ();
+  PendingDeltaWeights.clear ();
+  NextWeights.clear ();
+  CheckpointScratch.clear ();
+  FrozenOutput = matrix ();
+  FrozenOutputReady.clear ();
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    Activation.push_back (matrix (Layout[Index], 1));
+    NodeDelta.push_back (matrix (Layout[Index], 1));
+
+    if (Index + 1 < (unsigned int)Layout.size()) {
+      BatchDeltaWeights.push_back (matrix (Layout[Index + 1], Layout[Index]));
+    }
+  }
+
+  Input = matrix (Layout.front (), 1);
+}
+
+/**
+  Check whether the buffers are allocated for a network layout.
+
+  @param[in]  Layout  Number of nodes in each layer of the network.
+
+  @retval  true   Buffers match Layout.
+  @retval  false  Init() is required.
+
+**/
+bool
+TrainingWorkspace::IsReady (
+  const vector<unsigned int>  &Layout
+  ) const
+{
+  if (Activation.size () != Layout.size ()) {
+    return false;
+  }
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    if (Activation[Index].getrow () != Layout[Index]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+  Reset the accumulated delta weights to zero at the start of a batch.
+
+**/
+void
+TrainingWorkspace::ClearBatchDeltaWeights (
+  void
+  )
+{
+  for (unsigned int Index = 0; Index < (unsigned int)BatchDeltaWeights.size(); Index++) {
+    BatchDeltaWeights[Index].Fill (0.0);
+  }
+}
+
+/**
+  Allocate the partial sums of a deterministic pairwise reduction, after Init().
+  Values are set to zero.
+
+  @param[in]  Depth  Number of partial sums held at the same time.
+
+**/
+void
+TrainingWorkspace::InitLeafSums (
+  const unsigned int  Depth
+  )
+{
+  LeafSums.assign (Depth, BatchDeltaWeights);
+
+  for (unsigned int Level = 0; Level < Depth; Level++) {
+    for (unsigned int Index = 0; Index < (unsigned int)LeafSums[Level].size(); Index++) {
+      LeafSums[Level][Index].Fill (0.0);
+    }
+  }
+}
+
+/**
+  Allocate the buffers of pipelined weight updates, after Init().
+
+**/
+void
+TrainingWorkspace::InitPipeline (
+  void
+  )
+{
+  PendingDeltaWeights = BatchDeltaWeights;
+  NextWeights         = BatchDeltaWeights;
+}
+
+/**
+  Check whether a layer keeps its activation under activation checkpointing:
+  every Interval-th layer from the input, and the output layer.
+
+  @param[in]  Layer       Index of the layer.
+  @param[in]  LayerCount  Number of layers of the network.
+  @param[in]  Interval    Checkpoint interval, 1 keeps every layer.
+
+**/
+bool
+TrainingWorkspace::IsActivationKept (
+  const unsigned int  Layer,
+  const unsigned int  LayerCount,
+  const unsigned int  Interval
+  )
+{
+  return ((Layer % Interval) == 0) || (Layer == LayerCount - 1);
+}
+
+/**
+  Get the scratch buffers activation checkpointing needs: one per layer of the
+  longest run of layers that aren't kept, each as wide as the widest of them.
+
+**/
+static
+void
+GetCheckpointScratch (
+  const vector<unsigned int>  &Layout,
+  const unsigned int          Interval,
+  unsigned int                &Count,
+  unsigned int                &Width
+  )
+{
+  unsigned int  Run = 0;
+
+  Count = 0;
+  Width = 0;
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    if (TrainingWorkspace::IsActivationKept (Index, (unsigned int)Layout.size(), Interval)) {
+      Run = 0;
+    } else {
+      Count = max (Count, ++Run);
+      Width = max (Width, Layout[Index]);
+    }
+  }
+}
+
+/**
+  Count the activation values a training step holds per sample under activation
+  checkpointing: the kept layers' activations and the scratch buffers. It is only
+  a saving while this is below the sum of the layout.
+
+  @param[in]  Layout    Number of nodes in each layer of the network.
+  @param[in]  Interval  Checkpoint interval.
+
+  @return  Number of activation values.
+
+**/
+size_t
+TrainingWorkspace::GetCheckpointedValues (
+  const vector<unsigned int>  &Layout,
+  const unsigned int          Interval
+  )
+{
+  size_t        Values = 0;
+  unsigned int  Count;
+  unsigned int  Width;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    if (IsActivationKept (Index, (unsigned int)Layout.size(), Interval)) {
+      Values += Layout[Index];
+    }
+  }
+  GetCheckpointScratch (Layout, Interval, Count, Width);
+
+  return Values + (size_t)Count * Width;
+}
+
+/**
+  Release the activations of the layers that aren't kept, and allocate the buffers
+  to compute them in, after Init().
+
+  @param[in]  Layout    Number of nodes in each layer of the network.
+  @param[in]  Interval  Keep every Interval-th layer's activation, at least 2.
+
+**/
+void
+TrainingWorkspace::InitActivationCheckpoints (
+  const vector<unsigned int>  &Layout,
+  const unsigned int          Interval
+  )
+{
+  unsigned int  Count;
+  unsigned int  Width;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Layout.size(); Index++) {
+    if (!IsActivationKept (Index, (unsigned int)Layout.size(), Interval)) {
+      Activation[Index] = matrix ();
+    }
+  }
+
+  GetCheckpointScratch (Layout, Interval, Count, Width);
+  CheckpointScratch.assign (Count, matrix (Width, 1));
+}
+
+/**
+  Allocate an empty cache of the first trainable layer's activation of every data sample.
+
+  @param[in]  SampleCount  Number of data samples in the data set.
+  @param[in]  Width        Number of nodes of the first trainable layer.
+
+**/
+void
+TrainingWorkspace::InitFrozenOutputCache (
+  const unsigned int  SampleCount,
+  const unsigned int  Width
+  )
+{
+  FrozenOutput = matrix (SampleCount, Width);
+  FrozenOutputReady.assign (SampleCount, false);
+}
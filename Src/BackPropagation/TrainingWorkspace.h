@@ -0,0 +1,96 @@
+/**
+  TrainingWorkspace class definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _TRAINING_WORKSPACE_H_
+#define _TRAINING_WORKSPACE_H_
+
+#include "matrix.h"
+
+#include <vector>
+
+//
+// Every buffer a training step needs, sized once from the network layout and
+// reused for the whole run, so a steady-state step doesn't allocate.
+//
+class TrainingWorkspace
+{
+  public:
+    TrainingWorkspace ();
+
+    void Init (
+      const std::vector<unsigned int>  &Layout
+      );
+
+    bool IsReady (
+      const std::vector<unsigned int>  &Layout
+      ) const;
+
+    void ClearBatchDeltaWeights ();
+
+    void InitLeafSums (
+      const unsigned int  Depth
+      );
+
+    void InitPipeline ();
+
+    void InitActivationCheckpoints (
+      const std::vector<unsigned int>  &Layout,
+      const unsigned int               Interval
+      );
+
+    void InitFrozenOutputCache (
+      const unsigned int  SampleCount,
+      const unsigned int  Width
+      );
+
+    static bool IsActivationKept (
+      const unsigned int  Layer,
+      const unsigned int  LayerCount,
+      const unsigned int  Interval
+      );
+
+    static size_t GetCheckpointedValues (
+      const std::vector<unsigned int>  &Layout,
+      const unsigned int               Interval
+      );
+
+    std::vector<matrix>  Activation;          // Layout[Layer] * 1 per layer, see InitActivationCheckpoints().
+    std::vector<matrix>  NodeDelta;           // Layout[Layer] * 1 per layer.
+    std::vector<matrix>  BatchDeltaWeights;   // Layout[Layer + 1] * Layout[Layer] per weight layer.
+    matrix               Input;               // Layout[0] * 1, a sample converted by its DataSource.
+
+    //
+    // Partial sums of deterministic training, shaped like BatchDeltaWeights.
+    // Empty unless InitLeafSums() is called.
+    //
+    std::vector<std::vector<matrix>>  LeafSums;
+
+    //
+    // Buffers of pipelined weight updates, shaped like BatchDeltaWeights.
+    // Empty unless InitPipeline() is called.
+    //
+    std::vector<matrix>  PendingDeltaWeights;  // Delta weights of the update in flight.
+    std::vector<matrix>  NextWeights;          // Weights the update in flight writes.
+
+    //
+    // Activation checkpointing: only the kept layers own an Activation matrix, the
+    // others are empty. A forward pass passes through the first two scratch buffers,
+    // a backward pass lends them to the layers of the segment it recomputes. The two
+    // passes never overlap, so one set of buffers, sized for the widest layer that
+    // isn't kept, serves both.
+    //
+    std::vector<matrix>  CheckpointScratch;    // One per layer of the longest run of dropped layers.
+
+    //
+    // Activation of the first trainable layer of every data sample, while the layers
+    // before it are frozen. A sample's row is filled by its first forward pass.
+    //
+    matrix               FrozenOutput;         // SampleCount * Width
+    std::vector<bool>    FrozenOutputReady;    // Per data sample, empty without the cache.
+};
+
+#endif
@@ -0,0 +1,203 @@
+/**
+  Worker team implementation.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#include "WorkerTeam.h"
+#include "DebugLib.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+WorkerTeam::WorkerTeam (
+  ) : Size (0),
+      RunCount (0),
+      Running (0),
+      SyncArrived (0),
+      SyncCount (0),
+      Stopping (false)
+{
+}
+
+WorkerTeam::~WorkerTeam (
+  )
+{
+  Stop ();
+}
+
+/**
+  Start the member threads. Every Run() afterwards runs Work on all members.
+
+  @param[in]  Size  Number of members, including the thread calling Run().
+  @param[in]  Work  Function every member runs, with its member number.
+
+**/
+void
+WorkerTeam::Start (
+  const unsigned int                  Size,
+  function<void (unsigned int Member)>  Work
+  )
+{
+  if (Size == 0) {
+    DEBUG_LOG ("Size should at least be 1.");
+    throw invalid_argument ("WorkerTeam::Start (): Invalid Size.");
+  }
+
+  Stop ();
+
+  this->Work = Work;
+  this->Size = Size;
+  Stopping   = false;
+  for (unsigned int Member = 1; Member < Size; Member++) {
+    Workers.push_back (thread (&WorkerTeam::WorkerLoop, this, Member, RunCount, GetHeapAllocationCounter ()));
+  }
+}
+
+unsigned int
+WorkerTeam::GetSize (
+  ) const
+{
+  return Size;
+}
+
+/**
+  Run the function on all members and wait until all of them are done.
+
+  @throw  The first exception thrown by a member.
+
+**/
+void
+WorkerTeam::Run (
+  void
+  )
+{
+  if (Size == 0) {
+    throw logic_error ("WorkerTeam::Run (): Not started.");
+  }
+
+  {
+    lock_guard<mutex>  Guard (Lock);
+
+    Running     = Size;
+    SyncArrived = 0;
+    RunCount++;
+  }
+  Started.notify_all ();
+
+  RunMember (0);
+
+  unique_lock<mutex>  Guard (Lock);
+
+  Done.wait (Guard, [this] { return Running == 0; });
+
+  if (Failure) {
+    exception_ptr  Error = Failure;
+
+    Failure = nullptr;
+    rethrow_exception (Error);
+  }
+}
+
+/**
+  Wait until all members have reached this Sync(). Only called by the function
+  of a run, the same number of times by every member.
+
+  @throw  std::runtime_error  Another member failed, to leave the run.
+
+**/
+void
+WorkerTeam::Sync (
+  void
+  )
+{
+  unique_lock<mutex>  Guard (Lock);
+  unsigned int        Count = SyncCount;
+
+  if (++SyncArrived == Size) {
+    SyncArrived = 0;
+    SyncCount++;
+    Synced.notify_all ();
+  } else {
+    Synced.wait (Guard, [this, Count] { return (SyncCount != Count) || Failure; });
+  }
+
+  if (Failure) {
+    throw runtime_error ("WorkerTeam::Sync (): Another member failed.");
+  }
+}
+
+/**
+  End the member threads. Must not be called during Run().
+
+**/
+void
+WorkerTeam::Stop (
+  void
+  )
+{
+  {
+    lock_guard<mutex>  Guard (Lock);
+
+    Stopping = true;
+  }
+  Started.notify_all ();
+
+  for (unsigned int Index = 0; Index < (unsigned int)Workers.size(); Index++) {
+    Workers[Index].join ();
+  }
+  Workers.clear ();
+  Size = 0;
+}
+
+void
+WorkerTeam::RunMember (
+  unsigned int  Member
+  )
+{
+  try {
+    Work (Member);
+  }
+  catch (...) {
+    lock_guard<mutex>  Guard (Lock);
+
+    if (!Failure) {
+      Failure = current_exception ();
+    }
+    Synced.notify_all ();
+  }
+
+  lock_guard<mutex>  Guard (Lock);
+
+  if (--Running == 0) {
+    Done.notify_all ();
+  }
+}
+
+void
+WorkerTeam::WorkerLoop (
+  unsigned int             Member,
+  unsigned int             Seen,
+  HEAP_ALLOCATION_COUNTER  *Counter
+  )
+{
+  SetHeapAllocationCounter (Counter);
+
+  unique_lock<mutex>  Guard (Lock);
+
+  while (true) {
+    Started.wait (Guard, [this, Seen] { return Stopping || (RunCount != Seen); });
+    if (Stopping) {
+      return;
+    }
+
+    Seen = RunCount;
+    Guard.unlock ();
+
+    RunMember (Member);
+
+    Guard.lock ();
+  }
+}
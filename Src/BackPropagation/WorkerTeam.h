@@ -0,0 +1,78 @@
+/**
+  Worker team definition.
+
+  Copyright (c) 2026, visionaryr
+  Licensed under the MIT License. See the accompanying 'LICENSE' file for details.
+**/
+
+#ifndef _WORKER_TEAM_H_
+#define _WORKER_TEAM_H_
+
+#include "AllocCounter.h"
+
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+//
+// A fixed team of members that run one function together, e.g. the shards of
+// a model-parallel layer. Member 0 is the thread calling Run(), every other
+// member has its own thread, so a member always runs on the same thread and
+// keeps its share of the data in that core's cache between runs.
+//
+// Inside the function, Sync() waits until every member has reached it, e.g.
+// between two layers. If a member throws, the others leave their Sync() too,
+// and Run() passes the exception on.
+//
+// Run() and Sync() don't allocate, so they can be part of a steady-state
+// training step.
+//
+class WorkerTeam
+{
+  public:
+    WorkerTeam ();
+    ~WorkerTeam ();
+
+    void Start (
+      const unsigned int                       Size,
+      std::function<void (unsigned int Member)>  Work
+      );
+
+    unsigned int GetSize () const;
+
+    void Run ();
+
+    void Sync ();
+
+    void Stop ();
+
+  private:
+    void WorkerLoop (
+      unsigned int             Member,
+      unsigned int             Seen,       // RunCount before the member's first run.
+      HEAP_ALLOCATION_COUNTER  *Counter    // Allocation counter of the starting thread.
+      );
+
+    void RunMember (
+      unsigned int  Member
+      );
+
+    std::function<void (unsigned int)>  Work;
+    std::vector<std::thread>            Workers;
+    std::mutex                          Lock;
+    std::condition_variable             Started;       // New run or Stopping, for the member threads.
+    std::condition_variable             Done;          // All members done, for Run().
+    std::condition_variable             Synced;        // All members at Sync(), or a failure.
+    unsigned int                        Size;
+    unsigned int                        RunCount;      // Runs started, members wait for the next one.
+    unsigned int                        Running;       // Members not done with this run.
+    unsigned int                        SyncArrived;
+    unsigned int                        SyncCount;     // Completed Sync() points.
+    bool                                Stopping;
+    std::exception_ptr                  Failure;
+};
+
+#endif
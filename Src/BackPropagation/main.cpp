@@ -11,6 +11,9 @@
 #include "PreProcess.h"
 #include "PngIo.h"
 #include "MnistDataSet.h"
+#include "ShmAllReduce.h"
+#include "HyperparameterSweep.h"
+#include "MultiModelTrainer.h"
 
 #include <iostream>
 #include <ctime>
@@ -21,6 +24,14 @@
 #include <iomanip>
 #include <set>
 #include <cstring>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 #define ARRAY_SIZE(Array) \
   (sizeof(Array) / sizeof(Array[0]))
@@ -31,6 +42,28 @@
 #define test_images 0
 #define last_save 15
 
+//
+// Samples per weight update. Split evenly across data-parallel workers.
+//
+#define TRAINING_BATCH_SIZE  300
+
+#define CHECKPOINT_FILE_NAME  "Checkpoint.dat"
+
+//
+// Training-ready data sets, rebuilt from the IDX files when those change.
+//
+#define TRAIN_CACHE_FILE_NAME  "TrainSet.cache"
+#define TEST_CACHE_FILE_NAME   "TestSet.cache"
+#define ENSEMBLE_EPOCHS       10
+
+//
+// Largest random changes of the training images with --augment.
+//
+#define AUGMENT_SHIFT     2      // Pixels
+#define AUGMENT_ROTATION  10.0   // Degrees
+#define AUGMENT_ELASTIC   1.0    // Pixels
+#define AUGMENT_NOISE     16
+
 using namespace std;
 
 int mTrainingCategories[] = {
@@ -43,60 +76,585 @@ int mNetworkLayout[] = {
   10    // Output layer
 };
 
-vector<matrix>
-ConvertLabelsToNetworkOutput (
-  LABELS                &LabelSet,
-  vector<unsigned int>  &TrainingLabels
+/**
+  Set the training parameters used by this program.
+
+  @param[in,out]  TrainingAlgoBp  The BackPropagator to be configured.
+
+**/
+void
+ConfigureTraining (
+  BackPropagator  &TrainingAlgoBp
+  )
+{
+  TrainingAlgoBp.SetLearningRate (0.1);
+  TrainingAlgoBp.SetEpochs (30);
+  TrainingAlgoBp.SetTargetLoss (0.05);
+  TrainingAlgoBp.SetTrainingMode (BATCH_MODE);
+  TrainingAlgoBp.SetBatchSize (TRAINING_BATCH_SIZE);
+  TrainingAlgoBp.SetOptimizer (OPTIMIZER_MOMENTUM);
+  TrainingAlgoBp.SetMomentum (0.9);
+  TrainingAlgoBp.SetValidationSplit (0.1);
+  TrainingAlgoBp.SetEarlyStopping (3, 0.0001);
+  TrainingAlgoBp.SetLrSchedule (LR_SCHEDULE_PLATEAU);
+  TrainingAlgoBp.SetLrPlateauParams (2, 0.5, 0.001);
+}
+
+/**
+  Test the trained network with a test data set.
+
+  @param[in]  FCN                 The trained network.
+  @param[in]  TestData            Test images and labels.
+  @param[in]  TrainingCategories  Label of each output node.
+  @param[in]  ShowEachImage       Print the prediction of every test image.
+
+  @return  Accuracy in percent.
+
+**/
+double
+TestNetwork (
+  FullyConnectedNetwork  &FCN,
+  const DataSource       &TestData,
+  vector<unsigned int>   &TrainingCategories,
+  bool                   ShowEachImage
   )
 {
-  vector<matrix>  DesiredOutputs;
+  unsigned int  Score = 0;
+  matrix        Input;
+
+  for (unsigned int Index = 0; Index < TestData.GetSampleCount (); Index++) {
+    unsigned int  PredictedLabel = FCN.Predict (TestData.GetInput (Index, Input));
+    unsigned int  ActualLabel    = TrainingCategories[TestData.GetClass (Index)];
 
-  for (unsigned int Index = 0; Index < (unsigned int)LabelSet.size(); Index ++) {
-    matrix  DesiredOutput = ConvertOutputValueToMatrix (
-                              LabelSet[Index],
-                              TrainingLabels
-                              );
-    DesiredOutputs.push_back (DesiredOutput);
+    Score += (TrainingCategories[PredictedLabel] == ActualLabel) ? 1 : 0;
+
+    if (ShowEachImage) {
+      cout << "Test Image " << Index << ": Predicted Label = " << TrainingCategories[PredictedLabel] << ", Actual Label = " << ActualLabel << endl;
+    }
   }
 
-  return DesiredOutputs;
+  return (double)Score / TestData.GetSampleCount () * 100;
 }
 
-vector<matrix>
-ConvertDataToNetworkInput (
-  DATA_SET  &DataSet
+/**
+  Train the same initial network in every precision mode and report the test
+  accuracy and training time of each, so reduced precision can be checked
+  against the all-double path.
+
+**/
+void
+RunPrecisionReport (
+  NETWORK_LAYOUT         &Layout,
+  const DataSource       &TrainData,
+  const DataSource       &TestData,
+  vector<unsigned int>   &TrainingCategories
   )
 {
-  vector<matrix>  DataInputs;
+  static const char  *ModeName[] = { "DOUBLE", "FLOAT", "BF16" };
+  unsigned int       Seed = (unsigned int)time (NULL);
+  double             Accuracy[PRECISION_MODE_MAX];
+  double             Seconds[PRECISION_MODE_MAX];
+
+  for (int Mode = PRECISION_DOUBLE; Mode < PRECISION_MODE_MAX; Mode++) {
+    //
+    // Same seed for every mode, so all of them start from the same weights
+    // and see the same sample order.
+    //
+    srand (Seed);
+
+    FullyConnectedNetwork  FCN (Layout);
+    BackPropagator         TrainingAlgoBp (FCN);
+
+    ConfigureTraining (TrainingAlgoBp);
+    TrainingAlgoBp.SetPrecisionMode ((PRECISION_MODE)Mode);
+    TrainingAlgoBp.SetLossScale (1024, true);
+
+    chrono::steady_clock::time_point  Start = chrono::steady_clock::now ();
+    TrainingAlgoBp.Train (TrainData);
+    Seconds[Mode] = chrono::duration<double> (chrono::steady_clock::now () - Start).count ();
+
+    Accuracy[Mode] = TestNetwork (FCN, TestData, TrainingCategories, false);
+  }
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2);
+  oss << endl << "========= Precision Report =========" << endl;
+  oss << "  Mode      Accuracy(%)   Delta(%)   Train Time(s)" << endl;
+  for (int Mode = PRECISION_DOUBLE; Mode < PRECISION_MODE_MAX; Mode++) {
+    oss << "  " << setw(8) << left << ModeName[Mode] << right
+        << setw(12) << Accuracy[Mode]
+        << setw(11) << Accuracy[Mode] - Accuracy[PRECISION_DOUBLE]
+        << setw(16) << Seconds[Mode] << endl;
+  }
+  oss << "====================================" << endl;
+  cout << oss.str();
+}
+
+/**
+  Load the data set once and train a grid of layouts, learning rates and batch sizes
+  concurrently on it, then print the configurations ranked by validation loss,
+  with their test accuracy for information.
+
+**/
+void
+RunSweep (
+  const DataSource       &TrainData,
+  const DataSource       &TestData
+  )
+{
+  static const unsigned int  HiddenNodes[] = { 30, 60, 100 };
+  static const double        LearningRates[] = { 0.05, 0.1, 0.3 };
+  static const unsigned int  BatchSizes[] = { 100, 300 };
+
+  HyperparameterSweep  Sweep (TrainData, TestData);
+
+  for (unsigned int Index = 0; Index < ARRAY_SIZE (HiddenNodes); Index++) {
+    NETWORK_LAYOUT  Layout (mNetworkLayout, mNetworkLayout + ARRAY_SIZE (mNetworkLayout));
+
+    Layout[1] = HiddenNodes[Index];
+    Sweep.AddLayout (Layout);
+  }
+  for (unsigned int Index = 0; Index < ARRAY_SIZE (LearningRates); Index++) {
+    Sweep.AddLearningRate (LearningRates[Index]);
+  }
+  for (unsigned int Index = 0; Index < ARRAY_SIZE (BatchSizes); Index++) {
+    Sweep.AddBatchSize (BatchSizes[Index]);
+  }
+
+  Sweep.SetConfigure (ConfigureTraining);
+
+  HyperparameterSweep::ShowResults (Sweep.Run ());
+}
 
-  for (unsigned int Index = 0; Index < (unsigned int)DataSet.size(); Index++) {
-    vector<double>  DataInput1dVector = DataSet[Index].ConvertToVector ();
+/**
+  Train several networks of the same layout from different initial weights on
+  shared batches, then report the test accuracy of each. The models train for
+  ENSEMBLE_EPOCHS, without the validation, early stopping and target loss of
+  ConfigureTraining().
 
-    matrix  DataInput (DataInput1dVector.size(), 1, DataInput1dVector);
+**/
+void
+RunEnsemble (
+  NETWORK_LAYOUT         &Layout,
+  unsigned int           ModelCount,
+  const DataSource       &TrainData,
+  const DataSource       &TestData,
+  vector<unsigned int>   &TrainingCategories
+  )
+{
+  vector<unique_ptr<FullyConnectedNetwork>>  Networks;
+  vector<unique_ptr<BackPropagator>>         Trainers;
+  MultiModelTrainer                          Ensemble;
 
-    DataInputs.push_back (DataInput);
+  for (unsigned int Index = 0; Index < ModelCount; Index++) {
+    Networks.emplace_back (new FullyConnectedNetwork (Layout));
+    Trainers.emplace_back (new BackPropagator (*Networks.back ()));
+
+    ConfigureTraining (*Trainers.back ());
+    Trainers.back ()->SetValidationSplit (0.0);
+    Trainers.back ()->SetEarlyStopping (0, 0.0);
+    Trainers.back ()->SetTargetLoss (0.0);
+    Ensemble.AddModel (*Trainers.back ());
   }
 
-  return DataInputs;
+  Ensemble.SetEpochs (ENSEMBLE_EPOCHS);
+  Ensemble.SetBatchSize (TRAINING_BATCH_SIZE);
+
+  chrono::steady_clock::time_point  Start = chrono::steady_clock::now ();
+  Ensemble.Train (TrainData);
+  double  Seconds = chrono::duration<double> (chrono::steady_clock::now () - Start).count ();
+
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(2);
+  oss << endl << "Trained " << ModelCount << " models in " << Seconds << " s" << endl;
+  for (unsigned int Index = 0; Index < ModelCount; Index++) {
+    oss << "  Model " << Index << ": Accuracy = "
+        << TestNetwork (*Networks[Index], TestData, TrainingCategories, false) << " %" << endl;
+  }
+  cout << oss.str();
 }
 
 /**
+  Start WorldSize worker processes of this program, each training on its own shard
+  of the data set and exchanging delta weights with the others over shared memory,
+  and wait for all of them. If one worker fails, the others are stopped, as they
+  would otherwise wait for it forever.
+
+  @param[in]  Layout      Network layout, to size the shared memory.
+  @param[in]  WorldSize   Number of worker processes.
+  @param[in]  WorkerArgs  Training options passed on to every worker, e.g. --resume.
+
+  @return  0 if all workers succeeded, -1 otherwise.
+
+**/
+int
+RunDataParallelLauncher (
+  NETWORK_LAYOUT        &Layout,
+  unsigned int          WorldSize,
+  const vector<string>  &WorkerArgs
+  )
+{
+  FullyConnectedNetwork  Prototype (Layout);
+  size_t                 Capacity = 8; // Room for the statistics reduced along with the weights.
+  string                 GroupName = "/BpProgram." + to_string (getpid ());
+  string                 WorldSizeArg = to_string (WorldSize);
+  vector<pid_t>          Workers;
+  int                    Result = 0;
+
+  for (unsigned int Index = 0; Index < (unsigned int)Prototype.GetWeightsRef().size(); Index++) {
+    Capacity += Prototype.GetWeightsRef()[Index].Size();
+  }
+
+  ShmAllReduce::Create (GroupName, WorldSize, Capacity);
+
+  cout << "Starting " << WorldSize << " data-parallel workers" << endl;
+
+  for (unsigned int Rank = 0; Rank < WorldSize; Rank++) {
+    string  RankArg = to_string (Rank);
+    pid_t   Pid = fork ();
+
+    if (Pid == 0) {
+      vector<char *>  Args = {
+                        (char *)"BpProgram",
+                        (char *)"--worker-rank", (char *)RankArg.c_str (),
+                        (char *)"--world-size",  (char *)WorldSizeArg.c_str (),
+                        (char *)"--group",       (char *)GroupName.c_str ()
+                        };
+
+      for (unsigned int Index = 0; Index < (unsigned int)WorkerArgs.size(); Index++) {
+        Args.push_back ((char *)WorkerArgs[Index].c_str ());
+      }
+      Args.push_back (NULL);
+
+      execv ("/proc/self/exe", Args.data ());
+      _exit (127);
+    }
+
+    if (Pid < 0) {
+      cout << "Error: Failed to start worker " << Rank << endl;
+      Result = -1;
+      break;
+    }
+
+    Workers.push_back (Pid);
+  }
+
+  while (!Workers.empty ()) {
+    int    Status;
+    pid_t  Pid = waitpid (-1, &Status, 0);
+
+    if (Pid < 0) {
+      break;
+    }
+
+    Workers.erase (remove (Workers.begin(), Workers.end(), Pid), Workers.end());
+
+    if (!WIFEXITED (Status) || WEXITSTATUS (Status) != 0) {
+      cout << "Error: A data-parallel worker failed, stopping the others." << endl;
+      Result = -1;
+    }
+
+    if (Result != 0) {
+      for (unsigned int Index = 0; Index < (unsigned int)Workers.size(); Index++) {
+        kill (Workers[Index], SIGTERM);
+      }
+    }
+  }
+
+  ShmAllReduce::Destroy (GroupName);
+
+  return Result;
+}
+
+/**
+  Get the preprocessing mode named on the command line.
+
+  @param[in]  Name  binarize, scale or standardize.
+
+  @return  The mode, PREPROCESS_MODE_MAX for an unknown name.
+
+**/
+PREPROCESS_MODE
+ParsePreProcessMode (
+  const char  *Name
+  )
+{
+  static const char  *ModeName[] = { "binarize", "scale", "standardize" };
+
+  for (int Mode = PREPROCESS_BINARIZE; Mode < PREPROCESS_MODE_MAX; Mode++) {
+    if (strcmp (Name, ModeName[Mode - PREPROCESS_BINARIZE]) == 0) {
+      return (PREPROCESS_MODE)Mode;
+    }
+  }
+
+  return PREPROCESS_MODE_MAX;
+}
+
+/**
+  Get the hidden layer sizes named on the command line, e.g. 64,64,64.
+
+  @param[in]   List    Comma separated sizes.
+  @param[out]  Hidden  The sizes.
+
+  @return  false if a size isn't a positive number.
+
+**/
+bool
+ParseHiddenLayers (
+  const char            *List,
+  vector<unsigned int>  &Hidden
+  )
+{
+  char  *End;
+
+  Hidden.clear ();
+  do {
+    unsigned long  Size = strtoul (List, &End, 10);
+
+    if ((End == List) || (Size == 0) || ((*End != ',') && (*End != '\0'))) {
+      return false;
+    }
+    Hidden.push_back ((unsigned int)Size);
+    List = End + 1;
+  } while (*End == ',');
+
+  return true;
+}
+
+/**
+  Hash the weights of a network bit for bit(FNV-1a), to compare the results of
+  deterministic trainings.
+
+**/
+uint64_t
+WeightsChecksum (
+  FullyConnectedNetwork  &FCN
+  )
+{
+  uint64_t  Hash = 0xCBF29CE484222325ULL;
+
+  for (unsigned int Layer = 0; Layer < (unsigned int)FCN.GetWeightsRef().size(); Layer++) {
+    const matrix         &Weight = FCN.GetWeightsRef()[Layer];
+    const unsigned char  *Bytes  = (const unsigned char *)Weight.Data();
+
+    for (size_t Index = 0; Index < Weight.Size() * sizeof (double); Index++) {
+      Hash = (Hash ^ Bytes[Index]) * 0x100000001B3ULL;
+    }
+  }
+
+  return Hash;
+}
+
+/**
+  Read an MNIST data set: kept as bytes in CompactData if its images are unsigned
+  bytes, otherwise at full precision in Inputs and DesiredOutputs, which FullData
+  references.
+
+  @param[in]   DataType            TRAINING_DATA or TEST_DATA.
+  @param[in]   TrainingCategories  Labels to read.
+  @param[in]   CacheFileName       Cache file of the compact data set.
+  @param[out]  CompactData         Receives unsigned byte images.
+  @param[out]  Inputs              Receives images of the other IDX data types.
+  @param[out]  DesiredOutputs      Receives their desired outputs.
+  @param[in]   FullData            Data source over Inputs and DesiredOutputs.
+
+  @return  The data source holding the data set.
+
+**/
+const DataSource *
+LoadMNIST (
+  unsigned short          DataType,
+  vector<unsigned int>    &TrainingCategories,
+  const string            &CacheFileName,
+  CompactDataSet          &CompactData,
+  DATA_SET                &Inputs,
+  DATA_SET                &DesiredOutputs,
+  const MatrixDataSource  &FullData
+  )
+{
+  if (IsMNISTByteImages (DataType)) {
+    ReadMNIST (DataType, CompactData, TrainingCategories, CacheFileName);
+    return &CompactData;
+  }
+
+  ReadMNIST_full_precision (DataType, Inputs, DesiredOutputs, TrainingCategories);
+  return &FullData;
+}
+
+/**
+  Usage: BpProgram [--precision-report | --sweep | --ensemble K | --workers N] [--resume] [--seed S] [--backward-threads T] [--pipelined] [--checkpoint-activations K] [--model-shards M] [--freeze F] [--stream MB] [--input-threads N] [--augment] [--preprocess P] [--epochs E] [--hidden H[,H...]]
+
+    --precision-report  Train in double, float and bf16 precision and compare
+                        their test accuracy instead of a single training run.
+    --sweep             Train a grid of layouts, learning rates and batch sizes
+                        concurrently on one copy of the data set and rank them.
+    --ensemble K        Train K networks from different initial weights on
+                        shared batches and test each of them.
+    --workers N         Train with N local worker processes, each on 1/N of the
+                        training data, averaging delta weights every batch.
+    --resume            Continue from the last checkpoint, if there is one.
+                        Training saves a checkpoint after every epoch.
+    --seed S            Deterministic training from seed S. The trained weights
+                        are the same for any --workers N(a power of two up to
+                        16), and their checksum is printed.
+    --backward-threads T
+                        Run the backward pass as a task graph on T extra threads.
+    --pipelined         Apply each weight update in the background while the next
+                        batch starts on the previous weights.
+    --checkpoint-activations K
+                        Keep only every K-th layer's activation and recompute the
+                        others in the backward pass. Needs a layout with more
+                        than one hidden layer.
+    --model-shards M    Split every layer's nodes across M threads.
+    --freeze F          Train only the weight layers after the first F, and cache
+                        the output of the frozen layers across epochs.
+    --stream MB         Read the training data from the IDX files while training,
+                        keeping at most MB MiB of it in memory.
+    --input-threads N   Prepare the next batch's inputs on N background threads
+                        while the current batch trains.
+    --augment           Train on randomly shifted, rotated, distorted and noisy
+                        copies of the training images, made anew every epoch.
+    --preprocess P      Convert pixels into inputs with binarize, scale(to [0, 1])
+                        or standardize(per-pixel mean and std of the training set).
+    --epochs E          Train for at most E epochs instead of 30(not with
+                        --precision-report, --sweep or --ensemble).
+    --hidden H[,H...]   Hidden layer sizes instead of those in mNetworkLayout
+                        (not with --sweep).
+
+  Images of other IDX data types than unsigned bytes are read at full precision,
+  without --stream, --augment, --preprocess or --workers without --seed.
+
+  --worker-rank, --world-size and --group are passed to the workers by the launcher.
 
 **/
 int
 main (
-  void
+  int   argc,
+  char  *argv[]
   )
 {
-  DATA_SET        DataSet;
-  LABELS          LabelSet;
-  vector<matrix>  DesiredOutputs;
-  vector<matrix>  DataInputs;
+  CompactDataSet    TrainData;
+  StreamingDataSet  StreamedTrainData;
+  const DataSource  *Training = &TrainData;
+  CompactDataSet    TestData;
+  DATA_SET          FullTrainInputs;      // Training set at full precision, if its images aren't bytes.
+  DATA_SET          FullTrainOutputs;
+  MatrixDataSource  FullTrainData (FullTrainInputs, FullTrainOutputs);
+  DATA_SET          FullTestInputs;       // Test set at full precision, if its images aren't bytes.
+  DATA_SET          FullTestOutputs;
+  MatrixDataSource  FullTestData (FullTestInputs, FullTestOutputs);
+  const DataSource  *Testing = &TestData;
+  unsigned int      StreamBudget = 0;
+  unsigned int      InputThreads = 0;
+  bool              Augment = false;
+  PREPROCESS_MODE   PreProcessMode = PREPROCESS_NONE;
+  InputPreProcessor PreProcessor;
+  bool            PrecisionReport = false;
+  bool            Resume = false;
+  bool            Sweep = false;
+  unsigned int    EnsembleSize = 0;
+  unsigned int    Workers = 0;
+  unsigned int    WorkerRank = 0;
+  unsigned int    WorldSize = 0;
+  string          GroupName;
+  string          SeedArg;
+  unsigned int    BackwardThreads = 0;
+  vector<string>  WorkerArgs;       // Options every data-parallel worker gets too.
+  bool            Pipelined = false;
+  unsigned int    CheckpointInterval = 1;
+  unsigned int    ModelShards = 1;
+  unsigned int    FrozenCount = 0;
+  unsigned int    Epochs = 0;       // 0 for the epochs of ConfigureTraining().
+  vector<unsigned int>  Hidden (mNetworkLayout + 1, mNetworkLayout + ARRAY_SIZE (mNetworkLayout) - 1);  // Hidden layer sizes.
+
+  for (int Index = 1; Index < argc; Index++) {
+    if (strcmp (argv[Index], "--precision-report") == 0) {
+      PrecisionReport = true;
+    } else if (strcmp (argv[Index], "--sweep") == 0) {
+      Sweep = true;
+    } else if ((strcmp (argv[Index], "--ensemble") == 0) && (Index + 1 < argc)) {
+      EnsembleSize = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--seed") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      SeedArg = argv[++Index];
+    } else if ((strcmp (argv[Index], "--backward-threads") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      BackwardThreads = (unsigned int)atoi (argv[++Index]);
+    } else if (strcmp (argv[Index], "--pipelined") == 0) {
+      WorkerArgs.push_back (argv[Index]);
+      Pipelined = true;
+    } else if ((strcmp (argv[Index], "--checkpoint-activations") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      CheckpointInterval = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--model-shards") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      ModelShards = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--freeze") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      FrozenCount = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--stream") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      StreamBudget = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--input-threads") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      InputThreads = (unsigned int)atoi (argv[++Index]);
+    } else if (strcmp (argv[Index], "--augment") == 0) {
+      WorkerArgs.push_back (argv[Index]);
+      Augment = true;
+    } else if ((strcmp (argv[Index], "--preprocess") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      PreProcessMode = ParsePreProcessMode (argv[++Index]);
+      if (PreProcessMode == PREPROCESS_MODE_MAX) {
+        cout << "Error: --preprocess takes binarize, scale or standardize." << endl;
+        return -1;
+      }
+    } else if ((strcmp (argv[Index], "--epochs") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      Epochs = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--hidden") == 0) && (Index + 1 < argc)) {
+      WorkerArgs.insert (WorkerArgs.end (), argv + Index, argv + Index + 2);
+      if (!ParseHiddenLayers (argv[++Index], Hidden)) {
+        cout << "Error: --hidden takes positive layer sizes separated by commas, e.g. 64,64." << endl;
+        return -1;
+      }
+    } else if (strcmp (argv[Index], "--resume") == 0) {
+      WorkerArgs.push_back (argv[Index]);
+      Resume = true;
+    } else if ((strcmp (argv[Index], "--workers") == 0) && (Index + 1 < argc)) {
+      Workers = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--worker-rank") == 0) && (Index + 1 < argc)) {
+      WorkerRank = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--world-size") == 0) && (Index + 1 < argc)) {
+      WorldSize = (unsigned int)atoi (argv[++Index]);
+    } else if ((strcmp (argv[Index], "--group") == 0) && (Index + 1 < argc)) {
+      GroupName = argv[++Index];
+    } else {
+      cout << "Usage: " << argv[0] << " [--precision-report | --sweep | --ensemble K | --workers N] [--resume] [--seed S] [--backward-threads T] [--pipelined] [--checkpoint-activations K] [--model-shards M] [--freeze F] [--stream MB] [--input-threads N] [--augment] [--preprocess P] [--epochs E] [--hidden H[,H...]]" << endl;
+      return -1;
+    }
+  }
+
+  if (Sweep && (StreamBudget != 0)) {
+    cout << "Error: --sweep trains on several threads and cannot share a streamed data set." << endl;
+    return -1;
+  }
+
+  if ((PreProcessMode == PREPROCESS_STANDARDIZE) && (StreamBudget != 0)) {
+    cout << "Error: --preprocess standardize needs the whole training set in memory, not --stream." << endl;
+    return -1;
+  }
 
   //
-  // Initialize random generator.
+  // Initialize random generator. Seeds differ between workers, so they shuffle their shards differently.
+  // A deterministic run uses its seed on every worker, only the initial weights of rank 0 are kept.
   //
-  srand (time (NULL));
+  u_int64_t  Seed = strtoull (SeedArg.c_str (), NULL, 0);
+
+  if (SeedArg.empty ()) {
+    srand ((unsigned int)time (NULL) + WorkerRank * 7919);
+  } else {
+    srand ((unsigned int)Seed);
+  }
 
   //
   // Check if train categories match network output layer size.
@@ -111,18 +669,90 @@ main (
   //
   vector<unsigned int> TrainingCategories (mTrainingCategories, mTrainingCategories + ARRAY_SIZE (mTrainingCategories));
 
+  NETWORK_LAYOUT  Layout (1, mNetworkLayout[0]);
+
+  Layout.insert (Layout.end (), Hidden.begin (), Hidden.end ());
+  Layout.push_back (mNetworkLayout[ARRAY_SIZE (mNetworkLayout) - 1]);
+
   //
-  // Get trainning data set.
-  // Convert LabelSet to matrix format to match with network output.
+  // Only byte images can be streamed, augmented, preprocessed or sharded.
   //
-  ReadMNIST_and_label (TRAINING_DATA, DataSet, LabelSet, TrainingCategories);
-  DataInputs     = ConvertDataToNetworkInput (DataSet);
-  DesiredOutputs = ConvertLabelsToNetworkOutput (LabelSet, TrainingCategories);
+  if (((StreamBudget != 0) || Augment || (PreProcessMode != PREPROCESS_NONE) || (((Workers > 1) || (WorldSize > 1)) && SeedArg.empty ())) &&
+      (!IsMNISTByteImages (TRAINING_DATA) || !IsMNISTByteImages (TEST_DATA))) {
+    cout << "Error: --stream, --augment, --preprocess and --workers without --seed need unsigned byte images." << endl;
+    return -1;
+  }
+
+  if (Workers > 1) {
+    return RunDataParallelLauncher (Layout, Workers, WorkerArgs);
+  }
+
+  //
+  // Data-parallel worker: join the launcher's group, only rank 0 reports.
+  //
+  ShmAllReduce  Group;
+
+  if (WorldSize > 1) {
+    Group.Attach (GroupName, WorkerRank);
+    if (WorkerRank != 0) {
+      freopen ("/dev/null", "w", stdout);
+    }
+  }
+
+  //
+  // Get trainning data set, kept as bytes and converted to network input sample by sample.
+  //
+  // With --stream only a window of shards is kept in memory, read from the IDX files as
+  // the epoch reaches them.
+  //
+  if (StreamBudget != 0) {
+    StreamMNIST (TRAINING_DATA, StreamedTrainData, TrainingCategories, (size_t)StreamBudget << 20);
+    Training = &StreamedTrainData;
+  } else {
+    Training = LoadMNIST (TRAINING_DATA, TrainingCategories, TRAIN_CACHE_FILE_NAME, TrainData, FullTrainInputs, FullTrainOutputs, FullTrainData);
+  }
+
+  //
+  // Every worker fits the preprocessing on the whole training set, before keeping its shard,
+  // so all of them convert inputs the same way. Test samples are converted the same way too.
+  //
+  if (PreProcessMode != PREPROCESS_NONE) {
+    PreProcessor.SetMode (PreProcessMode, Layout[0]);
+    PreProcessor.Fit (TrainData);
+    TrainData.SetPreProcessor (&PreProcessor);
+    StreamedTrainData.SetPreProcessor (&PreProcessor);
+    TestData.SetPreProcessor (&PreProcessor);
+  }
+
+  if ((WorldSize > 1) && SeedArg.empty ()) {
+    if (StreamBudget != 0) {
+      StreamedTrainData.KeepShard (WorkerRank, WorldSize);
+    } else {
+      TrainData.KeepShard (WorkerRank, WorldSize);
+    }
+  }
+
+  if (PrecisionReport) {
+    Testing = LoadMNIST (TEST_DATA, TrainingCategories, TEST_CACHE_FILE_NAME, TestData, FullTestInputs, FullTestOutputs, FullTestData);
+    RunPrecisionReport (Layout, *Training, *Testing, TrainingCategories);
+    return 0;
+  }
+
+  if (Sweep) {
+    Testing = LoadMNIST (TEST_DATA, TrainingCategories, TEST_CACHE_FILE_NAME, TestData, FullTestInputs, FullTestOutputs, FullTestData);
+    RunSweep (*Training, *Testing);
+    return 0;
+  }
+
+  if (EnsembleSize > 0) {
+    Testing = LoadMNIST (TEST_DATA, TrainingCategories, TEST_CACHE_FILE_NAME, TestData, FullTestInputs, FullTestOutputs, FullTestData);
+    RunEnsemble (Layout, EnsembleSize, *Training, *Testing, TrainingCategories);
+    return 0;
+  }
 
   //
   // Initialize network, here we use Fully Connected Network(FCN)
   //
-  NETWORK_LAYOUT  Layout (mNetworkLayout, mNetworkLayout + ARRAY_SIZE (mNetworkLayout));
   FullyConnectedNetwork  FCN (Layout);
 
   //
@@ -130,37 +760,77 @@ main (
   //
   BackPropagator  TrainingAlgoBp (FCN);
 
-  TrainingAlgoBp.SetLearningRate (0.1);
-  TrainingAlgoBp.SetEpochs (30);
-  TrainingAlgoBp.SetTargetLoss (0.05);
-  TrainingAlgoBp.SetTrainingMode (BATCH_MODE);
-  TrainingAlgoBp.SetBatchSize (300);
-
-  TrainingAlgoBp.Train (
-    DataInputs,      // Input data
-    DesiredOutputs   // Desired Output
-    );
+  ConfigureTraining (TrainingAlgoBp);
+  if (Epochs != 0) {
+    TrainingAlgoBp.SetEpochs (Epochs);
+  }
 
   //
-  // Test the trained network
+  // Checkpoint after every epoch, so an interrupted run can be continued with --resume.
   //
-  ReadMNIST_and_label (TEST_DATA, DataSet, LabelSet, TrainingCategories);
-  DataInputs     = ConvertDataToNetworkInput (DataSet);
+  TrainingAlgoBp.SetCheckpoint (CHECKPOINT_FILE_NAME, 1, 0);
+  if (Resume && !TrainingAlgoBp.ResumeFromCheckpoint (CHECKPOINT_FILE_NAME)) {
+    cout << "No checkpoint to resume from, start a new training." << endl;
+  }
 
-  unsigned int  Score = 0;
-  for (unsigned int Index = 0; Index < DataInputs.size(); Index++) {
-    unsigned int  PredictedLabel = FCN.Predict (DataInputs[Index]);
+  if (!SeedArg.empty ()) {
+    TrainingAlgoBp.SetDeterministic (Seed);
+  }
+  if (BackwardThreads != 0) {
+    TrainingAlgoBp.SetBackwardThreads (BackwardThreads);
+  }
+  TrainingAlgoBp.SetPipelinedUpdate (Pipelined);
+  TrainingAlgoBp.SetActivationCheckpointing (CheckpointInterval);
+  TrainingAlgoBp.SetModelShards (ModelShards);
+  for (unsigned int Layer = 0; Layer < FrozenCount; Layer++) {
+    TrainingAlgoBp.SetLayerFrozen (Layer, true);
+  }
+  TrainingAlgoBp.SetFrozenOutputCache (FrozenCount != 0);
+  TrainingAlgoBp.SetInputThreads (InputThreads);
+  if (Augment) {
+    AUGMENT_PARAMS  AugmentParams = { AUGMENT_SHIFT, AUGMENT_ROTATION, AUGMENT_ELASTIC, AUGMENT_NOISE };
+
+    TrainingAlgoBp.SetAugmentation (AugmentParams);
+  }
+  if (PreProcessMode != PREPROCESS_NONE) {
+    TrainingAlgoBp.SetPreProcessor (&PreProcessor);
+  }
 
-    Score += (TrainingCategories[PredictedLabel] == LabelSet[Index]) ? 1 : 0;
+  if (WorldSize > 1) {
+    TrainingAlgoBp.SetDataParallelGroup (Group);
+    if (SeedArg.empty ()) {
+      TrainingAlgoBp.SetBatchSize (max (1u, TRAINING_BATCH_SIZE / WorldSize));
+    }
+  }
 
-    cout << "Test Image " << Index << ": Predicted Label = " << TrainingCategories[PredictedLabel] << ", Actual Label = " << LabelSet[Index] << endl;
+  TrainingAlgoBp.Train (*Training);
+  if (StreamBudget != 0) {
+    cout << "Shards read from disk: " << StreamedTrainData.GetShardReads () << endl;
   }
 
+  //
+  // All workers end with the same weights, let rank 0 test them.
+  //
+  if (WorkerRank != 0) {
+    return 0;
+  }
+
+  if (!SeedArg.empty ()) {
+    cout << "Weights checksum: " << hex << WeightsChecksum (FCN) << dec << endl;
+  }
+
+  //
+  // Test the trained network
+  //
+  Testing = LoadMNIST (TEST_DATA, TrainingCategories, TEST_CACHE_FILE_NAME, TestData, FullTestInputs, FullTestOutputs, FullTestData);
+
+  double  Accuracy = TestNetwork (FCN, *Testing, TrainingCategories, true);
+
   // Use an ostringstream to format accuracy so we don't modify cout's global formatting state.
   {
     std::ostringstream oss;
-    oss << std::fixed << std::setprecision(2) << (double)Score / DataInputs.size() * 100;
+    oss << std::fixed << std::setprecision(2) << Accuracy;
     cout << "Accuracy: " << oss.str() << " %" << endl;
   }
   return 0;
-}
\ No newline at end of file
+}
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 using namespace std;
 
@@ -17,7 +18,7 @@ using namespace std;
   Default constructor does nothing. Consumer should never use this one.
 
 **/
-matrix::matrix()
+matrix::matrix() : row (0), column (0)
 {
 
 }
@@ -102,7 +103,7 @@ void matrix::show() const
 
   for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++) {
     for(unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++) {
-      cout << std::setprecision(6) << setw(10) << Matrix[RowIdx][ColumnIdx] << ' ';
+      cout << std::setprecision(6) << setw(10) << Matrix[RowIdx * column + ColumnIdx] << ' ';
     }
     cout << endl;
   }
@@ -123,7 +124,7 @@ void matrix::test_show() const
   {
     for(unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++)
     {
-      cout<<setw(2)<<((Matrix[RowIdx][ColumnIdx] > 0.5) ? 1 : 0);
+      cout<<setw(2)<<((Matrix[RowIdx * column + ColumnIdx] > 0.5) ? 1 : 0);
     }
     cout<<endl;
   }
@@ -155,17 +156,9 @@ matrix::SetMatrix (
     return -1;
   }
 
-  InitMatrixWithValue (Rows, Columns, 0.0);
-
-  int counter = 0;
-  for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++)
-  {
-    for(unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++)
-    {
-      Matrix[RowIdx][ColumnIdx] = SetValues[counter];
-      counter++;
-    }
-  }
+  row    = Rows;
+  column = Columns;
+  Matrix = SetValues;
 
   return 0;
 }
@@ -192,7 +185,7 @@ matrix::GetValue (
     throw std::logic_error("matrix::GetValue: matrix is empty");
   }
 
-  return Matrix[Row][Column];
+  return Matrix[Row * column + Column];
 }
 
 /**
@@ -216,7 +209,7 @@ matrix::SetValue (
     throw std::logic_error("matrix::SetValue: matrix is empty");
   }
 
-  Matrix[Row][Column] = Value;
+  Matrix[Row * column + Column] = Value;
 }
 
 /**
@@ -234,18 +227,10 @@ matrix::InitMatrixWithValue (
   double InitValue
   )
 {
-  if (Matrix.size () != 0) {
-    Matrix.clear ();
-  }
-
   row    = Rows;
   column = Columns;
 
-  for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++)
-  {
-    vector<double> ARow(column, InitValue);
-    Matrix.push_back(ARow);
-  }
+  Matrix.assign ((size_t)Rows * Columns, InitValue);
 }
 
 /**
@@ -261,10 +246,8 @@ matrix::Sum (
 {
   double  Sum = 0.0;
 
-  for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++) {
-    for (unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++) {
-      Sum += Matrix[RowIdx][ColumnIdx];
-    }
+  for (size_t Index = 0; Index < Matrix.size(); Index++) {
+    Sum += Matrix[Index];
   }
 
   return Sum;
@@ -282,15 +265,7 @@ matrix::Sum (
 **/
 vector<double> matrix::ConvertToVector()
 {
-  vector<double> RetVector;
-  for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++)
-  {
-    for(unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++)
-    {
-      RetVector.push_back(Matrix[RowIdx][ColumnIdx]);
-    }
-  }
-  return RetVector;
+  return Matrix;
 }
 
 /**
@@ -311,7 +286,7 @@ vector<double> matrix::ConvertRowToVector (unsigned int Row) const
     throw std::out_of_range("matrix::ConvertRowToVector: index out of range");
   }
 
-  return Matrix[Row];
+  return vector<double> (Matrix.begin() + (size_t)Row * column, Matrix.begin() + (size_t)(Row + 1) * column);
 }
 
 /**
@@ -334,7 +309,7 @@ vector<double> matrix::ConvertColumnToVector (unsigned int Column) const
   vector<double> ColumnVector;
 
   for (unsigned int RowIdx = 0; RowIdx < row; RowIdx++) {
-    ColumnVector.push_back (Matrix[RowIdx][Column]);
+    ColumnVector.push_back (Matrix[RowIdx * column + Column]);
   }
 
   return ColumnVector;
@@ -356,15 +331,106 @@ matrix::ApplyElementWise (
 {
   matrix C(row, column);
 
-  for(unsigned int RowIdx = 0; RowIdx < row; RowIdx++) {
-    for(unsigned int ColumnIdx = 0; ColumnIdx < column; ColumnIdx++) {
-      C.SetValue (
-          RowIdx,
-          ColumnIdx,
-          Func(Matrix[RowIdx][ColumnIdx])
-          );
-    }
+  for (size_t Index = 0; Index < Matrix.size(); Index++) {
+    C.Matrix[Index] = Func (Matrix[Index]);
   }
 
   return C;
-}
\ No newline at end of file
+}
+
+/**
+  Get the number of elements of the matrix.
+
+  @return  Rows * Columns.
+
+**/
+unsigned int
+matrix::Size (
+  void
+  ) const
+{
+  return (unsigned int)Matrix.size();
+}
+
+/**
+  Get the underlying storage of the matrix.
+  Elements are stored contiguously in row-major order, so the element at
+  (Row, Column) is at offset (Row * Columns + Column).
+
+  @return  Pointer to the first element.
+
+**/
+double *
+matrix::Data (
+  void
+  )
+{
+  return Matrix.data();
+}
+
+const double *
+matrix::Data (
+  void
+  ) const
+{
+  return Matrix.data();
+}
+
+/**
+  Set all elements of the matrix to Value, keeping its size.
+
+  @param  Value  The value to be set.
+
+**/
+void
+matrix::Fill (
+  double  Value
+  )
+{
+  std::fill (Matrix.begin(), Matrix.end(), Value);
+}
+
+/**
+  Change the shape of the matrix. Elements are kept in row-major order, new ones
+  are set to zero. Shrinking keeps the memory, so a matrix created with its largest
+  shape can take any smaller one later without allocating.
+
+  @param  Rows     New number of rows.
+  @param  Columns  New number of columns.
+
+**/
+void
+matrix::Resize (
+  unsigned int  Rows,
+  unsigned int  Columns
+  )
+{
+  Matrix.resize ((size_t)Rows * Columns, 0.0);
+  row    = Rows;
+  column = Columns;
+}
+
+/**
+  Give the matrix a new shape of the same size, keeping the elements in row-major
+  order. Nothing is copied, e.g. a 28 * 28 image becomes a 784 * 1 network input.
+
+  @param  Rows     New number of rows.
+  @param  Columns  New number of columns.
+
+  @throw  std::invalid_argument  Rows * Columns is not the size of the matrix.
+
+**/
+void
+matrix::Reshape (
+  unsigned int  Rows,
+  unsigned int  Columns
+  )
+{
+  if ((size_t)Rows * Columns != Matrix.size()) {
+    DEBUG_LOG ("Reshape " << row << " * " << column << " to " << Rows << " * " << Columns);
+    throw std::invalid_argument("matrix::Reshape: size does not match");
+  }
+
+  row    = Rows;
+  column = Columns;
+}
@@ -24,6 +24,13 @@ class matrix
     double GetValue(unsigned int, unsigned int) const;
     void SetValue(unsigned int, unsigned int, double);
     double Sum () const;
+    unsigned int Size () const;
+
+    double *Data ();
+    const double *Data () const;
+    void Fill (double);
+    void Resize (unsigned int, unsigned int); // No allocation within the largest earlier shape.
+    void Reshape (unsigned int, unsigned int); // Same elements in a new shape, no copy.
 
     std::vector<double> ConvertToVector();
     std::vector<double> ConvertRowToVector (unsigned int) const;
@@ -34,7 +41,7 @@ class matrix
   private:
     unsigned int row;
     unsigned int column;
-    std::vector< std::vector<double> > Matrix;
+    std::vector<double> Matrix; // Row-major, Matrix[Row * column + Column]
     void InitMatrixWithValue(unsigned int, unsigned int, double);
     int SetMatrix(unsigned int, unsigned int, std::vector<double>);
 };
@@ -49,6 +56,22 @@ matrix add(const matrix &, const matrix &);
 matrix Substract (const matrix &, const matrix &);
 matrix HadamardProduct (const matrix &, const matrix &);
 
+//
+// In-place variants writing into a pre-sized result, no allocation.
+//
+void MultiplyInto (const matrix &A, const matrix &B, matrix &C);          // C = A * B
+void TransposeMultiplyInto (const matrix &A, const matrix &B, matrix &C); // C = A^T * B
+void MultiplyTransposeInto (const matrix &A, const matrix &B, matrix &C); // C = A * B^T
+void AddOuterProduct (const matrix &X, const matrix &Y, matrix &C);       // C += X * Y^T
+void AddInto (const matrix &A, matrix &C);                                // C += A
+
+//
+// Row ranges [FirstRow, EndRow) of C only, e.g. one shard of a layer.
+//
+void MultiplyRowsInto (const matrix &A, const matrix &B, matrix &C, unsigned int FirstRow, unsigned int EndRow);
+void TransposeMultiplyRowsInto (const matrix &A, const matrix &B, matrix &C, unsigned int FirstRow, unsigned int EndRow);
+void AddOuterProductRows (const matrix &X, const matrix &Y, matrix &C, unsigned int FirstRow, unsigned int EndRow);
+
 
 
 #endif /* MATRIX_H */
@@ -10,81 +10,286 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <algorithm>
 using namespace std;
 
 /**
-  Multiply a row vector by a column vector.
+  Multiply 2 matrices by A * B. A's column number should be the same as B's row number.
+  Return the result matrix.
+
+  @param  A  The first matrix, which should be m * n.
+  @param  B  The second matrix, which should be n * p.
+
+  @return  The result matrix, which is m * p.
 
-  @param  Row     A row vector of size n.
-  @param  Column  A column vector of size n.
+**/
+matrix multiply(const matrix &A, const matrix &B)
+{
+  matrix C (A.getrow(), B.getcolumn());
 
-  @return  The result of the multiplication, which is a scalar.
+  MultiplyInto (A, B, C);
 
-  @throw  std::cout  Size of Row and Column do not match.
+  return C;
+}
+
+/**
+  Multiply 2 matrices by C = A * B into an existing matrix, without allocation.
+
+  @param  A  The first matrix, which should be m * n.
+  @param  B  The second matrix, which should be n * p.
+  @param  C  The result matrix, which should already be m * p.
+
+  @throw  std::runtime_error  Sizes of A, B and C don't match.
 
 **/
-static
-double RowMultiplyColumn (const vector<double> &Row, const vector<double> &Column)
+void MultiplyInto(const matrix &A, const matrix &B, matrix &C)
 {
-  if (Row.size() != Column.size()) {
-    cout<<"RowMultiplyColumn: size of row and column do not match!"<<endl;
-    exit(1);
-  }
+  MultiplyRowsInto (A, B, C, 0, A.getrow());
+}
 
-  double Sum = 0;
+/**
+  Calculate the rows FirstRow to EndRow - 1 of C = A * B, e.g. one shard of a layer.
+  The other rows of C aren't touched, so shards can run concurrently.
 
-  for (unsigned int i = 0; i < Row.size(); i++) {
-    Sum += Row[i] * Column[i];
+  @param  A         The first matrix, which should be m * n.
+  @param  B         The second matrix, which should be n * p.
+  @param  C         The result matrix, which should already be m * p.
+  @param  FirstRow  First row of C to calculate.
+  @param  EndRow    Row after the last row of C to calculate, at most m.
+
+  @throw  std::runtime_error  Sizes of A, B and C don't match, or the rows are out of range.
+
+**/
+void MultiplyRowsInto(const matrix &A, const matrix &B, matrix &C, unsigned int FirstRow, unsigned int EndRow)
+{
+  unsigned int ARows    = A.getrow();
+  unsigned int AColumns = A.getcolumn();
+  unsigned int BColumns = B.getcolumn();
+
+  if ((AColumns != B.getrow()) || (C.getrow() != ARows) || (C.getcolumn() != BColumns) ||
+      (FirstRow > EndRow) || (EndRow > ARows)) {
+    DEBUG_LOG ("A: " << ARows << " * " << AColumns << ", B: " << B.getrow() << " * " << BColumns
+               << ", C: " << C.getrow() << " * " << C.getcolumn() << ", Rows: " << FirstRow << " - " << EndRow);
+    throw runtime_error ("Number of columns in the first matrix should be the same as the number of rows in the second matrix!");
   }
 
-  return Sum;
+  const double *AData = A.Data();
+  const double *BData = B.Data();
+  double       *CData = C.Data();
+
+  //
+  // C(i, j) = sum (A (i, k) * B (k, j)) for k = 0 to n-1,
+  // looping i-k-j so the inner loop walks B and C rows contiguously.
+  //
+  for (unsigned int RowIdx = FirstRow; RowIdx < EndRow; RowIdx++) {
+    double *CRow = CData + (size_t)RowIdx * BColumns;
+
+    for (unsigned int ColumnIdx = 0; ColumnIdx < BColumns; ColumnIdx++) {
+      CRow[ColumnIdx] = 0.0;
+    }
+
+    for (unsigned int k = 0; k < AColumns; k++) {
+      const double  AValue = AData[(size_t)RowIdx * AColumns + k];
+      const double  *BRow  = BData + (size_t)k * BColumns;
+
+      for (unsigned int ColumnIdx = 0; ColumnIdx < BColumns; ColumnIdx++) {
+        CRow[ColumnIdx] += AValue * BRow[ColumnIdx];
+      }
+    }
+  }
 }
 
 /**
-  Multiply 2 matrices by A * B. A's column number should be the same as B's row number.
-  Return the result matrix.
+  Multiply the transpose of A by B, C = A^T * B, into an existing matrix without
+  allocating the transpose.
 
-  @param  A  The first matrix, which should be m * n.
+  @param  A  The first matrix, which should be n * m.
   @param  B  The second matrix, which should be n * p.
+  @param  C  The result matrix, which should already be m * p.
 
-  @return  The result matrix, which is m * p.
+  @throw  std::runtime_error  Sizes of A, B and C don't match.
 
 **/
-matrix multiply(const matrix &A, const matrix &B)
+void TransposeMultiplyInto(const matrix &A, const matrix &B, matrix &C)
 {
-  int ARows = A.getrow();
-  int BRows = B.getrow();
-  int AColumns = A.getcolumn();
-  int BColumns = B.getcolumn();
+  TransposeMultiplyRowsInto (A, B, C, 0, A.getcolumn());
+}
 
-  if(AColumns != BRows) {
-    DEBUG_LOG ("Columns of A matrix = " << AColumns << ", Rows of B matrix = " << BRows);
-    throw runtime_error ("Number of columns in the first matrix should be the same as the number of rows in the second matrix!");
+/**
+  Calculate the rows FirstRow to EndRow - 1 of C = A^T * B, from the columns FirstRow
+  to EndRow - 1 of A. The other rows of C aren't touched.
+
+  @param  A         The first matrix, which should be n * m.
+  @param  B         The second matrix, which should be n * p.
+  @param  C         The result matrix, which should already be m * p.
+  @param  FirstRow  First row of C to calculate.
+  @param  EndRow    Row after the last row of C to calculate, at most m.
+
+  @throw  std::runtime_error  Sizes of A, B and C don't match, or the rows are out of range.
+
+**/
+void TransposeMultiplyRowsInto(const matrix &A, const matrix &B, matrix &C, unsigned int FirstRow, unsigned int EndRow)
+{
+  unsigned int ARows    = A.getrow();
+  unsigned int AColumns = A.getcolumn();
+  unsigned int BColumns = B.getcolumn();
+
+  if ((ARows != B.getrow()) || (C.getrow() != AColumns) || (C.getcolumn() != BColumns) ||
+      (FirstRow > EndRow) || (EndRow > AColumns)) {
+    DEBUG_LOG ("A: " << ARows << " * " << AColumns << ", B: " << B.getrow() << " * " << BColumns
+               << ", C: " << C.getrow() << " * " << C.getcolumn() << ", Rows: " << FirstRow << " - " << EndRow);
+    throw runtime_error ("TransposeMultiplyInto(): Number of rows of A and B should be the same!");
   }
 
-  matrix C (ARows, BColumns);
+  const double *AData = A.Data();
+  const double *BData = B.Data();
+  double       *CData = C.Data();
+
+  fill (CData + (size_t)FirstRow * BColumns, CData + (size_t)EndRow * BColumns, 0.0);
 
   //
-  // Standard matrix multiplication algorithm
-  // C(i, j) = sum (A (i, k) * B (k, j)) for k = 0 to n-1
+  // C(i, j) = sum (A (k, i) * B (k, j)), accumulated row by row of A.
   //
-  double CSum = 0;
-  vector<double> ARow;
-  vector<double> BColumn;
-
-  for(int ARowIdx = 0; ARowIdx < ARows; ARowIdx++) {
-    for(int BColumnIdx = 0; BColumnIdx < BColumns; BColumnIdx++) {
-      ARow    = A.ConvertRowToVector (ARowIdx);
-      BColumn = B.ConvertColumnToVector (BColumnIdx);
-      
-      CSum = RowMultiplyColumn (ARow, BColumn);
-      C.SetValue(ARowIdx, BColumnIdx, CSum);
-
-      CSum = 0;
+  for (unsigned int k = 0; k < ARows; k++) {
+    const double *ARow = AData + (size_t)k * AColumns;
+    const double *BRow = BData + (size_t)k * BColumns;
+
+    for (unsigned int RowIdx = FirstRow; RowIdx < EndRow; RowIdx++) {
+      const double  AValue = ARow[RowIdx];
+      double        *CRow  = CData + (size_t)RowIdx * BColumns;
+
+      for (unsigned int ColumnIdx = 0; ColumnIdx < BColumns; ColumnIdx++) {
+        CRow[ColumnIdx] += AValue * BRow[ColumnIdx];
+      }
     }
   }
+}
 
-  return C;
+#define MULTIPLY_TRANSPOSE_BLOCK  4
+
+/**
+  Multiply A by the transpose of B, C = A * B^T, into an existing matrix without
+  allocating the transpose. Every element is a dot product of a row of A and a row
+  of B. Rows of A are taken MULTIPLY_TRANSPOSE_BLOCK at a time, so each row of B
+  is read once per block instead of once per row of A.
+
+  @param  A  The first matrix, which should be m * n.
+  @param  B  The second matrix, which should be p * n.
+  @param  C  The result matrix, which should already be m * p.
+
+  @throw  std::runtime_error  Sizes of A, B and C don't match.
+
+**/
+void MultiplyTransposeInto(const matrix &A, const matrix &B, matrix &C)
+{
+  unsigned int ARows    = A.getrow();
+  unsigned int Columns  = A.getcolumn();
+  unsigned int BRows    = B.getrow();
+
+  if ((Columns != B.getcolumn()) || (C.getrow() != ARows) || (C.getcolumn() != BRows)) {
+    DEBUG_LOG ("A: " << ARows << " * " << Columns << ", B: " << BRows << " * " << B.getcolumn()
+               << ", C: " << C.getrow() << " * " << C.getcolumn());
+    throw runtime_error ("MultiplyTransposeInto(): Number of columns of A and B should be the same!");
+  }
+
+  const double *AData = A.Data();
+  const double *BData = B.Data();
+  double       *CData = C.Data();
+
+  for (unsigned int BlockStart = 0; BlockStart < ARows; BlockStart += MULTIPLY_TRANSPOSE_BLOCK) {
+    unsigned int  BlockRows = min (ARows - BlockStart, (unsigned int)MULTIPLY_TRANSPOSE_BLOCK);
+
+    for (unsigned int BRowIdx = 0; BRowIdx < BRows; BRowIdx++) {
+      const double *BRow = BData + (size_t)BRowIdx * Columns;
+
+      for (unsigned int RowIdx = BlockStart; RowIdx < BlockStart + BlockRows; RowIdx++) {
+        const double *ARow = AData + (size_t)RowIdx * Columns;
+        double       Sum   = 0.0;
+
+        for (unsigned int k = 0; k < Columns; k++) {
+          Sum += ARow[k] * BRow[k];
+        }
+        CData[(size_t)RowIdx * BRows + BRowIdx] = Sum;
+      }
+    }
+  }
+}
+
+/**
+  Add the outer product of 2 column vectors to a matrix, C = C + X * Y^T.
+
+  @param  X  A column vector, which should be m * 1.
+  @param  Y  A column vector, which should be n * 1.
+  @param  C  The matrix to be added to, which should be m * n.
+
+  @throw  std::invalid_argument  Sizes of X, Y and C don't match.
+
+**/
+void AddOuterProduct(const matrix &X, const matrix &Y, matrix &C)
+{
+  AddOuterProductRows (X, Y, C, 0, X.Size());
+}
+
+/**
+  Add the rows FirstRow to EndRow - 1 of the outer product X * Y^T to C.
+  The other rows of C aren't touched.
+
+  @param  X         A column vector, which should be m * 1.
+  @param  Y         A column vector, which should be n * 1.
+  @param  C         The matrix to be added to, which should be m * n.
+  @param  FirstRow  First row of C to add to.
+  @param  EndRow    Row after the last row of C to add to, at most m.
+
+  @throw  std::invalid_argument  Sizes of X, Y and C don't match, or the rows are out of range.
+
+**/
+void AddOuterProductRows(const matrix &X, const matrix &Y, matrix &C, unsigned int FirstRow, unsigned int EndRow)
+{
+  unsigned int Rows    = X.Size();
+  unsigned int Columns = Y.Size();
+
+  if ((C.getrow() != Rows) || (C.getcolumn() != Columns) || (FirstRow > EndRow) || (EndRow > Rows)) {
+    DEBUG_LOG ("X size: " << Rows << ", Y size: " << Columns << ", C: " << C.getrow() << " * " << C.getcolumn()
+               << ", Rows: " << FirstRow << " - " << EndRow);
+    throw invalid_argument ("AddOuterProduct(): The size of the matrices don't match!");
+  }
+
+  const double *XData = X.Data();
+  const double *YData = Y.Data();
+  double       *CData = C.Data();
+
+  for (unsigned int RowIdx = FirstRow; RowIdx < EndRow; RowIdx++) {
+    const double  XValue = XData[RowIdx];
+    double        *CRow  = CData + (size_t)RowIdx * Columns;
+
+    for (unsigned int ColumnIdx = 0; ColumnIdx < Columns; ColumnIdx++) {
+      CRow[ColumnIdx] += XValue * YData[ColumnIdx];
+    }
+  }
+}
+
+/**
+  Add a matrix to another one element by element, C = C + A.
+
+  @param  A  The matrix to be added, which should be m * n.
+  @param  C  The matrix to be added to, which should be m * n.
+
+  @throw  std::invalid_argument  Sizes of A and C don't match.
+
+**/
+void AddInto(const matrix &A, matrix &C)
+{
+  if ((A.getrow() != C.getrow()) || (A.getcolumn() != C.getcolumn())) {
+    DEBUG_LOG ("A: " << A.getrow() << " * " << A.getcolumn() << ", C: " << C.getrow() << " * " << C.getcolumn());
+    throw invalid_argument ("AddInto(): The size of the matrices don't match!");
+  }
+
+  const double *AData = A.Data();
+  double       *CData = C.Data();
+
+  for (size_t Index = 0; Index < A.Size(); Index++) {
+    CData[Index] += AData[Index];
+  }
 }
 
 /**